@@ -0,0 +1,314 @@
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+#include <base58.hpp>
+
+namespace bc_toolbox {
+
+namespace {
+
+const char alphabet[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+/***
+ * Maps a character to its value, or -1 if it is not in the alphabet
+ */
+struct decode_table
+{
+   decode_table()
+   {
+      for(int i = 0; i < 256; ++i)
+         value[i] = -1;
+      for(int i = 0; i < 58; ++i)
+         value[(uint8_t)alphabet[i]] = i;
+   }
+   int8_t value[256];
+};
+
+const decode_table table;
+
+// powers of 58 up to the largest that fits in a 32 bit limb
+const uint32_t pow58[] = { 1, 58, 3364, 195112, 11316496, 656356768 };
+const uint32_t limb_base = 656356768; // 58^5
+
+/***
+ * Convert bytes to little-endian limbs of 5 Base58 digits each.
+ * Bytes are taken 4 at a time, so each step is one multiply-add per limb.
+ * @param in the bytes (without leading zeros)
+ * @param limbs where to put the limbs
+ */
+void to_limbs(byte_span in, std::vector<uint32_t>& limbs)
+{
+   limbs.clear();
+   limbs.reserve(in.size() * 8 / 29 + 1);
+   size_t pos = 0;
+   size_t chunk = in.size() % 4 == 0 ? 4 : in.size() % 4;
+   while (pos < in.size())
+   {
+      uint64_t carry = 0;
+      for(size_t i = 0; i < chunk; ++i)
+         carry = (carry << 8) | in[pos + i];
+      uint64_t mult = (uint64_t)1 << (chunk * 8);
+      for(uint32_t& limb : limbs)
+      {
+         uint64_t t = limb * mult + carry;
+         limb = t % limb_base;
+         carry = t / limb_base;
+      }
+      while (carry != 0)
+      {
+         limbs.push_back(carry % limb_base);
+         carry /= limb_base;
+      }
+      pos += chunk;
+      chunk = 4;
+   }
+}
+
+/***
+ * Convert Base58 digits to little-endian 32 bit limbs. Digits are taken
+ * 5 at a time.
+ * @param in the characters (without leading '1's)
+ * @param limbs where to put the limbs
+ * @param capacity the room in limbs
+ * @param count set to the number of limbs used
+ * @returns false if a character is not Base58 or the value does not fit
+ */
+bool from_base58(char_span in, uint32_t* limbs, size_t capacity, size_t& count)
+{
+   count = 0;
+   size_t pos = 0;
+   size_t chunk = in.size() % 5 == 0 ? 5 : in.size() % 5;
+   while (pos < in.size())
+   {
+      uint64_t carry = 0;
+      for(size_t i = 0; i < chunk; ++i)
+      {
+         int8_t digit = table.value[(uint8_t)in[pos + i]];
+         if (digit < 0)
+            return false;
+         carry = carry * 58 + digit;
+      }
+      uint64_t mult = pow58[chunk];
+      for(size_t i = 0; i < count; ++i)
+      {
+         uint64_t t = limbs[i] * mult + carry;
+         limbs[i] = (uint32_t)t;
+         carry = t >> 32;
+      }
+      if (carry != 0)
+      {
+         if (count == capacity)
+            return false;
+         limbs[count++] = (uint32_t)carry;
+      }
+      pos += chunk;
+      chunk = 5;
+   }
+   return true;
+}
+
+/***
+ * @returns the number of bytes needed for the limbs, without leading zeros
+ */
+size_t significant_bytes(const uint32_t* limbs, size_t count)
+{
+   if (count == 0)
+      return 0;
+   uint32_t top = limbs[count - 1];
+   size_t top_bytes = top > 0xffffff ? 4 : (top > 0xffff ? 3 : (top > 0xff ? 2 : 1));
+   return (count - 1) * 4 + top_bytes;
+}
+
+/***
+ * Write limbs as big-endian bytes
+ * @param out where to write significant_bytes() bytes
+ */
+void write_bytes(const uint32_t* limbs, size_t count, uint8_t* out)
+{
+   size_t len = significant_bytes(limbs, count);
+   for(size_t i = 0; i < len; ++i)
+      out[len - 1 - i] = limbs[i / 4] >> ((i % 4) * 8);
+}
+
+size_t leading(char_span in, char c)
+{
+   size_t ret_val = 0;
+   while (ret_val < in.size() && in[ret_val] == c)
+      ++ret_val;
+   return ret_val;
+}
+
+/***
+ * Decode an address into its 25 bytes (version, hash, checksum) without
+ * touching the heap. The checksum is not checked.
+ * @returns false if it is not Base58 or is the wrong length
+ */
+bool decode_payload(char_span in, uint8_t* out)
+{
+   const size_t payload_size = 25;
+   // 25 bytes is at most 35 characters, which is 7 limbs
+   if (in.size() > 35)
+      return false;
+   size_t zeros = leading(in, '1');
+   uint32_t limbs[8];
+   size_t count = 0;
+   if (!from_base58(in.subspan(zeros), limbs, 8, count))
+      return false;
+   if (zeros + significant_bytes(limbs, count) != payload_size)
+      return false;
+   std::memset(out, 0, zeros);
+   write_bytes(limbs, count, out + zeros);
+   return true;
+}
+
+/***
+ * Fill in the type from the version byte of a payload that passed its checksum
+ */
+void classify(const uint8_t* payload, decoded_address& address)
+{
+   address.type = address_type::invalid;
+   switch(payload[0])
+   {
+      case 0x00: address.type = address_type::p2pkh; address.testnet = false; break;
+      case 0x05: address.type = address_type::p2sh; address.testnet = false; break;
+      case 0x6f: address.type = address_type::p2pkh; address.testnet = true; break;
+      case 0xc4: address.type = address_type::p2sh; address.testnet = true; break;
+      default: return;
+   }
+   std::copy(payload + 1, payload + 21, address.hash.begin());
+}
+
+} // namespace
+
+std::string base58_encode(byte_span in)
+{
+   size_t zeros = 0;
+   while (zeros < in.size() && in[zeros] == 0)
+      ++zeros;
+   std::vector<uint32_t> limbs;
+   to_limbs(in.subspan(zeros), limbs);
+   std::string ret_val(zeros, '1');
+   ret_val.reserve(zeros + limbs.size() * 5);
+   char digits[5];
+   for(size_t i = limbs.size(); i > 0; --i)
+   {
+      uint32_t limb = limbs[i - 1];
+      for(int d = 4; d >= 0; --d)
+      {
+         digits[d] = alphabet[limb % 58];
+         limb /= 58;
+      }
+      // the most significant limb is written without padding
+      size_t start = 0;
+      if (i == limbs.size())
+         while (start < 4 && digits[start] == '1')
+            ++start;
+      ret_val.append(digits + start, 5 - start);
+   }
+   return ret_val;
+}
+
+std::vector<uint8_t> base58_decode(char_span in)
+{
+   size_t zeros = leading(in, '1');
+   std::vector<uint32_t> limbs(in.size() * 733 / 4000 + 1);
+   size_t count = 0;
+   if (!from_base58(in.subspan(zeros), limbs.data(), limbs.size(), count))
+      throw std::invalid_argument("invalid Base58 character");
+   std::vector<uint8_t> ret_val(zeros + significant_bytes(limbs.data(), count));
+   write_bytes(limbs.data(), count, ret_val.data() + zeros);
+   return ret_val;
+}
+
+std::string base58check_encode(byte_span in)
+{
+   std::vector<uint8_t> with_checksum(in.size() + 4);
+   std::copy(in.begin(), in.end(), with_checksum.begin());
+   digest256 checksum;
+   sha256d(in, checksum.data());
+   std::copy(checksum.begin(), checksum.begin() + 4, with_checksum.begin() + in.size());
+   return base58_encode(with_checksum);
+}
+
+std::vector<uint8_t> base58check_decode(char_span in)
+{
+   std::vector<uint8_t> ret_val = base58_decode(in);
+   if (ret_val.size() < 4)
+      throw std::invalid_argument("Base58Check string too short");
+   size_t len = ret_val.size() - 4;
+   digest256 checksum;
+   sha256d(byte_span(ret_val.data(), len), checksum.data());
+   if (!std::equal(checksum.begin(), checksum.begin() + 4, ret_val.begin() + len))
+      throw std::invalid_argument("Base58Check checksum mismatch");
+   ret_val.resize(len);
+   return ret_val;
+}
+
+std::vector<uint8_t> decoded_address::script_pubkey() const
+{
+   std::vector<uint8_t> ret_val;
+   switch(type)
+   {
+      case address_type::p2pkh:
+         ret_val = { 0x76, 0xa9, 0x14 }; // OP_DUP OP_HASH160 push 20
+         ret_val.insert(ret_val.end(), hash.begin(), hash.end());
+         ret_val.push_back(0x88); // OP_EQUALVERIFY
+         ret_val.push_back(0xac); // OP_CHECKSIG
+         break;
+      case address_type::p2sh:
+         ret_val = { 0xa9, 0x14 }; // OP_HASH160 push 20
+         ret_val.insert(ret_val.end(), hash.begin(), hash.end());
+         ret_val.push_back(0x87); // OP_EQUAL
+         break;
+      default:
+         break;
+   }
+   return ret_val;
+}
+
+decoded_address decode_address(char_span address)
+{
+   decoded_address ret_val;
+   uint8_t payload[25];
+   if (!decode_payload(address, payload))
+      return ret_val;
+   digest256 checksum;
+   sha256d(byte_span(payload, 21), checksum.data());
+   if (std::equal(checksum.begin(), checksum.begin() + 4, payload + 21))
+      classify(payload, ret_val);
+   return ret_val;
+}
+
+void decode_addresses(span<const std::string> addresses, span<decoded_address> results)
+{
+   if (results.size() < addresses.size())
+      throw std::invalid_argument("not enough room for results");
+   const size_t chunk = 256;
+   uint8_t payloads[chunk][25];
+   byte_span messages[chunk];
+   size_t which[chunk];
+   digest256 checksums[chunk];
+   for(size_t start = 0; start < addresses.size(); start += chunk)
+   {
+      size_t count = std::min(chunk, addresses.size() - start);
+      // decode everything, then hash the ones that decoded in one batch
+      size_t valid = 0;
+      for(size_t i = 0; i < count; ++i)
+      {
+         results[start + i] = decoded_address();
+         if (decode_payload(addresses[start + i], payloads[valid]))
+         {
+            messages[valid] = byte_span(payloads[valid], 21);
+            which[valid] = start + i;
+            ++valid;
+         }
+      }
+      sha256d_batch(span<const byte_span>(messages, valid), span<digest256>(checksums, valid));
+      for(size_t i = 0; i < valid; ++i)
+         if (std::equal(checksums[i].begin(), checksums[i].begin() + 4, payloads[i] + 21))
+            classify(payloads[i], results[which[i]]);
+   }
+}
+
+} // namespace bc_toolbox
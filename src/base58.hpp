@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <span.hpp>
+#include <hash.hpp>
+
+namespace bc_toolbox {
+
+   /***
+    * @brief Base58 encode (no checksum)
+    * @param in the bytes
+    * @returns the encoded string
+    */
+   std::string base58_encode(byte_span in);
+   /***
+    * @brief Base58 decode (no checksum)
+    * @param in the encoded string
+    * @returns the bytes
+    * @throws std::invalid_argument if a character is not in the Base58 alphabet
+    */
+   std::vector<uint8_t> base58_decode(char_span in);
+   /***
+    * @brief append a 4 byte double SHA-256 checksum and Base58 encode
+    * @param in the payload (usually a version byte followed by a hash)
+    * @returns the encoded string
+    */
+   std::string base58check_encode(byte_span in);
+   /***
+    * @brief Base58 decode and verify the checksum
+    * @param in the encoded string
+    * @returns the payload, without the checksum
+    * @throws std::invalid_argument if the string is not Base58 or the checksum is wrong
+    */
+   std::vector<uint8_t> base58check_decode(char_span in);
+
+   enum class address_type
+   {
+      invalid,
+      p2pkh,
+      p2sh
+   };
+
+   /*****
+    * A legacy (Base58Check) address
+    */
+   class decoded_address
+   {
+      public:
+         decoded_address() : type(address_type::invalid), testnet(false) { hash.fill(0); }
+         address_type type;
+         bool testnet;
+         digest160 hash;
+         /***
+          * @returns the output script that pays to this address (empty if invalid)
+          */
+         std::vector<uint8_t> script_pubkey() const;
+   };
+
+   /***
+    * @brief decode and verify one address
+    * @param address the address
+    * @returns the address, with type invalid if it could not be decoded
+    */
+   decoded_address decode_address(char_span address);
+   /***
+    * @brief decode and verify many addresses. The checksums are computed
+    * together with the batch hashing functions.
+    * @param addresses the addresses
+    * @param results where to put the results, one per address
+    * @throws std::invalid_argument if there are fewer results than addresses
+    */
+   void decode_addresses(span<const std::string> addresses, span<decoded_address> results);
+
+}
@@ -0,0 +1,297 @@
+#include <stdexcept>
+#include <algorithm>
+
+#include <bech32.hpp>
+#include <hash.hpp>
+
+namespace bc_toolbox {
+
+namespace {
+
+const char charset[] = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
+const uint32_t generator[] = { 0x3b6a57b2, 0x26508e6d, 0x1ea119fa, 0x3d4233dd, 0x2a1462b3 };
+const uint32_t bech32_const = 1;
+const uint32_t bech32m_const = 0x2bc830a3;
+const size_t max_length = 90;
+
+/***
+ * Lookup tables for the checksum and the character set
+ */
+struct tables
+{
+   tables()
+   {
+      // the generator terms selected by each value of the top 5 bits
+      for(uint32_t top = 0; top < 32; ++top)
+      {
+         poly[top] = 0;
+         for(int i = 0; i < 5; ++i)
+            if ((top >> i) & 1)
+               poly[top] ^= generator[i];
+      }
+      for(int i = 0; i < 256; ++i)
+         value[i] = -1;
+      for(int i = 0; i < 32; ++i)
+      {
+         char c = charset[i];
+         value[(uint8_t)c] = i;
+         if (c >= 'a' && c <= 'z')
+            value[(uint8_t)(c - 'a' + 'A')] = i;
+      }
+   }
+   uint32_t poly[32];
+   int8_t value[256];
+};
+
+const tables table;
+
+inline uint32_t polymod_step(uint32_t chk, uint8_t value)
+{
+   return ((chk & 0x1ffffff) << 5) ^ value ^ table.poly[chk >> 25];
+}
+
+/***
+ * Run the human readable part through the checksum
+ */
+uint32_t polymod_hrp(const std::string& hrp)
+{
+   uint32_t chk = 1;
+   for(char c : hrp)
+      chk = polymod_step(chk, (uint8_t)c >> 5);
+   chk = polymod_step(chk, 0);
+   for(char c : hrp)
+      chk = polymod_step(chk, (uint8_t)c & 0x1f);
+   return chk;
+}
+
+uint32_t encoding_const(bech32_encoding encoding)
+{
+   return encoding == bech32_encoding::bech32 ? bech32_const : bech32m_const;
+}
+
+/***
+ * Regroup bits
+ * @param in the values
+ * @param from_bits the width of each incoming value
+ * @param to_bits the width of each outgoing value
+ * @param pad true to pad the last value with zeros, false to require
+ * that the leftover bits are zero
+ * @param out where to write the values
+ * @param capacity the room in out
+ * @param count the number of values in out (appended to)
+ * @returns false if the input could not be regrouped
+ */
+bool convert_bits(byte_span in, int from_bits, int to_bits, bool pad, uint8_t* out, size_t capacity,
+      size_t& count)
+{
+   uint32_t acc = 0;
+   int bits = 0;
+   const uint32_t max_value = (1 << to_bits) - 1;
+   for(uint8_t v : in)
+   {
+      if (v >> from_bits)
+         return false;
+      acc = (acc << from_bits) | v;
+      bits += from_bits;
+      while (bits >= to_bits)
+      {
+         bits -= to_bits;
+         if (count == capacity)
+            return false;
+         out[count++] = (acc >> bits) & max_value;
+      }
+   }
+   if (pad)
+   {
+      if (bits > 0)
+      {
+         if (count == capacity)
+            return false;
+         out[count++] = (acc << (to_bits - bits)) & max_value;
+      }
+   }
+   else if (bits >= from_bits || ((acc << (to_bits - bits)) & max_value) != 0)
+      return false;
+   return true;
+}
+
+bool valid_program(int version, size_t size)
+{
+   if (version < 0 || version > 16 || size < 2 || size > 40)
+      return false;
+   return version != 0 || size == 20 || size == 32;
+}
+
+/***
+ * Decode a Bech32 or Bech32m string without throwing
+ * @returns nullptr on success, otherwise the reason it failed
+ */
+const char* decode(char_span in, std::string& hrp, std::vector<uint8_t>& values, bech32_encoding& encoding)
+{
+   if (in.size() > max_length)
+      return "bech32 string too long";
+   bool lower = false;
+   bool upper = false;
+   size_t separator = in.size();
+   for(size_t i = 0; i < in.size(); ++i)
+   {
+      char c = in[i];
+      if (c < 33 || c > 126)
+         return "invalid bech32 character";
+      if (c >= 'a' && c <= 'z')
+         lower = true;
+      if (c >= 'A' && c <= 'Z')
+         upper = true;
+      if (c == '1')
+         separator = i;
+   }
+   if (lower && upper)
+      return "mixed case bech32 string";
+   if (separator == 0 || separator == in.size() || separator + 7 > in.size())
+      return "invalid bech32 separator position";
+   hrp.assign(in.data(), separator);
+   std::transform(hrp.begin(), hrp.end(), hrp.begin(), ::tolower);
+   uint32_t chk = polymod_hrp(hrp);
+   values.clear();
+   for(size_t i = separator + 1; i < in.size(); ++i)
+   {
+      int8_t v = table.value[(uint8_t)in[i]];
+      if (v < 0)
+         return "invalid bech32 character";
+      chk = polymod_step(chk, v);
+      values.push_back(v);
+   }
+   values.resize(values.size() - 6);
+   if (chk == bech32_const)
+      encoding = bech32_encoding::bech32;
+   else if (chk == bech32m_const)
+      encoding = bech32_encoding::bech32m;
+   else
+      return "bech32 checksum mismatch";
+   return nullptr;
+}
+
+/***
+ * Decode into a segwit_address
+ * @param values scratch space, reused between calls
+ */
+void decode_segwit(char_span address, segwit_address& result, std::vector<uint8_t>& values)
+{
+   result = segwit_address();
+   bech32_encoding encoding;
+   if (decode(address, result.hrp, values, encoding) != nullptr || values.empty())
+   {
+      result.hrp.clear();
+      return;
+   }
+   int version = values[0];
+   size_t size = 0;
+   if (version > 16
+         || (version == 0) != (encoding == bech32_encoding::bech32)
+         || !convert_bits(byte_span(values.data() + 1, values.size() - 1), 5, 8, false,
+               result.program.data(), result.program.size(), size)
+         || !valid_program(version, size))
+   {
+      result.hrp.clear();
+      return;
+   }
+   result.program_size = size;
+   result.version = version;
+}
+
+} // namespace
+
+std::string bech32_encode(const std::string& hrp, byte_span values, bech32_encoding encoding)
+{
+   if (hrp.empty())
+      throw std::invalid_argument("empty bech32 human readable part");
+   if (hrp.size() + 1 + values.size() + 6 > max_length)
+      throw std::invalid_argument("bech32 string too long");
+   std::string ret_val;
+   ret_val.reserve(hrp.size() + 1 + values.size() + 6);
+   for(char c : hrp)
+   {
+      if (c < 33 || c > 126 || (c >= 'A' && c <= 'Z'))
+         throw std::invalid_argument("invalid bech32 human readable part");
+      ret_val.push_back(c);
+   }
+   ret_val.push_back('1');
+   uint32_t chk = polymod_hrp(hrp);
+   for(uint8_t v : values)
+   {
+      if (v > 31)
+         throw std::invalid_argument("bech32 value out of range");
+      chk = polymod_step(chk, v);
+      ret_val.push_back(charset[v]);
+   }
+   for(int i = 0; i < 6; ++i)
+      chk = polymod_step(chk, 0);
+   chk ^= encoding_const(encoding);
+   for(int i = 0; i < 6; ++i)
+      ret_val.push_back(charset[(chk >> (5 * (5 - i))) & 31]);
+   return ret_val;
+}
+
+bech32_encoding bech32_decode(char_span in, std::string& hrp, std::vector<uint8_t>& values)
+{
+   bech32_encoding ret_val;
+   const char* error = decode(in, hrp, values, ret_val);
+   if (error != nullptr)
+      throw std::invalid_argument(error);
+   return ret_val;
+}
+
+std::vector<uint8_t> segwit_address::script_pubkey() const
+{
+   std::vector<uint8_t> ret_val;
+   if (!valid())
+      return ret_val;
+   // OP_0 or OP_1 through OP_16, then a push of the program
+   ret_val.push_back(version == 0 ? 0x00 : 0x50 + version);
+   ret_val.push_back(program_size);
+   ret_val.insert(ret_val.end(), program.begin(), program.begin() + program_size);
+   return ret_val;
+}
+
+std::string encode_segwit_address(const std::string& hrp, uint8_t version, byte_span program)
+{
+   if (!valid_program(version, program.size()))
+      throw std::invalid_argument("invalid witness version or program length");
+   // a version and at most 40 bytes of program
+   uint8_t values[1 + 64];
+   size_t count = 1;
+   values[0] = version;
+   convert_bits(program, 8, 5, true, values, sizeof(values), count);
+   return bech32_encode(hrp, byte_span(values, count),
+         version == 0 ? bech32_encoding::bech32 : bech32_encoding::bech32m);
+}
+
+segwit_address decode_segwit_address(char_span address)
+{
+   segwit_address ret_val;
+   std::vector<uint8_t> values;
+   decode_segwit(address, ret_val, values);
+   return ret_val;
+}
+
+void decode_segwit_addresses(span<const std::string> addresses, span<segwit_address> results)
+{
+   if (results.size() < addresses.size())
+      throw std::invalid_argument("not enough room for results");
+   std::vector<uint8_t> values;
+   values.reserve(max_length);
+   for(size_t i = 0; i < addresses.size(); ++i)
+      decode_segwit(addresses[i], results[i], values);
+}
+
+void p2wsh_addresses(const std::string& hrp, span<const byte_span> scripts, span<std::string> addresses)
+{
+   if (addresses.size() < scripts.size())
+      throw std::invalid_argument("not enough room for addresses");
+   std::vector<digest256> hashes(scripts.size());
+   sha256_batch(scripts, hashes);
+   for(size_t i = 0; i < scripts.size(); ++i)
+      addresses[i] = encode_segwit_address(hrp, 0, hashes[i]);
+}
+
+} // namespace bc_toolbox
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <array>
+#include <cstdint>
+
+#include <span.hpp>
+
+namespace bc_toolbox {
+
+   enum class bech32_encoding
+   {
+      bech32, // BIP173, for witness version 0
+      bech32m // BIP350, for witness version 1 and up
+   };
+
+   /***
+    * @brief encode 5 bit values with a Bech32 or Bech32m checksum
+    * @param hrp the human readable part (i.e. "bc" or "tb")
+    * @param values the data, each between 0 and 31
+    * @param encoding which checksum to use
+    * @returns the string (lower case)
+    * @throws std::invalid_argument if the hrp or a value is invalid, or the result is too long
+    */
+   std::string bech32_encode(const std::string& hrp, byte_span values, bech32_encoding encoding);
+   /***
+    * @brief decode a Bech32 or Bech32m string
+    * @param in the string
+    * @param hrp set to the human readable part (lower case)
+    * @param values set to the 5 bit values, without the checksum
+    * @returns which checksum matched
+    * @throws std::invalid_argument if the string is malformed or neither checksum matches
+    */
+   bech32_encoding bech32_decode(char_span in, std::string& hrp, std::vector<uint8_t>& values);
+
+   /*****
+    * A decoded segwit address
+    */
+   class segwit_address
+   {
+      public:
+         segwit_address() : version(-1), program_size(0) {}
+         std::string hrp;
+         int version; // -1 if the address is invalid
+         std::array<uint8_t, 40> program;
+         size_t program_size;
+         bool valid() const { return version >= 0; }
+         byte_span get_program() const { return byte_span(program.data(), program_size); }
+         /***
+          * @returns the output script that pays to this address (empty if invalid)
+          */
+         std::vector<uint8_t> script_pubkey() const;
+   };
+
+   /***
+    * @brief encode a witness program as an address. Version 0 uses Bech32, later
+    * versions use Bech32m.
+    * @param hrp "bc" for mainnet, "tb" for testnet
+    * @param version the witness version (0 to 16)
+    * @param program the witness program
+    * @returns the address
+    * @throws std::invalid_argument if the version or program length is not allowed
+    */
+   std::string encode_segwit_address(const std::string& hrp, uint8_t version, byte_span program);
+   /***
+    * @brief decode and validate a segwit address
+    * @param address the address
+    * @returns the address, which is not valid() if it could not be decoded
+    */
+   segwit_address decode_segwit_address(char_span address);
+   /***
+    * @brief decode and validate many segwit addresses
+    * @param addresses the addresses
+    * @param results where to put the results, one per address
+    * @throws std::invalid_argument if there are fewer results than addresses
+    */
+   void decode_segwit_addresses(span<const std::string> addresses, span<segwit_address> results);
+   /***
+    * @brief derive the P2WSH addresses of many witness scripts. The scripts
+    * are hashed together with sha256_batch.
+    * @param hrp "bc" for mainnet, "tb" for testnet
+    * @param scripts the witness scripts
+    * @param addresses where to put the results, one per script
+    * @throws std::invalid_argument if there are fewer addresses than scripts
+    */
+   void p2wsh_addresses(const std::string& hrp, span<const byte_span> scripts, span<std::string> addresses);
+
+}
@@ -0,0 +1,172 @@
+#include <stdexcept>
+#include <deque>
+#include <algorithm>
+#include <future>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "block_file.hpp"
+#include "transaction_view.hpp"
+#include "compact_size.hpp"
+
+namespace bc_toolbox {
+
+block_header::block_header(const uint8_t* bytes)
+{
+   version = read_le32(bytes);
+   std::memcpy(prev_block.data(), bytes + 4, 32);
+   std::memcpy(merkle_root.data(), bytes + 36, 32);
+   timestamp = read_le32(bytes + 68);
+   bits = read_le32(bytes + 72);
+   nonce = read_le32(bytes + 76);
+}
+
+block_header block_record::header() const
+{
+   if (bytes.size() < 80)
+      throw std::out_of_range("block truncated");
+   return block_header(bytes.data());
+}
+
+std::vector<byte_span> block_record::transaction_bytes() const
+{
+   if (bytes.size() < 81)
+      throw std::out_of_range("block truncated");
+   size_t pos = 80;
+   uint64_t num_transactions = 0;
+   size_t width = 0;
+   if (decode_compact_size(bytes.subspan(pos), num_transactions, width) != compact_size_error::ok)
+      throw std::out_of_range("block truncated");
+   pos += width;
+   // every transaction is at least 10 bytes, so don't trust a larger count
+   std::vector<byte_span> ret_val;
+   ret_val.reserve( std::min<uint64_t>(num_transactions, (bytes.size() - pos) / 10) );
+   for(uint64_t i = 0; i < num_transactions; ++i)
+   {
+      transaction_bounds tx;
+      scan_error error = scan_transaction(bytes.subspan(pos), tx);
+      if (error == scan_error::truncated)
+         throw std::out_of_range("block truncated");
+      if (error != scan_error::ok)
+         throw std::invalid_argument(scan_error_string(error));
+      ret_val.push_back(bytes.subspan(pos, tx.length));
+      pos += tx.length;
+   }
+   return ret_val;
+}
+
+block_file::block_file(const std::string& filename, uint32_t magic)
+      : data(nullptr), length(0), magic(magic)
+{
+   int fd = open(filename.c_str(), O_RDONLY);
+   if (fd < 0)
+      throw std::runtime_error("Unable to open " + filename + ": " + strerror(errno));
+   struct stat st;
+   if (fstat(fd, &st) != 0)
+   {
+      close(fd);
+      throw std::runtime_error("Unable to stat " + filename + ": " + strerror(errno));
+   }
+   length = st.st_size;
+   if (length > 0)
+   {
+      void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapped == MAP_FAILED)
+      {
+         close(fd);
+         throw std::runtime_error("Unable to map " + filename + ": " + strerror(errno));
+      }
+      madvise(mapped, length, MADV_SEQUENTIAL);
+      data = static_cast<const uint8_t*>(mapped);
+   }
+   // the mapping stays valid after the descriptor is closed
+   close(fd);
+}
+
+block_file::~block_file()
+{
+   if (data != nullptr)
+      munmap(const_cast<uint8_t*>(data), length);
+}
+
+std::vector<block_record> block_file::records() const
+{
+   std::vector<block_record> ret_val;
+   size_t pos = 0;
+   while (length - pos >= 8)
+   {
+      uint32_t record_magic = read_le32(data + pos);
+      if (record_magic == 0)
+         break; // preallocated space at the end of the file
+      if (record_magic != magic)
+         throw std::invalid_argument("Block magic not found at offset " + std::to_string(pos));
+      uint32_t size = read_le32(data + pos + 4);
+      pos += 8;
+      if (length - pos < size)
+         throw std::out_of_range("Block truncated at offset " + std::to_string(pos));
+      ret_val.push_back( block_record(pos, byte_span(data + pos, size)) );
+      pos += size;
+   }
+   return ret_val;
+}
+
+block block_file::parse_block(const block_record& record)
+{
+   block ret_val;
+   ret_val.offset = record.offset;
+   std::vector<byte_span> txs = record.transaction_bytes();
+   ret_val.header = record.header();
+   ret_val.transactions.reserve(txs.size());
+   for(const byte_span& tx : txs)
+      ret_val.transactions.push_back( transaction(tx) );
+   return ret_val;
+}
+
+std::vector<block> block_file::parse_blocks(thread_pool& pool) const
+{
+   std::vector<block> ret_val;
+   parse_blocks(pool, [&ret_val](block& b) { ret_val.push_back(std::move(b)); },
+         pool.size() * 4);
+   return ret_val;
+}
+
+void block_file::parse_blocks(thread_pool& pool, std::function<void(block&)> callback,
+      size_t window) const
+{
+   if (window == 0)
+      window = 1;
+   std::vector<block_record> recs = records();
+   std::deque<std::future<block> > pending;
+   size_t next = 0;
+   try
+   {
+      while (next < recs.size() || !pending.empty())
+      {
+         // keep the pool busy
+         while (next < recs.size() && pending.size() < window)
+         {
+            const block_record& rec = recs[next++];
+            pending.push_back( pool.submit( [&rec]() { return parse_block(rec); } ) );
+         }
+         // hand back the oldest block, which keeps the results in file order
+         block b = pending.front().get();
+         pending.pop_front();
+         callback(b);
+      }
+   }
+   catch(...)
+   {
+      // the queued jobs refer to the records, so let them finish first
+      for(auto& f : pending)
+         if (f.valid())
+            f.wait();
+      throw;
+   }
+}
+
+} // namespace bc_toolbox
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <array>
+#include <functional>
+#include <cstdint>
+
+#include <span.hpp>
+#include <transaction.hpp>
+#include <thread_pool.hpp>
+
+namespace bc_toolbox {
+
+// network magic, as read little-endian from the start of each record
+const uint32_t MAINNET_MAGIC = 0xd9b4bef9;
+const uint32_t TESTNET_MAGIC = 0x0709110b;
+const uint32_t REGTEST_MAGIC = 0xdab5bffa;
+const uint32_t SIGNET_MAGIC = 0x40cf030a;
+
+/*****
+ * The 80 byte block header
+ */
+class block_header
+{
+   public:
+      block_header() {}
+      block_header(const uint8_t* bytes);
+      uint32_t version;
+      std::array<uint8_t, 32> prev_block;
+      std::array<uint8_t, 32> merkle_root;
+      uint32_t timestamp;
+      uint32_t bits;
+      uint32_t nonce;
+};
+
+/*****
+ * One magic/size record of a block file. The bytes point into the
+ * mapped file.
+ */
+class block_record
+{
+   public:
+      block_record(size_t offset, byte_span bytes) : offset(offset), bytes(bytes) {}
+      size_t offset; // where the block starts within the file
+      byte_span bytes; // the serialized block
+      /***
+       * @returns the block header
+       * @throws std::out_of_range if the record is shorter than a header
+       */
+      block_header header() const;
+      /***
+       * @brief find the transactions of the block without parsing them
+       * @returns a span for each transaction
+       * @throws std::out_of_range if the block is truncated
+       * @throws std::invalid_argument if a transaction is otherwise malformed
+       */
+      std::vector<byte_span> transaction_bytes() const;
+};
+
+/*****
+ * A fully parsed block
+ */
+class block
+{
+   public:
+      size_t offset; // where the block starts within the file
+      block_header header;
+      std::vector<transaction> transactions;
+};
+
+/*****
+ * A read-only, memory mapped blk*.dat file
+ *
+ * Note: files written by Bitcoin Core 28+ may be obfuscated with the key
+ * in blocks/xor.dat. Those must be deobfuscated before they can be read here.
+ */
+class block_file
+{
+   public:
+      /***
+       * @brief map a block file
+       * @param filename the file
+       * @param magic the network magic expected at the start of each record
+       * @throws std::runtime_error if the file cannot be opened or mapped
+       */
+      block_file(const std::string& filename, uint32_t magic = MAINNET_MAGIC);
+      ~block_file();
+      block_file(const block_file&) = delete;
+      block_file& operator=(const block_file&) = delete;
+      /***
+       * @brief walk the magic/size records of the file. Stops at the
+       * zero padding Bitcoin Core leaves at the end of a preallocated file.
+       * @returns the records, in file order
+       * @throws std::invalid_argument if a record does not start with the magic
+       * @throws std::out_of_range if a record is truncated
+       */
+      std::vector<block_record> records() const;
+      /***
+       * @brief parse every block of the file on a pool of threads
+       * @param pool the threads to use
+       * @returns the blocks, in file order
+       */
+      std::vector<block> parse_blocks(thread_pool& pool) const;
+      /***
+       * @brief parse the blocks of the file on a pool of threads, handing
+       * each one to a callback in file order. At most "window" blocks are
+       * held in memory at one time.
+       * @param pool the threads to use
+       * @param callback called (on the calling thread) for each block
+       * @param window the number of blocks to parse ahead
+       */
+      void parse_blocks(thread_pool& pool, std::function<void(block&)> callback,
+            size_t window = 64) const;
+      /***
+       * @returns the bytes of the whole file
+       */
+      byte_span bytes() const { return byte_span(data, length); }
+      /***
+       * @brief parse one record into a block
+       */
+      static block parse_block(const block_record& record);
+   private:
+      const uint8_t* data;
+      size_t length;
+      uint32_t magic;
+};
+
+} // namespace bc_toolbox
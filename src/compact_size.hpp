@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include <span.hpp>
+
+namespace bc_toolbox {
+
+/*****
+ * The CompactSize ("varint") length prefix used throughout the wire format:
+ * values below 0xfd are one byte. Larger values are 0xfd, 0xfe or 0xff
+ * followed by 2, 4 or 8 little-endian bytes.
+ *
+ * Decoding works on spans, never reads past their end, and reports
+ * problems with an error code rather than an exception.
+ */
+enum class compact_size_error
+{
+   ok,
+   truncated, // the span ends inside the encoding
+   non_canonical // a longer encoding than the value needs
+};
+
+/***
+ * @returns the number of bytes the encoding of value occupies (1, 3, 5 or 9)
+ */
+inline size_t compact_size_length(uint64_t value)
+{
+   return 1 + 2 * (value >= 0xfd) + 2 * (value > 0xffff) + 4 * (value > 0xffffffff);
+}
+
+/***
+ * @brief encode a value
+ * @param value the value
+ * @param out where to write. Must have room for compact_size_length(value) bytes
+ * @returns the number of bytes written
+ */
+inline size_t encode_compact_size(uint64_t value, uint8_t* out)
+{
+   if (value < 0xfd)
+   {
+      out[0] = (uint8_t)value;
+      return 1;
+   }
+   // the prefix for 3, 5 and 9 byte encodings
+   static const uint8_t prefixes[10] = { 0, 0, 0, 0xfd, 0, 0xfe, 0, 0, 0, 0xff };
+   const size_t len = compact_size_length(value);
+   out[0] = prefixes[len];
+   for(size_t i = 1; i < len; ++i)
+      out[i] = (uint8_t)(value >> (8 * (i - 1)));
+   return len;
+}
+
+/***
+ * @brief encode a value, if it fits
+ * @returns the number of bytes written, or 0 if out is too small
+ */
+inline size_t encode_compact_size(uint64_t value, mutable_byte_span out)
+{
+   if (out.size() < compact_size_length(value))
+      return 0;
+   return encode_compact_size(value, out.data());
+}
+
+/***
+ * @brief decode a value
+ * @param in the bytes, starting with the encoding
+ * @param value set to the value
+ * @param width set to the number of bytes the encoding occupies
+ * @returns compact_size_error::ok, or why the bytes are not a valid
+ * encoding (value and width are then unspecified)
+ */
+inline compact_size_error decode_compact_size(byte_span in, uint64_t& value, size_t& width)
+{
+   if (in.empty())
+      return compact_size_error::truncated;
+   const uint8_t first = in[0];
+   if (first < 0xfd)
+   {
+      value = first;
+      width = 1;
+      return compact_size_error::ok;
+   }
+   // 0xfd, 0xfe, 0xff: 2, 4, 8 more bytes
+   const unsigned shift = first - 0xfc;
+   width = (1U << shift) + 1;
+   if (in.size() < width)
+      return compact_size_error::truncated;
+   uint64_t bytes = 0;
+   for(size_t i = width - 1; i > 0; --i)
+      bytes = bytes << 8 | in[i];
+   value = bytes;
+   // the smallest value each width may hold: 0xfd, 0x10000, 0x100000000
+   static const uint64_t minimum[4] = { 0, 0xfd, 0x10000, 0x100000000ULL };
+   return bytes < minimum[shift] ? compact_size_error::non_canonical : compact_size_error::ok;
+}
+
+/***
+ * @brief decode consecutive values, such as a run of lengths
+ * @param in the bytes, starting with the first encoding
+ * @param out where to put the values. Decodes out.size() of them
+ * @param consumed set to the number of bytes decoded (up to the error, if any)
+ * @returns compact_size_error::ok, or why decoding stopped
+ */
+inline compact_size_error decode_compact_sizes(byte_span in, span<uint64_t> out, size_t& consumed)
+{
+   const uint8_t* pos = in.data();
+   const uint8_t* end = pos + in.size();
+   size_t count = 0;
+   while (count < out.size())
+   {
+      // eight one-byte values at once, when no byte of the next eight is
+      // 0xfd or above (a byte is, when its high bit is set and adding 3 to
+      // its low seven bits carries into the high bit)
+      if (end - pos >= 8 && out.size() - count >= 8)
+      {
+         uint64_t word;
+         std::memcpy(&word, pos, 8);
+         const uint64_t high = 0x8080808080808080ULL;
+         if ((word & ((word & ~high) + 0x0303030303030303ULL) & high) == 0)
+         {
+            for(size_t i = 0; i < 8; ++i)
+               out[count + i] = pos[i];
+            pos += 8;
+            count += 8;
+            continue;
+         }
+      }
+      size_t width = 0;
+      compact_size_error error = decode_compact_size(byte_span(pos, end - pos), out[count], width);
+      if (error != compact_size_error::ok)
+      {
+         consumed = pos - in.data();
+         return error;
+      }
+      pos += width;
+      ++count;
+   }
+   consumed = pos - in.data();
+   return compact_size_error::ok;
+}
+
+} // namespace bc_toolbox
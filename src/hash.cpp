@@ -0,0 +1,254 @@
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+
+#include <openssl/sha.h>
+
+#include <hash.hpp>
+#include "hash_lanes.hpp"
+
+namespace bc_toolbox {
+
+#ifdef ENABLE_SSE41
+namespace sse41 {
+   void sha256_4way(const byte_span* msgs, uint8_t* out);
+   void sha256_32_4way(const uint8_t* in, uint8_t* out);
+   void ripemd160_32_4way(const uint8_t* in, uint8_t* out);
+   void sha256d64_4way(const uint8_t* in, uint8_t* out);
+}
+#endif
+#ifdef ENABLE_AVX2
+namespace avx2 {
+   void sha256_8way(const byte_span* msgs, uint8_t* out);
+   void sha256_32_8way(const uint8_t* in, uint8_t* out);
+   void ripemd160_32_8way(const uint8_t* in, uint8_t* out);
+   void sha256d64_8way(const uint8_t* in, uint8_t* out);
+}
+#endif
+
+namespace {
+
+/***
+ * A single lane, for hashing one message with the lane kernels
+ */
+struct scalar_lane
+{
+   static const size_t count = 1;
+   uint32_t v;
+   static scalar_lane splat(uint32_t x) { scalar_lane r; r.v = x; return r; }
+   static scalar_lane load(const uint32_t* x) { return splat(x[0]); }
+};
+
+inline scalar_lane add(scalar_lane a, scalar_lane b) { return scalar_lane::splat(a.v + b.v); }
+inline scalar_lane xor_(scalar_lane a, scalar_lane b) { return scalar_lane::splat(a.v ^ b.v); }
+inline scalar_lane and_(scalar_lane a, scalar_lane b) { return scalar_lane::splat(a.v & b.v); }
+inline scalar_lane or_(scalar_lane a, scalar_lane b) { return scalar_lane::splat(a.v | b.v); }
+inline scalar_lane andnot(scalar_lane a, scalar_lane b) { return scalar_lane::splat(~a.v & b.v); }
+inline scalar_lane shl(scalar_lane a, int n) { return scalar_lane::splat(a.v << n); }
+inline scalar_lane shr(scalar_lane a, int n) { return scalar_lane::splat(a.v >> n); }
+inline void store(uint32_t* out, scalar_lane a) { out[0] = a.v; }
+
+typedef void (*multi_func)(const byte_span* msgs, uint8_t* out);
+typedef void (*multi_32_func)(const uint8_t* in, uint8_t* out);
+
+/***
+ * The widest kernel the CPU can run
+ */
+struct kernel
+{
+   kernel() : lanes(1), multi(nullptr), multi_32(nullptr), ripemd_32(nullptr), d64(nullptr), name("scalar")
+   {
+#if defined(ENABLE_AVX2) || defined(ENABLE_SSE41)
+      __builtin_cpu_init();
+#endif
+#ifdef ENABLE_AVX2
+      if (__builtin_cpu_supports("avx2"))
+      {
+         lanes = 8;
+         multi = avx2::sha256_8way;
+         multi_32 = avx2::sha256_32_8way;
+         ripemd_32 = avx2::ripemd160_32_8way;
+         d64 = avx2::sha256d64_8way;
+         name = "avx2(8-way)";
+         return;
+      }
+#endif
+#ifdef ENABLE_SSE41
+      if (__builtin_cpu_supports("sse4.1"))
+      {
+         lanes = 4;
+         multi = sse41::sha256_4way;
+         multi_32 = sse41::sha256_32_4way;
+         ripemd_32 = sse41::ripemd160_32_4way;
+         d64 = sse41::sha256d64_4way;
+         name = "sse4.1(4-way)";
+      }
+#endif
+   }
+   size_t lanes;
+   multi_func multi;
+   multi_32_func multi_32;
+   multi_32_func ripemd_32;
+   multi_32_func d64;
+   const char* name;
+};
+
+const kernel& get_kernel()
+{
+   static const kernel k;
+   return k;
+}
+
+size_t block_count(size_t len)
+{
+   return (len + 9 + 63) / 64;
+}
+
+/***
+ * Hash messages with the SIMD kernel, leaving the remainder to OpenSSL
+ */
+void hash_batch(span<const byte_span> messages, span<digest256> digests)
+{
+   if (digests.size() < messages.size())
+      throw std::invalid_argument("not enough room for digests");
+   const kernel& k = get_kernel();
+   size_t count = messages.size();
+   if (k.multi == nullptr || count < k.lanes)
+   {
+      for(size_t i = 0; i < count; ++i)
+         sha256(messages[i], digests[i].data());
+      return;
+   }
+   // group messages of the same number of blocks so that lanes finish together
+   std::vector<uint32_t> order(count);
+   for(size_t i = 0; i < count; ++i)
+      order[i] = i;
+   std::stable_sort(order.begin(), order.end(), [&messages](uint32_t a, uint32_t b)
+         { return block_count(messages[a].size()) < block_count(messages[b].size()); } );
+   byte_span group[8];
+   uint8_t out[8 * 32];
+   size_t pos = 0;
+   for(; pos + k.lanes <= count; pos += k.lanes)
+   {
+      for(size_t l = 0; l < k.lanes; ++l)
+         group[l] = messages[order[pos + l]];
+      k.multi(group, out);
+      for(size_t l = 0; l < k.lanes; ++l)
+         std::copy(out + l * 32, out + l * 32 + 32, digests[order[pos + l]].begin());
+   }
+   for(; pos < count; ++pos)
+      sha256(messages[order[pos]], digests[order[pos]].data());
+}
+
+} // namespace
+
+void sha256(byte_span message, uint8_t* digest)
+{
+   SHA256(message.data(), message.size(), digest);
+}
+
+void sha256d(byte_span message, uint8_t* digest)
+{
+   uint8_t first[SHA256_DIGEST_LENGTH];
+   SHA256(message.data(), message.size(), first);
+   SHA256(first, SHA256_DIGEST_LENGTH, digest);
+}
+
+sha256_context& sha256_context::write_le(uint64_t value, size_t size)
+{
+   uint8_t bytes[8];
+   for(size_t i = 0; i < size; ++i)
+      bytes[i] = (uint8_t)(value >> (8 * i));
+   SHA256_Update(&ctx, bytes, size);
+   return *this;
+}
+
+void sha256_context::finalize_double(uint8_t* digest)
+{
+   uint8_t first[SHA256_DIGEST_LENGTH];
+   SHA256_Final(first, &ctx);
+   SHA256(first, SHA256_DIGEST_LENGTH, digest);
+}
+
+void sha256_batch(span<const byte_span> messages, span<digest256> digests)
+{
+   hash_batch(messages, digests);
+}
+
+void sha256d_batch(span<const byte_span> messages, span<digest256> digests)
+{
+   hash_batch(messages, digests);
+   // the second round is one block per message, so it always fills the lanes
+   const kernel& k = get_kernel();
+   size_t count = messages.size();
+   size_t pos = 0;
+   if (k.multi_32 != nullptr)
+   {
+      for(; pos + k.lanes <= count; pos += k.lanes)
+         k.multi_32(digests[pos].data(), digests[pos].data());
+   }
+   for(; pos < count; ++pos)
+      SHA256(digests[pos].data(), 32, digests[pos].data());
+}
+
+void sha256d64(uint8_t* out, const uint8_t* in, size_t blocks)
+{
+   const kernel& k = get_kernel();
+   size_t pos = 0;
+   if (k.d64 != nullptr)
+   {
+      for(; pos + k.lanes <= blocks; pos += k.lanes)
+         k.d64(in + pos * 64, out + pos * 32);
+   }
+   for(; pos < blocks; ++pos)
+      sha256d(byte_span(in + pos * 64, 64), out + pos * 32);
+}
+
+void hash160(byte_span message, digest160& digest)
+{
+   uint8_t first[SHA256_DIGEST_LENGTH];
+   SHA256(message.data(), message.size(), first);
+   lanes::ripemd160_32_multi<scalar_lane>(first, digest.data());
+}
+
+digest160 hash160(byte_span message)
+{
+   digest160 ret_val;
+   hash160(message, ret_val);
+   return ret_val;
+}
+
+void hash160_batch(span<const byte_span> messages, span<digest160> digests)
+{
+   if (digests.size() < messages.size())
+      throw std::invalid_argument("not enough room for digests");
+   const kernel& k = get_kernel();
+   // SHA-256 a chunk of messages, then RIPEMD-160 the chunk while it is still in cache
+   const size_t chunk = 64;
+   digest256 first[chunk];
+   for(size_t start = 0; start < messages.size(); start += chunk)
+   {
+      size_t count = std::min(chunk, messages.size() - start);
+      hash_batch(messages.subspan(start, count), span<digest256>(first, count));
+      size_t pos = 0;
+      if (k.ripemd_32 != nullptr)
+      {
+         uint8_t out[8 * 20];
+         for(; pos + k.lanes <= count; pos += k.lanes)
+         {
+            k.ripemd_32(first[pos].data(), out);
+            for(size_t l = 0; l < k.lanes; ++l)
+               std::copy(out + l * 20, out + l * 20 + 20, digests[start + pos + l].begin());
+         }
+      }
+      for(; pos < count; ++pos)
+         lanes::ripemd160_32_multi<scalar_lane>(first[pos].data(), digests[start + pos].data());
+   }
+}
+
+std::string sha256_implementation()
+{
+   return get_kernel().name;
+}
+
+} // namespace bc_toolbox
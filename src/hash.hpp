@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <cstdint>
+
+#include <openssl/sha.h>
+
+#include <span.hpp>
+
+namespace bc_toolbox {
+
+   typedef std::array<uint8_t, 32> digest256;
+   typedef std::array<uint8_t, 20> digest160;
+
+   /***
+    * @brief SHA-256 of a message
+    * @param message the bytes to hash
+    * @param digest where to write the 32 byte result
+    */
+   void sha256(byte_span message, uint8_t* digest);
+   /***
+    * @brief SHA-256 of SHA-256 of a message (as used for txids and block hashes)
+    * @param message the bytes to hash
+    * @param digest where to write the 32 byte result
+    */
+   void sha256d(byte_span message, uint8_t* digest);
+
+   /*****
+    * An incremental SHA-256. Copying one copies its state, so the state
+    * after a shared prefix (a midstate) can be kept and reused for many
+    * messages that start with it.
+    */
+   class sha256_context
+   {
+      public:
+         sha256_context() { SHA256_Init(&ctx); }
+         sha256_context& write(byte_span bytes)
+         {
+            SHA256_Update(&ctx, bytes.data(), bytes.size());
+            return *this;
+         }
+         /***
+          * @brief write an integer as size little-endian bytes
+          */
+         sha256_context& write_le(uint64_t value, size_t size);
+         /***
+          * @brief finish the hash. The context may not be written to afterwards.
+          * @param digest where to write the 32 byte result
+          */
+         void finalize(uint8_t* digest) { SHA256_Final(digest, &ctx); }
+         /***
+          * @brief finish the hash, and hash the result again (as sha256d does)
+          */
+         void finalize_double(uint8_t* digest);
+      private:
+         SHA256_CTX ctx;
+   };
+
+   /******
+    * Hash many independent messages. Messages are hashed several at a time
+    * in SIMD lanes (8 with AVX2, 4 with SSE4.1) when the CPU supports it.
+    * Messages of similar length share lanes best.
+    * @param messages the messages to hash
+    * @param digests where to write the results, one per message
+    * @throws std::invalid_argument if there are fewer digests than messages
+    */
+   void sha256_batch(span<const byte_span> messages, span<digest256> digests);
+   /******
+    * Double SHA-256 of many independent messages
+    * @see sha256_batch
+    */
+   void sha256d_batch(span<const byte_span> messages, span<digest256> digests);
+
+   /******
+    * Double SHA-256 of consecutive 64 byte blocks, such as pairs of merkle
+    * nodes. Several blocks are hashed at once in SIMD lanes.
+    * @param out where to write blocks * 32 bytes. May be the same as in,
+    * in which case the digests replace the first half of the input
+    * @param in blocks * 64 bytes
+    * @param blocks the number of blocks
+    */
+   void sha256d64(uint8_t* out, const uint8_t* in, size_t blocks);
+
+   /***
+    * @brief RIPEMD-160 of SHA-256 of a message (a pubkey or script hash),
+    * computed without touching the heap
+    * @param message the bytes to hash
+    * @param digest where to write the result
+    */
+   void hash160(byte_span message, digest160& digest);
+   digest160 hash160(byte_span message);
+   /******
+    * HASH160 of many independent messages. Each group of SHA-256 lanes
+    * feeds straight into a group of RIPEMD-160 lanes.
+    * @param messages the messages to hash
+    * @param digests where to write the results, one per message
+    * @throws std::invalid_argument if there are fewer digests than messages
+    */
+   void hash160_batch(span<const byte_span> messages, span<digest160> digests);
+
+   /***
+    * @returns a description of the SIMD implementation in use
+    */
+   std::string sha256_implementation();
+
+}
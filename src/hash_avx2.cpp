@@ -0,0 +1,58 @@
+#ifdef ENABLE_AVX2
+
+#include <immintrin.h>
+
+#include "hash_lanes.hpp"
+
+namespace bc_toolbox {
+namespace {
+
+/***
+ * 8 lanes of 32 bit words
+ */
+struct avx2_lanes
+{
+   static const size_t count = 8;
+   __m256i v;
+   static avx2_lanes splat(uint32_t x) { avx2_lanes r; r.v = _mm256_set1_epi32(x); return r; }
+   static avx2_lanes load(const uint32_t* x) { avx2_lanes r; r.v = _mm256_loadu_si256((const __m256i*)x); return r; }
+};
+
+inline avx2_lanes make(__m256i v) { avx2_lanes r; r.v = v; return r; }
+inline avx2_lanes add(avx2_lanes a, avx2_lanes b) { return make(_mm256_add_epi32(a.v, b.v)); }
+inline avx2_lanes xor_(avx2_lanes a, avx2_lanes b) { return make(_mm256_xor_si256(a.v, b.v)); }
+inline avx2_lanes and_(avx2_lanes a, avx2_lanes b) { return make(_mm256_and_si256(a.v, b.v)); }
+inline avx2_lanes or_(avx2_lanes a, avx2_lanes b) { return make(_mm256_or_si256(a.v, b.v)); }
+inline avx2_lanes andnot(avx2_lanes a, avx2_lanes b) { return make(_mm256_andnot_si256(a.v, b.v)); }
+inline avx2_lanes shl(avx2_lanes a, int n) { return make(_mm256_slli_epi32(a.v, n)); }
+inline avx2_lanes shr(avx2_lanes a, int n) { return make(_mm256_srli_epi32(a.v, n)); }
+inline void store(uint32_t* out, avx2_lanes a) { _mm256_storeu_si256((__m256i*)out, a.v); }
+
+} // namespace
+
+namespace avx2 {
+
+void sha256_8way(const byte_span* msgs, uint8_t* out)
+{
+   lanes::sha256_multi<avx2_lanes>(msgs, out);
+}
+
+void sha256_32_8way(const uint8_t* in, uint8_t* out)
+{
+   lanes::sha256_32_multi<avx2_lanes>(in, out);
+}
+
+void sha256d64_8way(const uint8_t* in, uint8_t* out)
+{
+   lanes::sha256d64_multi<avx2_lanes>(in, out);
+}
+
+void ripemd160_32_8way(const uint8_t* in, uint8_t* out)
+{
+   lanes::ripemd160_32_multi<avx2_lanes>(in, out);
+}
+
+} // namespace avx2
+} // namespace bc_toolbox
+
+#endif // ENABLE_AVX2
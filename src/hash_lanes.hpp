@@ -0,0 +1,362 @@
+#pragma once
+
+/*****
+ * Multi-lane hash kernels, shared by the SIMD translation units.
+ *
+ * Each lane hashes an independent message. The including file must first
+ * define a lane type V with:
+ *   static members count (the number of lanes), splat(uint32_t) and
+ *   load(const uint32_t*) (one word per lane)
+ *   free functions add, xor_, and_, or_, andnot (~a & b), shl, shr and
+ *   store(uint32_t*, V), found by argument dependent lookup
+ * This header is an implementation detail; use hash.hpp instead.
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include <span.hpp>
+
+namespace bc_toolbox {
+namespace lanes {
+// Internal linkage: this header is compiled with different instruction
+// set flags in each including file, and the linker must not merge one
+// file's copy of a function into another's.
+namespace {
+
+static const uint32_t sha256_k[64] = {
+   0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+   0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+   0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+   0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+   0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+   0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+   0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+   0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t sha256_init[8] = {
+   0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+inline uint32_t read_be32(const uint8_t* p)
+{
+   return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+inline void write_be32(uint8_t* p, uint32_t val)
+{
+   p[0] = val >> 24;
+   p[1] = val >> 16;
+   p[2] = val >> 8;
+   p[3] = val;
+}
+
+inline void write_le32(uint8_t* p, uint32_t val)
+{
+   p[0] = val;
+   p[1] = val >> 8;
+   p[2] = val >> 16;
+   p[3] = val >> 24;
+}
+
+template <typename V> inline V rotr(V x, int n) { return or_(shr(x, n), shl(x, 32 - n)); }
+template <typename V> inline V rotl(V x, int n) { return or_(shl(x, n), shr(x, 32 - n)); }
+
+/***
+ * One SHA-256 compression of a 64 byte block in every lane
+ * @param s the state of each lane (updated)
+ * @param w the 16 message words of each lane (clobbered)
+ */
+template <typename V>
+void sha256_compress(V* s, V* w)
+{
+   V a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+   for(int i = 0; i < 64; ++i)
+   {
+      V wi;
+      if (i < 16)
+         wi = w[i];
+      else
+      {
+         V w15 = w[(i - 15) & 15];
+         V w2 = w[(i - 2) & 15];
+         V s0 = xor_(xor_(rotr(w15, 7), rotr(w15, 18)), shr(w15, 3));
+         V s1 = xor_(xor_(rotr(w2, 17), rotr(w2, 19)), shr(w2, 10));
+         wi = add(add(w[i & 15], s0), add(w[(i - 7) & 15], s1));
+         w[i & 15] = wi;
+      }
+      V sig1 = xor_(xor_(rotr(e, 6), rotr(e, 11)), rotr(e, 25));
+      V ch = xor_(and_(e, f), andnot(e, g));
+      V t1 = add(add(add(h, sig1), add(ch, V::splat(sha256_k[i]))), wi);
+      V sig0 = xor_(xor_(rotr(a, 2), rotr(a, 13)), rotr(a, 22));
+      V maj = or_(and_(a, b), and_(c, or_(a, b)));
+      V t2 = add(sig0, maj);
+      h = g; g = f; f = e; e = add(d, t1);
+      d = c; c = b; b = a; a = add(t1, t2);
+   }
+   s[0] = add(s[0], a); s[1] = add(s[1], b); s[2] = add(s[2], c); s[3] = add(s[3], d);
+   s[4] = add(s[4], e); s[5] = add(s[5], f); s[6] = add(s[6], g); s[7] = add(s[7], h);
+}
+
+/***
+ * The blocks of one message, including the padding
+ */
+struct padded_message
+{
+   void init(byte_span msg)
+   {
+      data = msg.data();
+      full_blocks = msg.size() / 64;
+      size_t rest = msg.size() % 64;
+      // the rest of the message, 0x80, zeros and the bit length
+      std::memset(tail, 0, sizeof(tail));
+      if (rest > 0)
+         std::memcpy(tail, data + full_blocks * 64, rest);
+      tail[rest] = 0x80;
+      size_t tail_len = (rest + 9 <= 64) ? 64 : 128;
+      uint64_t bits = (uint64_t)msg.size() * 8;
+      for(int i = 0; i < 8; ++i)
+         tail[tail_len - 1 - i] = (uint8_t)(bits >> (8 * i));
+      blocks = full_blocks + tail_len / 64;
+   }
+   const uint8_t* block(size_t pos) const
+   {
+      if (pos < full_blocks)
+         return data + pos * 64;
+      return tail + (pos - full_blocks) * 64;
+   }
+   const uint8_t* data;
+   size_t full_blocks;
+   size_t blocks;
+   uint8_t tail[128];
+};
+
+/***
+ * SHA-256 of V::count messages at once
+ * @param msgs the messages (V::count of them)
+ * @param out where to write V::count digests of 32 bytes each
+ */
+template <typename V>
+void sha256_multi(const byte_span* msgs, uint8_t* out)
+{
+   const size_t L = V::count;
+   static const uint8_t zero_block[64] = {0};
+   padded_message padded[L];
+   size_t max_blocks = 0;
+   for(size_t l = 0; l < L; ++l)
+   {
+      padded[l].init(msgs[l]);
+      if (padded[l].blocks > max_blocks)
+         max_blocks = padded[l].blocks;
+   }
+   V s[8];
+   for(int i = 0; i < 8; ++i)
+      s[i] = V::splat(sha256_init[i]);
+   uint32_t words[L];
+   for(size_t b = 0; b < max_blocks; ++b)
+   {
+      const uint8_t* blocks[L];
+      for(size_t l = 0; l < L; ++l)
+         blocks[l] = (b < padded[l].blocks ? padded[l].block(b) : zero_block);
+      V w[16];
+      for(int i = 0; i < 16; ++i)
+      {
+         for(size_t l = 0; l < L; ++l)
+            words[l] = read_be32(blocks[l] + i * 4);
+         w[i] = V::load(words);
+      }
+      sha256_compress(s, w);
+      // lanes that just finished
+      for(int i = 0; i < 8; ++i)
+      {
+         store(words, s[i]);
+         for(size_t l = 0; l < L; ++l)
+            if (padded[l].blocks == b + 1)
+               write_be32(out + l * 32 + i * 4, words[l]);
+      }
+   }
+}
+
+/***
+ * SHA-256 of V::count 32 byte messages (one padded block each)
+ * @param in V::count messages of 32 bytes, laid out one after the other
+ * @param out V::count digests (may be the same buffer as in)
+ */
+template <typename V>
+void sha256_32_multi(const uint8_t* in, uint8_t* out)
+{
+   const size_t L = V::count;
+   uint32_t words[L];
+   V w[16];
+   for(int i = 0; i < 8; ++i)
+   {
+      for(size_t l = 0; l < L; ++l)
+         words[l] = read_be32(in + l * 32 + i * 4);
+      w[i] = V::load(words);
+   }
+   w[8] = V::splat(0x80000000);
+   for(int i = 9; i < 15; ++i)
+      w[i] = V::splat(0);
+   w[15] = V::splat(256);
+   V s[8];
+   for(int i = 0; i < 8; ++i)
+      s[i] = V::splat(sha256_init[i]);
+   sha256_compress(s, w);
+   for(int i = 0; i < 8; ++i)
+   {
+      store(words, s[i]);
+      for(size_t l = 0; l < L; ++l)
+         write_be32(out + l * 32 + i * 4, words[l]);
+   }
+}
+
+/***
+ * Double SHA-256 of V::count 64 byte messages, such as a pair of merkle nodes
+ * @param in V::count messages of 64 bytes, laid out one after the other
+ * @param out V::count digests of 32 bytes (may overlap the start of in)
+ */
+template <typename V>
+void sha256d64_multi(const uint8_t* in, uint8_t* out)
+{
+   const size_t L = V::count;
+   uint32_t words[L];
+   V w[16];
+   for(int i = 0; i < 16; ++i)
+   {
+      for(size_t l = 0; l < L; ++l)
+         words[l] = read_be32(in + l * 64 + i * 4);
+      w[i] = V::load(words);
+   }
+   V s[8];
+   for(int i = 0; i < 8; ++i)
+      s[i] = V::splat(sha256_init[i]);
+   sha256_compress(s, w);
+   // the padding block of a 64 byte message
+   w[0] = V::splat(0x80000000);
+   for(int i = 1; i < 15; ++i)
+      w[i] = V::splat(0);
+   w[15] = V::splat(512);
+   sha256_compress(s, w);
+   // hash the 32 byte digest again
+   for(int i = 0; i < 8; ++i)
+      w[i] = s[i];
+   w[8] = V::splat(0x80000000);
+   for(int i = 9; i < 15; ++i)
+      w[i] = V::splat(0);
+   w[15] = V::splat(256);
+   for(int i = 0; i < 8; ++i)
+      s[i] = V::splat(sha256_init[i]);
+   sha256_compress(s, w);
+   for(int i = 0; i < 8; ++i)
+   {
+      store(words, s[i]);
+      for(size_t l = 0; l < L; ++l)
+         write_be32(out + l * 32 + i * 4, words[l]);
+   }
+}
+
+static const uint8_t ripemd_r[80] = {
+   0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+   7, 4, 13, 1, 10, 6, 15, 3, 12, 0, 9, 5, 2, 14, 11, 8,
+   3, 10, 14, 4, 9, 15, 8, 1, 2, 7, 0, 6, 13, 11, 5, 12,
+   1, 9, 11, 10, 0, 8, 12, 4, 13, 3, 7, 15, 14, 5, 6, 2,
+   4, 0, 5, 9, 7, 12, 2, 10, 14, 1, 3, 8, 11, 6, 15, 13
+};
+static const uint8_t ripemd_rp[80] = {
+   5, 14, 7, 0, 9, 2, 11, 4, 13, 6, 15, 8, 1, 10, 3, 12,
+   6, 11, 3, 7, 0, 13, 5, 10, 14, 15, 8, 12, 4, 9, 1, 2,
+   15, 5, 1, 3, 7, 14, 6, 9, 11, 8, 12, 2, 10, 0, 4, 13,
+   8, 6, 4, 1, 3, 11, 15, 0, 5, 12, 2, 13, 9, 7, 10, 14,
+   12, 15, 10, 4, 1, 5, 8, 7, 6, 2, 13, 14, 0, 3, 9, 11
+};
+static const uint8_t ripemd_s[80] = {
+   11, 14, 15, 12, 5, 8, 7, 9, 11, 13, 14, 15, 6, 7, 9, 8,
+   7, 6, 8, 13, 11, 9, 7, 15, 7, 12, 15, 9, 11, 7, 13, 12,
+   11, 13, 6, 7, 14, 9, 13, 15, 14, 8, 13, 6, 5, 12, 7, 5,
+   11, 12, 14, 15, 14, 15, 9, 8, 9, 14, 5, 6, 8, 6, 5, 12,
+   9, 15, 5, 11, 6, 8, 13, 12, 5, 12, 13, 14, 11, 8, 5, 6
+};
+static const uint8_t ripemd_sp[80] = {
+   8, 9, 9, 11, 13, 15, 15, 5, 7, 7, 8, 11, 14, 14, 12, 6,
+   9, 13, 15, 7, 12, 8, 9, 11, 7, 7, 12, 7, 6, 15, 13, 11,
+   9, 7, 15, 11, 8, 6, 6, 14, 12, 13, 5, 14, 13, 13, 7, 5,
+   15, 5, 8, 11, 14, 14, 6, 14, 6, 9, 12, 9, 12, 5, 15, 8,
+   8, 5, 12, 9, 12, 5, 14, 6, 8, 13, 6, 5, 15, 13, 11, 11
+};
+static const uint32_t ripemd_k[5] = { 0x00000000, 0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xa953fd4e };
+static const uint32_t ripemd_kp[5] = { 0x50a28be6, 0x5c4dd124, 0x6d703ef3, 0x7a6d76e9, 0x00000000 };
+static const uint32_t ripemd_init[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+
+/***
+ * The RIPEMD-160 boolean function of a round
+ */
+template <typename V>
+inline V ripemd_f(int round, V x, V y, V z)
+{
+   switch(round)
+   {
+      case 0: return xor_(xor_(x, y), z);
+      case 1: return or_(and_(x, y), andnot(x, z));
+      case 2: return xor_(or_(x, xor_(y, V::splat(0xffffffff))), z);
+      case 3: return or_(and_(x, z), andnot(z, y));
+      default: return xor_(x, or_(y, xor_(z, V::splat(0xffffffff))));
+   }
+}
+
+/***
+ * RIPEMD-160 of V::count 32 byte messages (one padded block each), which
+ * is the second half of HASH160
+ * @param in V::count messages of 32 bytes, laid out one after the other
+ * @param out V::count digests of 20 bytes
+ */
+template <typename V>
+void ripemd160_32_multi(const uint8_t* in, uint8_t* out)
+{
+   const size_t L = V::count;
+   uint32_t words[L];
+   V x[16];
+   for(int i = 0; i < 8; ++i)
+   {
+      for(size_t l = 0; l < L; ++l)
+      {
+         const uint8_t* p = in + l * 32 + i * 4;
+         words[l] = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+      }
+      x[i] = V::load(words);
+   }
+   x[8] = V::splat(0x80);
+   for(int i = 9; i < 16; ++i)
+      x[i] = V::splat(0);
+   x[14] = V::splat(256);
+   V a = V::splat(ripemd_init[0]), b = V::splat(ripemd_init[1]), c = V::splat(ripemd_init[2]);
+   V d = V::splat(ripemd_init[3]), e = V::splat(ripemd_init[4]);
+   V ap = a, bp = b, cp = c, dp = d, ep = e;
+   for(int j = 0; j < 80; ++j)
+   {
+      int round = j / 16;
+      V t = add(rotl(add(add(a, ripemd_f(round, b, c, d)), add(x[ripemd_r[j]], V::splat(ripemd_k[round]))),
+            ripemd_s[j]), e);
+      a = e; e = d; d = rotl(c, 10); c = b; b = t;
+      t = add(rotl(add(add(ap, ripemd_f(4 - round, bp, cp, dp)), add(x[ripemd_rp[j]], V::splat(ripemd_kp[round]))),
+            ripemd_sp[j]), ep);
+      ap = ep; ep = dp; dp = rotl(cp, 10); cp = bp; bp = t;
+   }
+   V h[5];
+   h[0] = add(add(V::splat(ripemd_init[1]), c), dp);
+   h[1] = add(add(V::splat(ripemd_init[2]), d), ep);
+   h[2] = add(add(V::splat(ripemd_init[3]), e), ap);
+   h[3] = add(add(V::splat(ripemd_init[4]), a), bp);
+   h[4] = add(add(V::splat(ripemd_init[0]), b), cp);
+   for(int i = 0; i < 5; ++i)
+   {
+      store(words, h[i]);
+      for(size_t l = 0; l < L; ++l)
+         write_le32(out + l * 20 + i * 4, words[l]);
+   }
+}
+
+} // namespace
+} // namespace lanes
+} // namespace bc_toolbox
@@ -0,0 +1,58 @@
+#ifdef ENABLE_SSE41
+
+#include <immintrin.h>
+
+#include "hash_lanes.hpp"
+
+namespace bc_toolbox {
+namespace {
+
+/***
+ * 4 lanes of 32 bit words
+ */
+struct sse_lanes
+{
+   static const size_t count = 4;
+   __m128i v;
+   static sse_lanes splat(uint32_t x) { sse_lanes r; r.v = _mm_set1_epi32(x); return r; }
+   static sse_lanes load(const uint32_t* x) { sse_lanes r; r.v = _mm_loadu_si128((const __m128i*)x); return r; }
+};
+
+inline sse_lanes make(__m128i v) { sse_lanes r; r.v = v; return r; }
+inline sse_lanes add(sse_lanes a, sse_lanes b) { return make(_mm_add_epi32(a.v, b.v)); }
+inline sse_lanes xor_(sse_lanes a, sse_lanes b) { return make(_mm_xor_si128(a.v, b.v)); }
+inline sse_lanes and_(sse_lanes a, sse_lanes b) { return make(_mm_and_si128(a.v, b.v)); }
+inline sse_lanes or_(sse_lanes a, sse_lanes b) { return make(_mm_or_si128(a.v, b.v)); }
+inline sse_lanes andnot(sse_lanes a, sse_lanes b) { return make(_mm_andnot_si128(a.v, b.v)); }
+inline sse_lanes shl(sse_lanes a, int n) { return make(_mm_slli_epi32(a.v, n)); }
+inline sse_lanes shr(sse_lanes a, int n) { return make(_mm_srli_epi32(a.v, n)); }
+inline void store(uint32_t* out, sse_lanes a) { _mm_storeu_si128((__m128i*)out, a.v); }
+
+} // namespace
+
+namespace sse41 {
+
+void sha256_4way(const byte_span* msgs, uint8_t* out)
+{
+   lanes::sha256_multi<sse_lanes>(msgs, out);
+}
+
+void sha256_32_4way(const uint8_t* in, uint8_t* out)
+{
+   lanes::sha256_32_multi<sse_lanes>(in, out);
+}
+
+void sha256d64_4way(const uint8_t* in, uint8_t* out)
+{
+   lanes::sha256d64_multi<sse_lanes>(in, out);
+}
+
+void ripemd160_32_4way(const uint8_t* in, uint8_t* out)
+{
+   lanes::ripemd160_32_multi<sse_lanes>(in, out);
+}
+
+} // namespace sse41
+} // namespace bc_toolbox
+
+#endif // ENABLE_SSE41
@@ -0,0 +1,186 @@
+#include <stdexcept>
+
+#include <hex.hpp>
+
+namespace bc_toolbox {
+
+#ifdef ENABLE_SSSE3
+namespace ssse3 {
+   size_t hex_encode_16(const uint8_t* in, size_t len, char* out, bool reversed);
+   size_t hex_decode_16(const char* in, size_t len, uint8_t* out, bool reversed);
+}
+#endif
+#ifdef ENABLE_AVX2
+namespace avx2 {
+   size_t hex_encode_32(const uint8_t* in, size_t len, char* out, bool reversed);
+   size_t hex_decode_32(const char* in, size_t len, uint8_t* out, bool reversed);
+}
+#endif
+
+namespace {
+
+const char digits[] = "0123456789abcdef";
+
+/***
+ * Maps a character to its value, or 0xff if it is not hex
+ */
+struct decode_table
+{
+   decode_table()
+   {
+      for(int i = 0; i < 256; ++i)
+         value[i] = 0xff;
+      for(int i = 0; i < 10; ++i)
+         value['0' + i] = i;
+      for(int i = 0; i < 6; ++i)
+      {
+         value['a' + i] = 10 + i;
+         value['A' + i] = 10 + i;
+      }
+   }
+   uint8_t value[256];
+};
+
+const decode_table table;
+
+typedef size_t (*encode_func)(const uint8_t* in, size_t len, char* out, bool reversed);
+typedef size_t (*decode_func)(const char* in, size_t len, uint8_t* out, bool reversed);
+
+/***
+ * The widest kernel the CPU can run. Kernels convert whole blocks and
+ * return how many bytes they did; the rest is done here.
+ */
+struct kernel
+{
+   kernel() : encode(nullptr), decode(nullptr), name("table")
+   {
+#if defined(ENABLE_AVX2) || defined(ENABLE_SSSE3)
+      __builtin_cpu_init();
+#endif
+#ifdef ENABLE_AVX2
+      if (__builtin_cpu_supports("avx2"))
+      {
+         encode = avx2::hex_encode_32;
+         decode = avx2::hex_decode_32;
+         name = "avx2";
+         return;
+      }
+#endif
+#ifdef ENABLE_SSSE3
+      if (__builtin_cpu_supports("ssse3"))
+      {
+         encode = ssse3::hex_encode_16;
+         decode = ssse3::hex_decode_16;
+         name = "ssse3";
+      }
+#endif
+   }
+   encode_func encode;
+   decode_func decode;
+   const char* name;
+};
+
+const kernel& get_kernel()
+{
+   static const kernel k;
+   return k;
+}
+
+size_t encode(byte_span in, span<char> out, bool reversed)
+{
+   size_t len = in.size();
+   if (out.size() < len * 2)
+      throw std::invalid_argument("not enough room for hex characters");
+   const kernel& k = get_kernel();
+   size_t pos = 0;
+   if (k.encode != nullptr)
+      pos = k.encode(in.data(), len, out.data(), reversed);
+   for(; pos < len; ++pos)
+   {
+      uint8_t val = in[reversed ? len - 1 - pos : pos];
+      out[pos * 2] = digits[val >> 4];
+      out[pos * 2 + 1] = digits[val & 0x0f];
+   }
+   return len * 2;
+}
+
+size_t decode(char_span in, mutable_byte_span out, bool reversed)
+{
+   if (in.size() % 2 != 0)
+      throw std::invalid_argument("odd number of hex characters");
+   size_t len = in.size() / 2;
+   if (out.size() < len)
+      throw std::invalid_argument("not enough room for bytes");
+   const kernel& k = get_kernel();
+   size_t pos = 0;
+   // the kernel stops at the block with a bad character, which is then found below
+   if (k.decode != nullptr)
+      pos = k.decode(in.data(), len, out.data(), reversed);
+   for(; pos < len; ++pos)
+   {
+      uint8_t hi = table.value[(uint8_t)in[pos * 2]];
+      uint8_t lo = table.value[(uint8_t)in[pos * 2 + 1]];
+      if (hi > 15 || lo > 15)
+         throw std::invalid_argument("invalid hex character at position "
+               + std::to_string(hi > 15 ? pos * 2 : pos * 2 + 1));
+      out[reversed ? len - 1 - pos : pos] = (hi << 4) | lo;
+   }
+   return len;
+}
+
+} // namespace
+
+size_t hex_encode(byte_span in, span<char> out)
+{
+   return encode(in, out, false);
+}
+
+size_t hex_encode_reversed(byte_span in, span<char> out)
+{
+   return encode(in, out, true);
+}
+
+size_t hex_decode(char_span in, mutable_byte_span out)
+{
+   return decode(in, out, false);
+}
+
+size_t hex_decode_reversed(char_span in, mutable_byte_span out)
+{
+   return decode(in, out, true);
+}
+
+std::string to_hex(byte_span in)
+{
+   std::string ret_val(in.size() * 2, '\0');
+   encode(in, span<char>(&ret_val[0], ret_val.size()), false);
+   return ret_val;
+}
+
+std::string to_hex_reversed(byte_span in)
+{
+   std::string ret_val(in.size() * 2, '\0');
+   encode(in, span<char>(&ret_val[0], ret_val.size()), true);
+   return ret_val;
+}
+
+std::vector<uint8_t> from_hex(char_span in)
+{
+   std::vector<uint8_t> ret_val(in.size() / 2);
+   decode(in, ret_val, false);
+   return ret_val;
+}
+
+std::vector<uint8_t> from_hex_reversed(char_span in)
+{
+   std::vector<uint8_t> ret_val(in.size() / 2);
+   decode(in, ret_val, true);
+   return ret_val;
+}
+
+std::string hex_implementation()
+{
+   return get_kernel().name;
+}
+
+} // namespace bc_toolbox
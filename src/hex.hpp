@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <span.hpp>
+
+namespace bc_toolbox {
+
+   /******
+    * Hex encoding and decoding into caller supplied buffers. Long inputs are
+    * converted 16 (SSSE3) or 32 (AVX2) bytes at a time when the CPU supports it.
+    * Encoding produces lower case. Decoding accepts either case.
+    */
+
+   /***
+    * @brief convert bytes to hex
+    * @param in the bytes
+    * @param out where to write the characters (at least 2 * in.size(), not null terminated)
+    * @returns the number of characters written
+    * @throws std::invalid_argument if out is too small
+    */
+   size_t hex_encode(byte_span in, span<char> out);
+   /***
+    * @brief convert bytes to hex, last byte first (the way txids and block hashes are displayed)
+    * @see hex_encode
+    */
+   size_t hex_encode_reversed(byte_span in, span<char> out);
+   /***
+    * @brief convert hex to bytes
+    * @param in the characters
+    * @param out where to write the bytes (at least in.size() / 2)
+    * @returns the number of bytes written
+    * @throws std::invalid_argument if in has an odd length or a character that is
+    * not hex, or if out is too small
+    */
+   size_t hex_decode(char_span in, mutable_byte_span out);
+   /***
+    * @brief convert hex to bytes, writing the last byte first (to read a displayed txid)
+    * @see hex_decode
+    */
+   size_t hex_decode_reversed(char_span in, mutable_byte_span out);
+
+   std::string to_hex(byte_span in);
+   std::string to_hex_reversed(byte_span in);
+   std::vector<uint8_t> from_hex(char_span in);
+   std::vector<uint8_t> from_hex_reversed(char_span in);
+
+   /***
+    * @returns a description of the SIMD implementation in use
+    */
+   std::string hex_implementation();
+
+}
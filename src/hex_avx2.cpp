@@ -0,0 +1,101 @@
+#ifdef ENABLE_AVX2
+
+#include <cstddef>
+#include <cstdint>
+
+#include <immintrin.h>
+
+namespace bc_toolbox {
+namespace avx2 {
+
+namespace {
+
+inline __m256i reverse_bytes(__m256i v)
+{
+   const __m256i mask = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+         15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+   // reverse within each 128 bit lane, then swap the lanes
+   return _mm256_permute4x64_epi64(_mm256_shuffle_epi8(v, mask), 0x4e);
+}
+
+/***
+ * Convert 64 characters to 32 bytes
+ * @returns false if a character is not hex
+ */
+inline bool decode_block(const char* in, __m256i& out)
+{
+   const __m256i zero_minus_one = _mm256_set1_epi8('0' - 1);
+   const __m256i nine_plus_one = _mm256_set1_epi8('9' + 1);
+   const __m256i a_minus_one = _mm256_set1_epi8('a' - 1);
+   const __m256i f_plus_one = _mm256_set1_epi8('f' + 1);
+   __m256i nibbles[2];
+   for(int i = 0; i < 2; ++i)
+   {
+      // bytes above 0x7f are negative, so they fail both range checks
+      __m256i c = _mm256_loadu_si256((const __m256i*)(in + i * 32));
+      __m256i lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+      __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(c, zero_minus_one), _mm256_cmpgt_epi8(nine_plus_one, c));
+      __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, a_minus_one), _mm256_cmpgt_epi8(f_plus_one, lower));
+      if (_mm256_movemask_epi8(_mm256_or_si256(digit, alpha)) != -1)
+         return false;
+      nibbles[i] = _mm256_or_si256(
+            _mm256_and_si256(digit, _mm256_sub_epi8(c, _mm256_set1_epi8('0'))),
+            _mm256_and_si256(alpha, _mm256_sub_epi8(lower, _mm256_set1_epi8('a' - 10))));
+   }
+   // each pair of nibbles becomes hi * 16 + lo in a 16 bit word
+   const __m256i weights = _mm256_set1_epi16(0x0110);
+   __m256i packed = _mm256_packus_epi16(_mm256_maddubs_epi16(nibbles[0], weights),
+         _mm256_maddubs_epi16(nibbles[1], weights));
+   // packing works within lanes, so put the 64 bit pieces back in order
+   out = _mm256_permute4x64_epi64(packed, 0xd8);
+   return true;
+}
+
+} // namespace
+
+size_t hex_encode_32(const uint8_t* in, size_t len, char* out, bool reversed)
+{
+   const __m256i digits = _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+         '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+         '0', '1', '2', '3', '4', '5', '6', '7',
+         '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+   const __m256i low_nibble = _mm256_set1_epi8(0x0f);
+   size_t pos = 0;
+   for(; pos + 32 <= len; pos += 32)
+   {
+      __m256i v;
+      if (reversed)
+         v = reverse_bytes(_mm256_loadu_si256((const __m256i*)(in + len - pos - 32)));
+      else
+         v = _mm256_loadu_si256((const __m256i*)(in + pos));
+      __m256i hi = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibble));
+      __m256i lo = _mm256_shuffle_epi8(digits, _mm256_and_si256(v, low_nibble));
+      // interleaving works within lanes, so stitch the halves back together
+      __m256i first = _mm256_unpacklo_epi8(hi, lo);
+      __m256i second = _mm256_unpackhi_epi8(hi, lo);
+      _mm256_storeu_si256((__m256i*)(out + pos * 2), _mm256_permute2x128_si256(first, second, 0x20));
+      _mm256_storeu_si256((__m256i*)(out + pos * 2 + 32), _mm256_permute2x128_si256(first, second, 0x31));
+   }
+   return pos;
+}
+
+size_t hex_decode_32(const char* in, size_t len, uint8_t* out, bool reversed)
+{
+   size_t pos = 0;
+   for(; pos + 32 <= len; pos += 32)
+   {
+      __m256i v;
+      if (!decode_block(in + pos * 2, v))
+         break;
+      if (reversed)
+         _mm256_storeu_si256((__m256i*)(out + len - pos - 32), reverse_bytes(v));
+      else
+         _mm256_storeu_si256((__m256i*)(out + pos), v);
+   }
+   return pos;
+}
+
+} // namespace avx2
+} // namespace bc_toolbox
+
+#endif // ENABLE_AVX2
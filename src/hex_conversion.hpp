@@ -59,7 +59,8 @@ namespace bc_toolbox {
    unsigned const char OP_VERIFY = 0x69;
    unsigned const char OP_RETURN = 0x6a;
    // stack
-   unsigned const char OP_TOTALSTACK = 0x6b;
+   unsigned const char OP_TOALTSTACK = 0x6b;
+   unsigned const char OP_TOTALSTACK = 0x6b; // old misspelling of OP_TOALTSTACK
    unsigned const char OP_FROMALTSTACK = 0x6c;
    unsigned const char OP_IFDUP = 0x73; 
    unsigned const char OP_DEPTH = 0x74;
@@ -155,19 +156,31 @@ namespace bc_toolbox {
 
    // deal with integers
    std::pair<uint8_t, std::vector<uint8_t> > pack(int64_t incoming);
-   // convert opcodes to strings
+   /***
+    * @brief write a number the way script does (minimal little-endian, sign in the top bit)
+    * @param incoming the number
+    * @param out room for at least 9 bytes
+    * @returns the number of bytes written (0 for zero)
+    */
+   uint8_t write_script_number(int64_t incoming, uint8_t* out);
+   /***
+    * @brief convert an opcode to its name
+    * @see opcode_name in script_asm.hpp, which does not throw
+    * @throws std::invalid_argument if op_code is not an opcode
+    */
    std::string opcode_to_string(unsigned const char op_code);
    std::vector<uint8_t> sha256(std::string incoming);
    std::vector<uint8_t> sha256(std::vector<uint8_t> incoming);
    std::vector<uint8_t> ripemd160(std::vector<uint8_t> incoming);
    std::string base58check(std::vector<uint8_t> incoming);
-   // varint stuff
+   // varint stuff (see compact_size.hpp for the allocation-free, non-throwing codec)
    /***
     * @brief convert a big-endian number to bitcoin varint
     */
    std::vector<uint8_t> to_varint(uint64_t val);
    /****
     * @brief convert a bitcoin varint to a big-endian number
+    * @throws std::out_of_range if val is not exactly one canonical varint
     */
    uint64_t from_varint(std::vector<uint8_t> val);
 
@@ -176,8 +189,9 @@ namespace bc_toolbox {
     * @param input the stream of bytes as an array
     * @param bytes_read the number of bytes read from the array
     * @returns the integer (must be less than 64bit)
+    * @throws std::out_of_range if the varint is not canonical
     */
-   uint64_t from_varint(uint8_t* input, uint16_t &bytes_read);
+   uint64_t from_varint(const uint8_t* input, uint16_t &bytes_read);
 
    // endian
    /***
@@ -200,6 +214,8 @@ namespace bc_toolbox {
     * Example "0a0b0c" becomes { 0x0a, 0x0b, 0x0c }
     * @param input the incoming string
     * @returns the vector of bytes
+    * @throws std::invalid_argument if the length is odd or a character is not hex
+    * @see hex.hpp to convert into an existing buffer
     */
    std::vector<uint8_t> hex_string_to_vector(std::string input);
    std::string vector_to_hex_string(std::vector<uint8_t> in);
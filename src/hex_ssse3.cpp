@@ -0,0 +1,90 @@
+#ifdef ENABLE_SSSE3
+
+#include <cstddef>
+#include <cstdint>
+
+#include <immintrin.h>
+
+namespace bc_toolbox {
+namespace ssse3 {
+
+namespace {
+
+inline __m128i reverse_bytes(__m128i v)
+{
+   return _mm_shuffle_epi8(v, _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+}
+
+/***
+ * Convert 32 characters to 16 bytes
+ * @returns false if a character is not hex
+ */
+inline bool decode_block(const char* in, __m128i& out)
+{
+   const __m128i zero_minus_one = _mm_set1_epi8('0' - 1);
+   const __m128i nine_plus_one = _mm_set1_epi8('9' + 1);
+   const __m128i a_minus_one = _mm_set1_epi8('a' - 1);
+   const __m128i f_plus_one = _mm_set1_epi8('f' + 1);
+   __m128i nibbles[2];
+   for(int i = 0; i < 2; ++i)
+   {
+      // bytes above 0x7f are negative, so they fail both range checks
+      __m128i c = _mm_loadu_si128((const __m128i*)(in + i * 16));
+      __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+      __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, zero_minus_one), _mm_cmplt_epi8(c, nine_plus_one));
+      __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, a_minus_one), _mm_cmplt_epi8(lower, f_plus_one));
+      if (_mm_movemask_epi8(_mm_or_si128(digit, alpha)) != 0xffff)
+         return false;
+      nibbles[i] = _mm_or_si128(
+            _mm_and_si128(digit, _mm_sub_epi8(c, _mm_set1_epi8('0'))),
+            _mm_and_si128(alpha, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+   }
+   // each pair of nibbles becomes hi * 16 + lo in a 16 bit word
+   const __m128i weights = _mm_set1_epi16(0x0110);
+   out = _mm_packus_epi16(_mm_maddubs_epi16(nibbles[0], weights), _mm_maddubs_epi16(nibbles[1], weights));
+   return true;
+}
+
+} // namespace
+
+size_t hex_encode_16(const uint8_t* in, size_t len, char* out, bool reversed)
+{
+   const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+         '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+   const __m128i low_nibble = _mm_set1_epi8(0x0f);
+   size_t pos = 0;
+   for(; pos + 16 <= len; pos += 16)
+   {
+      __m128i v;
+      if (reversed)
+         v = reverse_bytes(_mm_loadu_si128((const __m128i*)(in + len - pos - 16)));
+      else
+         v = _mm_loadu_si128((const __m128i*)(in + pos));
+      __m128i hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(v, 4), low_nibble));
+      __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(v, low_nibble));
+      _mm_storeu_si128((__m128i*)(out + pos * 2), _mm_unpacklo_epi8(hi, lo));
+      _mm_storeu_si128((__m128i*)(out + pos * 2 + 16), _mm_unpackhi_epi8(hi, lo));
+   }
+   return pos;
+}
+
+size_t hex_decode_16(const char* in, size_t len, uint8_t* out, bool reversed)
+{
+   size_t pos = 0;
+   for(; pos + 16 <= len; pos += 16)
+   {
+      __m128i v;
+      if (!decode_block(in + pos * 2, v))
+         break;
+      if (reversed)
+         _mm_storeu_si128((__m128i*)(out + len - pos - 16), reverse_bytes(v));
+      else
+         _mm_storeu_si128((__m128i*)(out + pos), v);
+   }
+   return pos;
+}
+
+} // namespace ssse3
+} // namespace bc_toolbox
+
+#endif // ENABLE_SSSE3
@@ -0,0 +1,53 @@
+#include <stdexcept>
+
+#include <htlc.hpp>
+
+namespace bc_toolbox {
+
+namespace {
+
+template <size_t LocktimeBytes>
+size_t fill(const htlc_params& params, const uint8_t* locktime, mutable_byte_span out)
+{
+   typedef htlc_template<LocktimeBytes> layout;
+   if (out.size() < layout::size)
+      throw std::invalid_argument("not enough room for the HTLC script");
+   layout::fill(out.data(), params.hashlock, params.recipient_pubkey_hash, locktime,
+         params.sender_pubkey_hash);
+   return layout::size;
+}
+
+} // namespace
+
+size_t htlc_script_size(uint32_t locktime)
+{
+   uint8_t locktime_bytes[9];
+   uint8_t width = write_script_number(locktime, locktime_bytes);
+   if (width == 0)
+      throw std::invalid_argument("locktime must not be zero");
+   return htlc_template<1>::size - 1 + width;
+}
+
+size_t write_htlc_script(const htlc_params& params, mutable_byte_span out)
+{
+   uint8_t locktime[9];
+   switch(write_script_number(params.locktime, locktime))
+   {
+      case 1: return fill<1>(params, locktime, out);
+      case 2: return fill<2>(params, locktime, out);
+      case 3: return fill<3>(params, locktime, out);
+      case 4: return fill<4>(params, locktime, out);
+      case 5: return fill<5>(params, locktime, out);
+      default:
+         throw std::invalid_argument("locktime must not be zero");
+   }
+}
+
+std::vector<uint8_t> htlc_script(const htlc_params& params)
+{
+   std::vector<uint8_t> ret_val(htlc_script_size(params.locktime));
+   write_htlc_script(params, ret_val);
+   return ret_val;
+}
+
+} // namespace bc_toolbox
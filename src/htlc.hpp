@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+#include <hex_conversion.hpp>
+#include <hash.hpp>
+#include <span.hpp>
+
+namespace bc_toolbox {
+
+/*****
+ * The byte layout of a BIP199 HTLC script:
+ *
+ * OP_IF OP_HASH160 <hashlock> OP_EQUALVERIFY OP_DUP OP_HASH160 <recipient pubkey hash>
+ * OP_ELSE <locktime> OP_CHECKLOCKTIMEVERIFY OP_DROP OP_DUP OP_HASH160 <sender pubkey hash>
+ * OP_ENDIF OP_EQUALVERIFY OP_CHECKSIG
+ *
+ * Only the locktime changes length, so there is one layout per locktime
+ * width. The script is built once; making an HTLC copies it and patches
+ * the parameters in at fixed offsets.
+ */
+template <size_t LocktimeBytes>
+class htlc_template
+{
+   static_assert(LocktimeBytes >= 1 && LocktimeBytes <= 5, "a locktime is 1 to 5 bytes");
+   public:
+      static const size_t hashlock_offset = 3;
+      static const size_t recipient_offset = hashlock_offset + 20 + 4;
+      static const size_t locktime_offset = recipient_offset + 20 + 2;
+      static const size_t sender_offset = locktime_offset + LocktimeBytes + 5;
+      static const size_t size = sender_offset + 20 + 3;
+      typedef std::array<uint8_t, size> image_type;
+
+      /***
+       * @returns the script with zeros where the parameters go
+       */
+      static const image_type& image()
+      {
+         static const image_type ret_val = build();
+         return ret_val;
+      }
+
+      /***
+       * @brief write a script
+       * @param out where to write size bytes
+       * @param hashlock HASH160 of the preimage
+       * @param recipient HASH160 of the recipient's public key
+       * @param locktime the locktime in script number format (LocktimeBytes long)
+       * @param sender HASH160 of the sender's public key
+       */
+      static void fill(uint8_t* out, const digest160& hashlock, const digest160& recipient,
+            const uint8_t* locktime, const digest160& sender)
+      {
+         std::memcpy(out, image().data(), size);
+         std::memcpy(out + hashlock_offset, hashlock.data(), 20);
+         std::memcpy(out + recipient_offset, recipient.data(), 20);
+         std::memcpy(out + locktime_offset, locktime, LocktimeBytes);
+         std::memcpy(out + sender_offset, sender.data(), 20);
+      }
+
+   private:
+      static image_type build()
+      {
+         image_type ret_val;
+         ret_val.fill(0);
+         uint8_t* pos = ret_val.data();
+         *pos++ = OP_IF;
+         *pos++ = OP_HASH160;
+         *pos++ = 20;
+         pos += 20;
+         *pos++ = OP_EQUALVERIFY;
+         *pos++ = OP_DUP;
+         *pos++ = OP_HASH160;
+         *pos++ = 20;
+         pos += 20;
+         *pos++ = OP_ELSE;
+         *pos++ = LocktimeBytes;
+         pos += LocktimeBytes;
+         *pos++ = OP_CHECKLOCKTIMEVERIFY;
+         *pos++ = OP_DROP;
+         *pos++ = OP_DUP;
+         *pos++ = OP_HASH160;
+         *pos++ = 20;
+         pos += 20;
+         *pos++ = OP_ENDIF;
+         *pos++ = OP_EQUALVERIFY;
+         *pos++ = OP_CHECKSIG;
+         return ret_val;
+      }
+};
+
+template <size_t N> const size_t htlc_template<N>::hashlock_offset;
+template <size_t N> const size_t htlc_template<N>::recipient_offset;
+template <size_t N> const size_t htlc_template<N>::locktime_offset;
+template <size_t N> const size_t htlc_template<N>::sender_offset;
+template <size_t N> const size_t htlc_template<N>::size;
+
+/*****
+ * The parameters of an HTLC
+ */
+class htlc_params
+{
+   public:
+      digest160 hashlock; // HASH160 of the preimage
+      digest160 recipient_pubkey_hash; // can spend with the preimage
+      uint32_t locktime; // block height or timestamp for OP_CHECKLOCKTIMEVERIFY
+      digest160 sender_pubkey_hash; // can spend after the locktime
+};
+
+/***
+ * @param locktime the locktime
+ * @returns the size of the HTLC script for this locktime
+ * @throws std::invalid_argument if the locktime is zero
+ */
+size_t htlc_script_size(uint32_t locktime);
+/***
+ * @brief write an HTLC script
+ * @param params the parameters
+ * @param out where to write the script
+ * @returns the number of bytes written
+ * @throws std::invalid_argument if the locktime is zero or out is too small
+ */
+size_t write_htlc_script(const htlc_params& params, mutable_byte_span out);
+std::vector<uint8_t> htlc_script(const htlc_params& params);
+
+} // namespace bc_toolbox
@@ -0,0 +1,765 @@
+#include <cstring>
+#include <algorithm>
+
+#include <openssl/sha.h>
+#include <openssl/ripemd.h>
+
+#include <interpreter.hpp>
+#include <hex_conversion.hpp>
+#include <hash.hpp>
+#include <script_asm.hpp>
+
+namespace bc_toolbox {
+
+const size_t interpreter::max_script_size;
+const size_t interpreter::max_element_size;
+const size_t interpreter::max_ops;
+const size_t interpreter::max_stack_size;
+const size_t interpreter::max_pubkeys;
+
+namespace {
+
+/***
+ * Thrown inside eval to stop the script. Never escapes eval.
+ */
+class eval_failure
+{
+   public:
+      eval_failure(script_error error) : error(error) {}
+      script_error error;
+};
+
+// OP_1NEGATE, then OP_1 to OP_16
+const uint8_t small_numbers[] = { 0x81, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+const byte_span true_element(small_numbers + 1, 1);
+const byte_span false_element;
+
+/*****
+ * The IF/ELSE nesting, as a depth and the position of the first false
+ * branch (everything inside a false branch is skipped, so nothing more
+ * needs to be remembered)
+ */
+class condition_stack
+{
+   public:
+      condition_stack() : depth(0), first_false(none) {}
+      bool empty() const { return depth == 0; }
+      bool all_true() const { return first_false == none; }
+      void push(bool value)
+      {
+         if (first_false == none && !value)
+            first_false = depth;
+         ++depth;
+      }
+      void pop()
+      {
+         --depth;
+         if (first_false == depth)
+            first_false = none;
+      }
+      void toggle_top()
+      {
+         if (first_false == none)
+            first_false = depth - 1;
+         else if (first_false == depth - 1)
+            first_false = none;
+      }
+   private:
+      static const size_t none = (size_t)-1;
+      size_t depth;
+      size_t first_false;
+};
+
+int64_t to_number(byte_span bytes, bool require_minimal, size_t max_size = 4)
+{
+   size_t size = bytes.size();
+   if (size > max_size)
+      throw eval_failure(script_error::bad_number);
+   if (size == 0)
+      return 0;
+   // the top byte may only be 0x00 or 0x80 if the byte below needs its top bit
+   if (require_minimal && (bytes[size - 1] & 0x7f) == 0 && (size == 1 || (bytes[size - 2] & 0x80) == 0))
+      throw eval_failure(script_error::bad_number);
+   int64_t ret_val = 0;
+   for(size_t i = 0; i < size; ++i)
+      ret_val |= (int64_t)bytes[i] << (8 * i);
+   if (bytes[size - 1] & 0x80)
+      return -(ret_val & ~((int64_t)0x80 << (8 * (size - 1))));
+   return ret_val;
+}
+
+/***
+ * @returns true if the data was pushed with the shortest possible opcode
+ */
+bool is_minimal_push(byte_span data, uint8_t opcode)
+{
+   size_t size = data.size();
+   if (size == 0)
+      return opcode == OP_0;
+   if (size == 1 && ((data[0] >= 1 && data[0] <= 16) || data[0] == 0x81))
+      return false; // should have been OP_1 to OP_16 or OP_1NEGATE
+   if (size < OP_PUSHDATA1)
+      return opcode == size;
+   if (size <= 0xff)
+      return opcode == OP_PUSHDATA1;
+   if (size <= 0xffff)
+      return opcode == OP_PUSHDATA2;
+   return true;
+}
+
+bool equal(byte_span a, byte_span b)
+{
+   return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+} // namespace
+
+const char* script_error_string(script_error error)
+{
+   switch(error)
+   {
+      case script_error::ok: return "no error";
+      case script_error::eval_false: return "script evaluated to false";
+      case script_error::op_return: return "OP_RETURN was encountered";
+      case script_error::script_size: return "script is too big";
+      case script_error::push_size: return "push is too big";
+      case script_error::op_count: return "too many operations";
+      case script_error::stack_size: return "stack is too big";
+      case script_error::bad_opcode: return "bad opcode";
+      case script_error::disabled_opcode: return "disabled opcode";
+      case script_error::unbalanced_conditional: return "unbalanced conditional";
+      case script_error::invalid_stack_operation: return "operation not valid with the current stack size";
+      case script_error::invalid_altstack_operation: return "operation not valid with the current altstack size";
+      case script_error::verify: return "OP_VERIFY failed";
+      case script_error::equalverify: return "OP_EQUALVERIFY failed";
+      case script_error::numequalverify: return "OP_NUMEQUALVERIFY failed";
+      case script_error::checksigverify: return "OP_CHECKSIGVERIFY failed";
+      case script_error::checkmultisigverify: return "OP_CHECKMULTISIGVERIFY failed";
+      case script_error::bad_number: return "number is too long or not minimally encoded";
+      case script_error::minimal_data: return "data push is not minimal";
+      case script_error::pubkey_count: return "public key count out of range";
+      case script_error::sig_count: return "signature count out of range";
+      case script_error::sig_pushonly: return "scriptSig is not push only";
+      case script_error::negative_locktime: return "negative locktime";
+      case script_error::unsatisfied_locktime: return "locktime requirement not satisfied";
+      case script_error::clean_stack: return "stack is not clean";
+      case script_error::out_of_memory: return "interpreter arena is full";
+      case script_error::unsupported_witness: return "witness version is not supported";
+      case script_error::witness_program_wrong_length: return "witness program has the wrong length";
+      case script_error::witness_program_witness_empty: return "witness is empty";
+      case script_error::witness_program_mismatch: return "witness does not match the witness program";
+      case script_error::witness_malleated: return "witness spend has a scriptSig";
+      case script_error::witness_malleated_p2sh: return "P2SH witness spend has more than the program in its scriptSig";
+      case script_error::witness_unexpected: return "witness data for a non-witness spend";
+   }
+   return "unknown error";
+}
+
+bool cast_to_bool(byte_span element)
+{
+   for(size_t i = 0; i < element.size(); ++i)
+   {
+      if (element[i] != 0)
+         return !(i == element.size() - 1 && element[i] == 0x80);
+   }
+   return false;
+}
+
+bool dry_run_checker::check_locktime(int64_t locktime) const
+{
+   // both must be block heights, or both timestamps
+   const int64_t threshold = 500000000;
+   if ((tx_locktime < threshold) != (locktime < threshold))
+      return false;
+   if (locktime > tx_locktime)
+      return false;
+   // a final input disables the lock time
+   return input_sequence != 0xffffffff;
+}
+
+bool dry_run_checker::check_sequence(int64_t sequence) const
+{
+   const uint32_t disable_flag = 1U << 31;
+   const uint32_t type_flag = 1U << 22;
+   const uint32_t mask = type_flag | 0xffff;
+   if (tx_version < 2 || (input_sequence & disable_flag) != 0)
+      return false;
+   int64_t tx_masked = input_sequence & mask;
+   int64_t masked = sequence & mask;
+   if ((tx_masked < type_flag) != (masked < type_flag))
+      return false;
+   return masked <= tx_masked;
+}
+
+interpreter::interpreter(size_t arena_size) : arena(arena_size), arena_top(0)
+{
+   // room for the largest legal stacks, plus what one operation pushes
+   // before the size is checked
+   main_stack.reserve(max_stack_size + 4);
+   alt_stack.reserve(max_stack_size + 4);
+   saved_stack.reserve(max_stack_size + 4);
+}
+
+void interpreter::reset()
+{
+   main_stack.clear();
+   alt_stack.clear();
+   saved_stack.clear();
+   arena_top = 0;
+}
+
+bool interpreter::push(byte_span element)
+{
+   if (element.size() > max_element_size || main_stack.size() >= max_stack_size)
+      return false;
+   main_stack.push_back(element);
+   return true;
+}
+
+uint8_t* interpreter::allocate(size_t size)
+{
+   if (arena.size() - arena_top < size)
+      throw eval_failure(script_error::out_of_memory);
+   uint8_t* ret_val = arena.data() + arena_top;
+   arena_top += size;
+   return ret_val;
+}
+
+script_error interpreter::eval(byte_span script, const signature_checker& checker, uint32_t flags)
+{
+   if (script.size() > max_script_size)
+      return script_error::script_size;
+   const bool require_minimal = (flags & verify_minimal_data) != 0;
+   const uint8_t* pc = script.begin();
+   const uint8_t* end = script.end();
+   const uint8_t* code_begin = pc; // just after the last OP_CODESEPARATOR
+   size_t op_count = 0;
+   condition_stack conditions;
+   std::vector<byte_span>& stack = main_stack;
+   alt_stack.clear();
+
+   auto need = [&stack](size_t count)
+   {
+      if (stack.size() < count)
+         throw eval_failure(script_error::invalid_stack_operation);
+   };
+   // 1 is the top of the stack
+   auto top = [&stack](size_t pos) -> byte_span& { return stack[stack.size() - pos]; };
+   auto push_number = [&stack, this](int64_t value)
+   {
+      uint8_t buffer[9];
+      uint8_t width = write_script_number(value, buffer);
+      uint8_t* element = allocate(width);
+      std::memcpy(element, buffer, width);
+      stack.push_back(byte_span(element, width));
+   };
+   auto push_bool = [&stack](bool value) { stack.push_back(value ? true_element : false_element); };
+
+   try
+   {
+      while (pc < end)
+      {
+         const bool executing = conditions.all_true();
+         uint8_t opcode;
+         byte_span data;
+         if (!read_opcode(pc, end, opcode, data))
+            throw eval_failure(script_error::bad_opcode);
+         if (data.size() > max_element_size)
+            throw eval_failure(script_error::push_size);
+         if (opcode > OP_16 && ++op_count > max_ops)
+            throw eval_failure(script_error::op_count);
+         // disabled opcodes fail the script even in a branch that is not taken
+         if (opcode_table[opcode].disabled)
+            throw eval_failure(script_error::disabled_opcode);
+
+         if (executing && opcode <= OP_PUSHDATA4)
+         {
+            if (require_minimal && !is_minimal_push(data, opcode))
+               throw eval_failure(script_error::minimal_data);
+            stack.push_back(data);
+         }
+         else if (executing || (opcode >= OP_IF && opcode <= OP_ENDIF))
+         {
+            switch(opcode)
+            {
+               case OP_1NEGATE:
+               case OP_1: case OP_2: case OP_3: case OP_4: case OP_5: case OP_6: case OP_7: case OP_8:
+               case OP_9: case OP_10: case OP_11: case OP_12: case OP_13: case OP_14: case OP_15: case OP_16:
+                  stack.push_back(byte_span(small_numbers + (opcode == OP_1NEGATE ? 0 : opcode - OP_1 + 1), 1));
+                  break;
+
+               // control
+               case OP_NOP:
+               case OP_NOP1: case OP_NOP4: case OP_NOP5: case OP_NOP6:
+               case OP_NOP7: case OP_NOP8: case OP_NOP9: case OP_NOP10:
+                  break;
+               case OP_CHECKLOCKTIMEVERIFY:
+               {
+                  if ((flags & verify_checklocktimeverify) == 0)
+                     break;
+                  need(1);
+                  // 5 bytes, so that times up to 2^39 fit
+                  int64_t locktime = to_number(top(1), require_minimal, 5);
+                  if (locktime < 0)
+                     throw eval_failure(script_error::negative_locktime);
+                  if (!checker.check_locktime(locktime))
+                     throw eval_failure(script_error::unsatisfied_locktime);
+                  break;
+               }
+               case OP_CHECKSEQUENCEVERIFY:
+               {
+                  if ((flags & verify_checksequenceverify) == 0)
+                     break;
+                  need(1);
+                  int64_t sequence = to_number(top(1), require_minimal, 5);
+                  if (sequence < 0)
+                     throw eval_failure(script_error::negative_locktime);
+                  // with the disable flag set, it does nothing
+                  if ((sequence & (1LL << 31)) != 0)
+                     break;
+                  if (!checker.check_sequence(sequence))
+                     throw eval_failure(script_error::unsatisfied_locktime);
+                  break;
+               }
+               case OP_IF:
+               case OP_NOTIF:
+               {
+                  bool value = false;
+                  if (executing)
+                  {
+                     need(1);
+                     value = cast_to_bool(top(1));
+                     if (opcode == OP_NOTIF)
+                        value = !value;
+                     stack.pop_back();
+                  }
+                  conditions.push(value);
+                  break;
+               }
+               case OP_ELSE:
+                  if (conditions.empty())
+                     throw eval_failure(script_error::unbalanced_conditional);
+                  conditions.toggle_top();
+                  break;
+               case OP_ENDIF:
+                  if (conditions.empty())
+                     throw eval_failure(script_error::unbalanced_conditional);
+                  conditions.pop();
+                  break;
+               case OP_VERIFY:
+                  need(1);
+                  if (!cast_to_bool(top(1)))
+                     throw eval_failure(script_error::verify);
+                  stack.pop_back();
+                  break;
+               case OP_RETURN:
+                  throw eval_failure(script_error::op_return);
+
+               // stack
+               case OP_TOALTSTACK:
+                  need(1);
+                  alt_stack.push_back(top(1));
+                  stack.pop_back();
+                  break;
+               case OP_FROMALTSTACK:
+                  if (alt_stack.empty())
+                     throw eval_failure(script_error::invalid_altstack_operation);
+                  stack.push_back(alt_stack.back());
+                  alt_stack.pop_back();
+                  break;
+               case OP_2DROP:
+                  need(2);
+                  stack.pop_back();
+                  stack.pop_back();
+                  break;
+               case OP_2DUP:
+               {
+                  need(2);
+                  byte_span a = top(2);
+                  byte_span b = top(1);
+                  stack.push_back(a);
+                  stack.push_back(b);
+                  break;
+               }
+               case OP_3DUP:
+               {
+                  need(3);
+                  byte_span a = top(3);
+                  byte_span b = top(2);
+                  byte_span c = top(1);
+                  stack.push_back(a);
+                  stack.push_back(b);
+                  stack.push_back(c);
+                  break;
+               }
+               case OP_2OVER:
+               {
+                  need(4);
+                  byte_span a = top(4);
+                  byte_span b = top(3);
+                  stack.push_back(a);
+                  stack.push_back(b);
+                  break;
+               }
+               case OP_2ROT:
+               {
+                  need(6);
+                  byte_span a = top(6);
+                  byte_span b = top(5);
+                  stack.erase(stack.end() - 6, stack.end() - 4);
+                  stack.push_back(a);
+                  stack.push_back(b);
+                  break;
+               }
+               case OP_2SWAP:
+                  need(4);
+                  std::swap(top(4), top(2));
+                  std::swap(top(3), top(1));
+                  break;
+               case OP_IFDUP:
+                  need(1);
+                  if (cast_to_bool(top(1)))
+                     stack.push_back(byte_span(top(1)));
+                  break;
+               case OP_DEPTH:
+                  push_number(stack.size());
+                  break;
+               case OP_DROP:
+                  need(1);
+                  stack.pop_back();
+                  break;
+               case OP_DUP:
+                  need(1);
+                  stack.push_back(byte_span(top(1)));
+                  break;
+               case OP_NIP:
+                  need(2);
+                  stack.erase(stack.end() - 2);
+                  break;
+               case OP_OVER:
+                  need(2);
+                  stack.push_back(byte_span(top(2)));
+                  break;
+               case OP_PICK:
+               case OP_ROLL:
+               {
+                  need(2);
+                  int64_t n = to_number(top(1), require_minimal);
+                  stack.pop_back();
+                  if (n < 0 || (size_t)n >= stack.size())
+                     throw eval_failure(script_error::invalid_stack_operation);
+                  byte_span value = top(n + 1);
+                  if (opcode == OP_ROLL)
+                     stack.erase(stack.end() - n - 1);
+                  stack.push_back(value);
+                  break;
+               }
+               case OP_ROT:
+                  need(3);
+                  std::swap(top(3), top(2));
+                  std::swap(top(2), top(1));
+                  break;
+               case OP_SWAP:
+                  need(2);
+                  std::swap(top(2), top(1));
+                  break;
+               case OP_TUCK:
+               {
+                  need(2);
+                  byte_span value = top(1);
+                  stack.insert(stack.end() - 2, value);
+                  break;
+               }
+
+               // splice
+               case OP_SIZE:
+                  need(1);
+                  push_number(top(1).size());
+                  break;
+
+               // bitwise logic
+               case OP_EQUAL:
+               case OP_EQUALVERIFY:
+               {
+                  need(2);
+                  bool result = equal(top(2), top(1));
+                  stack.pop_back();
+                  stack.pop_back();
+                  if (opcode == OP_EQUALVERIFY)
+                  {
+                     if (!result)
+                        throw eval_failure(script_error::equalverify);
+                  }
+                  else
+                     push_bool(result);
+                  break;
+               }
+
+               // arithmetic
+               case OP_1ADD: case OP_1SUB: case OP_NEGATE: case OP_ABS: case OP_NOT: case OP_0NOTEQUAL:
+               {
+                  need(1);
+                  int64_t n = to_number(top(1), require_minimal);
+                  switch(opcode)
+                  {
+                     case OP_1ADD: n += 1; break;
+                     case OP_1SUB: n -= 1; break;
+                     case OP_NEGATE: n = -n; break;
+                     case OP_ABS: n = n < 0 ? -n : n; break;
+                     case OP_NOT: n = n == 0; break;
+                     case OP_0NOTEQUAL: n = n != 0; break;
+                  }
+                  stack.pop_back();
+                  push_number(n);
+                  break;
+               }
+               case OP_ADD: case OP_SUB: case OP_BOOLAND: case OP_BOOLOR:
+               case OP_NUMEQUAL: case OP_NUMEQUALVERIFY: case OP_NUMNOTEQUAL:
+               case OP_LESSTHAN: case OP_GREATERTHAN: case OP_LESSTHANOREQUAL: case OP_GREATERTHANOREQUAL:
+               case OP_MIN: case OP_MAX:
+               {
+                  need(2);
+                  int64_t a = to_number(top(2), require_minimal);
+                  int64_t b = to_number(top(1), require_minimal);
+                  int64_t n = 0;
+                  switch(opcode)
+                  {
+                     case OP_ADD: n = a + b; break;
+                     case OP_SUB: n = a - b; break;
+                     case OP_BOOLAND: n = a != 0 && b != 0; break;
+                     case OP_BOOLOR: n = a != 0 || b != 0; break;
+                     case OP_NUMEQUAL: case OP_NUMEQUALVERIFY: n = a == b; break;
+                     case OP_NUMNOTEQUAL: n = a != b; break;
+                     case OP_LESSTHAN: n = a < b; break;
+                     case OP_GREATERTHAN: n = a > b; break;
+                     case OP_LESSTHANOREQUAL: n = a <= b; break;
+                     case OP_GREATERTHANOREQUAL: n = a >= b; break;
+                     case OP_MIN: n = std::min(a, b); break;
+                     case OP_MAX: n = std::max(a, b); break;
+                  }
+                  stack.pop_back();
+                  stack.pop_back();
+                  if (opcode == OP_NUMEQUALVERIFY)
+                  {
+                     if (n == 0)
+                        throw eval_failure(script_error::numequalverify);
+                  }
+                  else
+                     push_number(n);
+                  break;
+               }
+               case OP_WITHIN:
+               {
+                  need(3);
+                  int64_t x = to_number(top(3), require_minimal);
+                  int64_t min = to_number(top(2), require_minimal);
+                  int64_t max = to_number(top(1), require_minimal);
+                  stack.resize(stack.size() - 3);
+                  push_bool(min <= x && x < max);
+                  break;
+               }
+
+               // crypto
+               case OP_RIPEMD160:
+               case OP_SHA1:
+               case OP_SHA256:
+               case OP_HASH160:
+               case OP_HASH256:
+               {
+                  need(1);
+                  byte_span in = top(1);
+                  size_t size = (opcode == OP_RIPEMD160 || opcode == OP_SHA1 || opcode == OP_HASH160) ? 20 : 32;
+                  uint8_t* out = allocate(size);
+                  switch(opcode)
+                  {
+                     case OP_RIPEMD160: RIPEMD160(in.data(), in.size(), out); break;
+                     case OP_SHA1: SHA1(in.data(), in.size(), out); break;
+                     case OP_SHA256: sha256(in, out); break;
+                     case OP_HASH256: sha256d(in, out); break;
+                     case OP_HASH160:
+                     {
+                        digest160 digest;
+                        hash160(in, digest);
+                        std::memcpy(out, digest.data(), 20);
+                        break;
+                     }
+                  }
+                  top(1) = byte_span(out, size);
+                  break;
+               }
+               case OP_CODESEPARATOR:
+                  code_begin = pc;
+                  break;
+               case OP_CHECKSIG:
+               case OP_CHECKSIGVERIFY:
+               {
+                  need(2);
+                  bool result = checker.check_signature(top(2), top(1), byte_span(code_begin, end));
+                  stack.pop_back();
+                  stack.pop_back();
+                  if (opcode == OP_CHECKSIGVERIFY)
+                  {
+                     if (!result)
+                        throw eval_failure(script_error::checksigverify);
+                  }
+                  else
+                     push_bool(result);
+                  break;
+               }
+               case OP_CHECKMULTISIG:
+               case OP_CHECKMULTISIGVERIFY:
+               {
+                  // dummy [signatures] signature_count [pubkeys] pubkey_count
+                  size_t i = 1;
+                  need(i);
+                  int64_t keys = to_number(top(i), require_minimal);
+                  if (keys < 0 || keys > (int64_t)max_pubkeys)
+                     throw eval_failure(script_error::pubkey_count);
+                  op_count += keys;
+                  if (op_count > max_ops)
+                     throw eval_failure(script_error::op_count);
+                  size_t key_pos = ++i;
+                  i += keys;
+                  need(i);
+                  int64_t sigs = to_number(top(i), require_minimal);
+                  if (sigs < 0 || sigs > keys)
+                     throw eval_failure(script_error::sig_count);
+                  size_t sig_pos = ++i;
+                  i += sigs;
+                  need(i);
+                  // signatures must match keys in order
+                  bool result = true;
+                  byte_span script_code(code_begin, end);
+                  while (result && sigs > 0)
+                  {
+                     if (checker.check_signature(top(sig_pos), top(key_pos), script_code))
+                     {
+                        ++sig_pos;
+                        --sigs;
+                     }
+                     ++key_pos;
+                     --keys;
+                     if (sigs > keys)
+                        result = false;
+                  }
+                  stack.resize(stack.size() - (i - 1));
+                  // the extra element CHECKMULTISIG has always consumed
+                  need(1);
+                  stack.pop_back();
+                  if (opcode == OP_CHECKMULTISIGVERIFY)
+                  {
+                     if (!result)
+                        throw eval_failure(script_error::checkmultisigverify);
+                  }
+                  else
+                     push_bool(result);
+                  break;
+               }
+               default:
+                  throw eval_failure(script_error::bad_opcode);
+            }
+         }
+         if (stack.size() + alt_stack.size() > max_stack_size)
+            throw eval_failure(script_error::stack_size);
+      }
+   }
+   catch (const eval_failure& failure)
+   {
+      return failure.error;
+   }
+   if (!conditions.empty())
+      return script_error::unbalanced_conditional;
+   return script_error::ok;
+}
+
+script_error interpreter::verify(byte_span script_sig, byte_span script_pubkey,
+      const signature_checker& checker, uint32_t flags)
+{
+   reset();
+   script_error ret_val = eval(script_sig, checker, flags);
+   if (ret_val != script_error::ok)
+      return ret_val;
+   const bool p2sh = (flags & verify_p2sh) != 0 && is_p2sh(script_pubkey);
+   if (p2sh)
+      saved_stack = main_stack;
+   ret_val = eval(script_pubkey, checker, flags);
+   if (ret_val != script_error::ok)
+      return ret_val;
+   if (main_stack.empty() || !cast_to_bool(main_stack.back()))
+      return script_error::eval_false;
+   if (p2sh)
+   {
+      if (!is_push_only(script_sig))
+         return script_error::sig_pushonly;
+      // run the redeem script (the last push) on the rest of the scriptSig's stack
+      main_stack.swap(saved_stack);
+      byte_span redeem_script = main_stack.back();
+      main_stack.pop_back();
+      ret_val = eval(redeem_script, checker, flags);
+      if (ret_val != script_error::ok)
+         return ret_val;
+      if (main_stack.empty() || !cast_to_bool(main_stack.back()))
+         return script_error::eval_false;
+   }
+   if ((flags & verify_clean_stack) != 0 && main_stack.size() != 1)
+      return script_error::clean_stack;
+   return script_error::ok;
+}
+
+script_error interpreter::verify_witness_v0(byte_span program, span<const byte_span> witness,
+      const signature_checker& checker, uint32_t flags)
+{
+   reset();
+   byte_span script;
+   size_t items = witness.size();
+   if (program.size() == 20)
+   {
+      if (witness.size() != 2)
+         return script_error::witness_program_mismatch;
+      // the script code is the P2PKH script of the key hash
+      uint8_t* code = nullptr;
+      try
+      {
+         code = allocate(25);
+      }
+      catch (const eval_failure& failure)
+      {
+         return failure.error;
+      }
+      code[0] = OP_DUP;
+      code[1] = OP_HASH160;
+      code[2] = 20;
+      std::copy(program.begin(), program.end(), code + 3);
+      code[23] = OP_EQUALVERIFY;
+      code[24] = OP_CHECKSIG;
+      script = byte_span(code, 25);
+   }
+   else if (program.size() == 32)
+   {
+      if (witness.empty())
+         return script_error::witness_program_witness_empty;
+      // the last item is the witness script, which must hash to the program
+      script = witness[witness.size() - 1];
+      --items;
+      uint8_t script_hash[32];
+      sha256(script, script_hash);
+      if (!equal(byte_span(script_hash, 32), program))
+         return script_error::witness_program_mismatch;
+   }
+   else
+      return script_error::witness_program_wrong_length;
+   for(size_t i = 0; i < items; ++i)
+      if (!push(witness[i]))
+         return witness[i].size() > max_element_size ? script_error::push_size : script_error::stack_size;
+   script_error ret_val = eval(script, checker, flags);
+   if (ret_val != script_error::ok)
+      return ret_val;
+   // witness scripts must leave exactly one true element
+   if (main_stack.size() != 1)
+      return script_error::clean_stack;
+   if (!cast_to_bool(main_stack.back()))
+      return script_error::eval_false;
+   return script_error::ok;
+}
+
+} // namespace bc_toolbox
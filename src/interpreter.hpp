@@ -0,0 +1,207 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <span.hpp>
+
+namespace bc_toolbox {
+
+/*****
+ * Why a script failed
+ */
+enum class script_error
+{
+   ok,
+   eval_false, // finished with false (or nothing) on top of the stack
+   op_return,
+   script_size,
+   push_size,
+   op_count,
+   stack_size,
+   bad_opcode,
+   disabled_opcode,
+   unbalanced_conditional,
+   invalid_stack_operation,
+   invalid_altstack_operation,
+   verify,
+   equalverify,
+   numequalverify,
+   checksigverify,
+   checkmultisigverify,
+   bad_number, // too long or not minimally encoded
+   minimal_data,
+   pubkey_count,
+   sig_count,
+   sig_pushonly,
+   negative_locktime,
+   unsatisfied_locktime,
+   clean_stack,
+   out_of_memory, // the arena is full
+   unsupported_witness, // a witness version this library cannot check
+   witness_program_wrong_length,
+   witness_program_witness_empty,
+   witness_program_mismatch, // the witness does not match the program
+   witness_malleated, // a native witness spend with a non-empty scriptSig
+   witness_malleated_p2sh, // a P2SH witness spend whose scriptSig is not just the program
+   witness_unexpected // witness data for an input that is not a witness spend
+};
+
+/***
+ * @returns a short description of the error
+ */
+const char* script_error_string(script_error error);
+
+/*****
+ * Verification flags. Combine with |.
+ */
+const uint32_t verify_none = 0;
+const uint32_t verify_p2sh = 1 << 0; // evaluate the redeem script of P2SH outputs
+const uint32_t verify_minimal_data = 1 << 1; // pushes and numbers must be minimally encoded
+const uint32_t verify_checklocktimeverify = 1 << 2; // BIP65 (otherwise OP_NOP2)
+const uint32_t verify_checksequenceverify = 1 << 3; // BIP112 (otherwise OP_NOP3)
+const uint32_t verify_clean_stack = 1 << 4; // exactly one element must be left
+const uint32_t verify_witness = 1 << 5; // BIP141 (otherwise witness programs are anyone-can-spend)
+const uint32_t verify_standard = verify_p2sh | verify_minimal_data | verify_checklocktimeverify
+      | verify_checksequenceverify | verify_clean_stack | verify_witness;
+
+/*****
+ * Answers the questions a script asks about the transaction spending it.
+ * The default rejects every signature and every lock time.
+ */
+class signature_checker
+{
+   public:
+      virtual ~signature_checker() {}
+      /***
+       * @param signature the signature, with the sighash type as the last byte
+       * @param pubkey the public key
+       * @param script_code the script being run, from just after the last OP_CODESEPARATOR
+       * @returns true if the signature is valid
+       */
+      virtual bool check_signature(byte_span /* signature */, byte_span /* pubkey */,
+            byte_span /* script_code */) const
+      {
+         return false;
+      }
+      /***
+       * @param locktime the (non-negative) argument of OP_CHECKLOCKTIMEVERIFY
+       * @returns true if the transaction's lock time satisfies it
+       */
+      virtual bool check_locktime(int64_t /* locktime */) const { return false; }
+      /***
+       * @param sequence the (non-negative) argument of OP_CHECKSEQUENCEVERIFY
+       * @returns true if the input's sequence satisfies it
+       */
+      virtual bool check_sequence(int64_t /* sequence */) const { return false; }
+};
+
+/*****
+ * Checks lock times against the given transaction fields, and treats every
+ * signature as valid (or every one as invalid). Good for trying the spend
+ * paths of a script before the transaction is signed.
+ */
+class dry_run_checker : public signature_checker
+{
+   public:
+      dry_run_checker(uint32_t tx_version, uint32_t tx_locktime, uint32_t input_sequence,
+            bool signatures_valid = true)
+            : tx_version(tx_version), tx_locktime(tx_locktime), input_sequence(input_sequence),
+              signatures_valid(signatures_valid) {}
+      bool check_signature(byte_span signature, byte_span /* pubkey */, byte_span /* script_code */) const override
+      {
+         return signatures_valid && !signature.empty();
+      }
+      bool check_locktime(int64_t locktime) const override;
+      bool check_sequence(int64_t sequence) const override;
+   private:
+      uint32_t tx_version;
+      uint32_t tx_locktime;
+      uint32_t input_sequence;
+      bool signatures_valid;
+};
+
+/*****
+ * Runs scripts.
+ *
+ * Stack elements are views. Pushed data points into the script being run.
+ * Computed values (numbers, hashes) go in an arena allocated once, up front.
+ * The stacks are also sized up front. So once constructed, an interpreter
+ * does not touch the heap, and it can be reused for many scripts.
+ * Elements stay valid until the next reset() (or verify()), as long as the
+ * scripts they came from are still alive.
+ *
+ * An interpreter is not thread safe; use one per thread.
+ */
+class interpreter
+{
+   public:
+      static const size_t max_script_size = 10000;
+      static const size_t max_element_size = 520;
+      static const size_t max_ops = 201;
+      static const size_t max_stack_size = 1000; // main and alt stacks together
+      static const size_t max_pubkeys = 20;
+
+      /***
+       * @param arena_size bytes for computed values. The default is more
+       * than the consensus limits allow a script to compute.
+       */
+      explicit interpreter(size_t arena_size = 64 * 1024);
+      interpreter(const interpreter&) = delete;
+      interpreter& operator=(const interpreter&) = delete;
+
+      /***
+       * @brief empty the stacks and the arena
+       */
+      void reset();
+      /***
+       * @brief push an element, such as a witness item, before running a script
+       * @returns false if the stack is full or the element too big
+       */
+      bool push(byte_span element);
+      /***
+       * @brief run a script on the current stack
+       * @param script the script
+       * @param checker answers signature and lock time questions
+       * @param flags verify_* flags
+       * @returns script_error::ok or why the script failed
+       */
+      script_error eval(byte_span script, const signature_checker& checker, uint32_t flags);
+      /***
+       * @brief run a scriptSig and the scriptPubKey it spends (and the redeem
+       * script, for P2SH with verify_p2sh)
+       * @returns script_error::ok if the spend is valid, or why it is not
+       */
+      script_error verify(byte_span script_sig, byte_span script_pubkey,
+            const signature_checker& checker, uint32_t flags);
+      /***
+       * @brief run a version 0 witness program (BIP141): P2WPKH for a 20 byte
+       * program, P2WSH for a 32 byte one. The checker should compute BIP143
+       * signature hashes.
+       * @param program the witness program
+       * @param witness the witness items, bottom of the stack first
+       * @returns script_error::ok if the spend is valid, or why it is not
+       */
+      script_error verify_witness_v0(byte_span program, span<const byte_span> witness,
+            const signature_checker& checker, uint32_t flags);
+      /***
+       * @returns the main stack, bottom first
+       */
+      span<const byte_span> stack() const { return span<const byte_span>(main_stack.data(), main_stack.size()); }
+      size_t arena_used() const { return arena_top; }
+   private:
+      uint8_t* allocate(size_t size);
+      std::vector<uint8_t> arena;
+      size_t arena_top;
+      std::vector<byte_span> main_stack;
+      std::vector<byte_span> alt_stack;
+      std::vector<byte_span> saved_stack; // the stack after the scriptSig, for P2SH
+};
+
+/***
+ * @param element a stack element
+ * @returns true unless the element is zero (including negative zero)
+ */
+bool cast_to_bool(byte_span element);
+
+} // namespace bc_toolbox
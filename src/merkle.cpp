@@ -0,0 +1,153 @@
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+#include <merkle.hpp>
+
+namespace bc_toolbox {
+
+namespace {
+
+/***
+ * Reduce a level of the tree to the next one up, in place
+ * @param level the nodes (resized to the parent level)
+ * @param mutated set if a pair of identical nodes is found
+ */
+void hash_level(std::vector<digest256>& level, bool& mutated)
+{
+   for(size_t i = 0; i + 1 < level.size(); i += 2)
+      if (level[i] == level[i+1])
+         mutated = true;
+   if (level.size() & 1)
+      level.push_back(level.back());
+   // each pair of nodes is already a contiguous 64 byte block
+   sha256d64(level[0].data(), level[0].data(), level.size() / 2);
+   level.resize(level.size() / 2);
+}
+
+} // namespace
+
+digest256 merkle_root(span<const digest256> hashes, bool* mutated)
+{
+   bool was_mutated = false;
+   digest256 ret_val;
+   ret_val.fill(0);
+   if (!hashes.empty())
+   {
+      std::vector<digest256> level(hashes.begin(), hashes.end());
+      level.reserve(hashes.size() + 1);
+      while (level.size() > 1)
+         hash_level(level, was_mutated);
+      ret_val = level[0];
+   }
+   if (mutated != nullptr)
+      *mutated = was_mutated;
+   return ret_val;
+}
+
+digest256 witness_merkle_root(span<const digest256> wtxids)
+{
+   if (wtxids.empty())
+      return merkle_root(wtxids);
+   std::vector<digest256> level(wtxids.begin(), wtxids.end());
+   level[0].fill(0);
+   return merkle_root(level);
+}
+
+digest256 witness_commitment(const digest256& witness_root, const digest256& reserved)
+{
+   uint8_t block[64];
+   std::memcpy(block, witness_root.data(), 32);
+   std::memcpy(block + 32, reserved.data(), 32);
+   digest256 ret_val;
+   sha256d64(ret_val.data(), block, 1);
+   return ret_val;
+}
+
+std::vector<digest256> merkle_branch(span<const digest256> hashes, size_t index)
+{
+   if (index >= hashes.size())
+      throw std::out_of_range("transaction index out of range");
+   std::vector<digest256> ret_val;
+   std::vector<digest256> level(hashes.begin(), hashes.end());
+   level.reserve(hashes.size() + 1);
+   bool mutated = false;
+   while (level.size() > 1)
+   {
+      size_t sibling = index ^ 1;
+      // an odd node at the end is paired with itself
+      ret_val.push_back( sibling < level.size() ? level[sibling] : level[index] );
+      hash_level(level, mutated);
+      index >>= 1;
+   }
+   return ret_val;
+}
+
+digest256 branch_root(const digest256& leaf, span<const digest256> branch, size_t index)
+{
+   uint8_t block[64];
+   digest256 current = leaf;
+   for(const digest256& sibling : branch)
+   {
+      if (index & 1)
+      {
+         std::memcpy(block, sibling.data(), 32);
+         std::memcpy(block + 32, current.data(), 32);
+      }
+      else
+      {
+         std::memcpy(block, current.data(), 32);
+         std::memcpy(block + 32, sibling.data(), 32);
+      }
+      sha256d64(current.data(), block, 1);
+      index >>= 1;
+   }
+   return current;
+}
+
+bool verify_proof(const merkle_proof& proof)
+{
+   return branch_root(proof.leaf, proof.branch, proof.index) == proof.root;
+}
+
+std::vector<bool> verify_proofs(span<const merkle_proof> proofs)
+{
+   std::vector<digest256> current(proofs.size());
+   std::vector<uint32_t> index(proofs.size());
+   size_t depth = 0;
+   for(size_t i = 0; i < proofs.size(); ++i)
+   {
+      current[i] = proofs[i].leaf;
+      index[i] = proofs[i].index;
+      depth = std::max(depth, proofs[i].branch.size());
+   }
+   // one level of every proof that still has a level left, hashed together
+   std::vector<uint8_t> blocks(proofs.size() * 64);
+   std::vector<size_t> active;
+   active.reserve(proofs.size());
+   for(size_t level = 0; level < depth; ++level)
+   {
+      active.clear();
+      for(size_t i = 0; i < proofs.size(); ++i)
+      {
+         if (level >= proofs[i].branch.size())
+            continue;
+         uint8_t* block = blocks.data() + active.size() * 64;
+         const digest256& sibling = proofs[i].branch[level];
+         bool right = index[i] & 1;
+         std::memcpy(block + (right ? 32 : 0), current[i].data(), 32);
+         std::memcpy(block + (right ? 0 : 32), sibling.data(), 32);
+         index[i] >>= 1;
+         active.push_back(i);
+      }
+      sha256d64(blocks.data(), blocks.data(), active.size());
+      for(size_t j = 0; j < active.size(); ++j)
+         std::memcpy(current[active[j]].data(), blocks.data() + j * 32, 32);
+   }
+   std::vector<bool> ret_val(proofs.size());
+   for(size_t i = 0; i < proofs.size(); ++i)
+      ret_val[i] = (current[i] == proofs[i].root);
+   return ret_val;
+}
+
+} // namespace bc_toolbox
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <span.hpp>
+#include <hash.hpp>
+
+namespace bc_toolbox {
+
+   /***
+    * @brief compute the merkle root of a block
+    * @param hashes the txids, in block order (internal byte order)
+    * @param mutated if not null, set to true if the tree has a duplicated
+    * pair of nodes, which means a different list of transactions has the same root
+    * @returns the root (all zeros if there are no hashes)
+    */
+   digest256 merkle_root(span<const digest256> hashes, bool* mutated = nullptr);
+   /***
+    * @brief compute the witness merkle root of a block. The wtxid of the
+    * coinbase is replaced with zeros, as required by BIP141.
+    * @param wtxids the wtxids, in block order
+    * @returns the root
+    */
+   digest256 witness_merkle_root(span<const digest256> wtxids);
+   /***
+    * @brief the commitment that goes in the coinbase OP_RETURN output
+    * @param witness_root the witness merkle root
+    * @param reserved the witness reserved value (the coinbase witness item)
+    * @returns double SHA-256 of the root followed by the reserved value
+    */
+   digest256 witness_commitment(const digest256& witness_root, const digest256& reserved);
+
+   /***
+    * @brief build the branch that proves a transaction is in a block (SPV proof)
+    * @param hashes the txids of the block, in order
+    * @param index the position of the transaction to prove
+    * @returns the sibling hashes from the leaf up to (not including) the root
+    * @throws std::out_of_range if index is past the end of hashes
+    */
+   std::vector<digest256> merkle_branch(span<const digest256> hashes, size_t index);
+   /***
+    * @brief compute the root a branch leads to
+    * @param leaf the txid being proven
+    * @param branch the sibling hashes, from the leaf up
+    * @param index the position of the transaction in the block
+    * @returns the root
+    */
+   digest256 branch_root(const digest256& leaf, span<const digest256> branch, size_t index);
+
+   /*****
+    * An SPV inclusion proof
+    */
+   class merkle_proof
+   {
+      public:
+         digest256 leaf; // the txid
+         std::vector<digest256> branch;
+         uint32_t index; // position of the transaction in the block
+         digest256 root; // from the block header
+   };
+
+   /***
+    * @brief check a proof
+    * @returns true if the branch leads from the leaf to the root
+    */
+   bool verify_proof(const merkle_proof& proof);
+   /***
+    * @brief check many proofs. The proofs are walked level by level together,
+    * so each level hashes the node pairs of all the proofs at once.
+    * @param proofs the proofs to check
+    * @returns true or false for each proof
+    */
+   std::vector<bool> verify_proofs(span<const merkle_proof> proofs);
+
+}
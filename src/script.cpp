@@ -1,64 +1,153 @@
 
-#include <openssl/sha.h>
-#include <openssl/ripemd.h>
+#include <algorithm>
+
 #include <script.hpp>
+#include <hash.hpp>
+#include <bech32.hpp>
 
 namespace bc_toolbox {
 
-void script::add_opcode(unsigned char opcode)
+const size_t script::inline_capacity;
+
+script::script(const script& other) : heap(other.heap), byte_len(other.byte_len)
 {
-   bytes[byte_len] = opcode;
-   ++byte_len;
+   if (heap.empty())
+      std::copy(other.inline_bytes, other.inline_bytes + byte_len, inline_bytes);
 }
 
-void script::add_int(int64_t val) 
+script::script(script&& other) : heap(std::move(other.heap)), byte_len(other.byte_len)
 {
-   auto retVal = pack(val);
-   bytes[byte_len] = retVal.first / 2;
-   ++byte_len;
-   for(auto b : retVal.second )
+   if (heap.empty())
+      std::copy(other.inline_bytes, other.inline_bytes + byte_len, inline_bytes);
+   other.heap.clear();
+   other.byte_len = 0;
+}
+
+script& script::operator=(const script& other)
+{
+   if (this != &other)
    {
-      bytes[byte_len] = b;
-      ++byte_len;
+      heap = other.heap;
+      byte_len = other.byte_len;
+      if (heap.empty())
+         std::copy(other.inline_bytes, other.inline_bytes + byte_len, inline_bytes);
    }
+   return *this;
 }
 
-void script::add_bytes(std::vector<uint8_t> val)
+script& script::operator=(script&& other)
 {
-   for(auto b : val)
+   if (this != &other)
    {
-      bytes[byte_len] = b;
-      ++byte_len;
+      heap = std::move(other.heap);
+      byte_len = other.byte_len;
+      if (heap.empty())
+         std::copy(other.inline_bytes, other.inline_bytes + byte_len, inline_bytes);
+      other.heap.clear();
+      other.byte_len = 0;
    }
+   return *this;
+}
+
+void script::reserve(size_t new_capacity)
+{
+   if (new_capacity <= capacity())
+      return;
+   std::vector<uint8_t> grown(new_capacity);
+   std::copy(data(), data() + byte_len, grown.begin());
+   heap.swap(grown);
+}
+
+uint8_t* script::extend(size_t count)
+{
+   size_t needed = byte_len + count;
+   if (needed > capacity())
+      reserve(std::max(needed, capacity() * 2));
+   uint8_t* pos = (heap.empty() ? inline_bytes : heap.data()) + byte_len;
+   byte_len = needed;
+   return pos;
+}
+
+void script::add_opcode(unsigned char opcode)
+{
+   *extend(1) = opcode;
+}
+
+void script::add_int(int64_t val) 
+{
+   auto retVal = pack(val);
+   uint8_t* pos = extend(1 + retVal.second.size());
+   *pos++ = retVal.first / 2;
+   std::copy(retVal.second.begin(), retVal.second.end(), pos);
 }
 
-void script::add_bytes_with_size(std::vector<uint8_t> val)
+void script::add_bytes(byte_span val)
 {
-   auto retVal = pack(val.size());
-   for(uint8_t i = 0; i < retVal.first / 2; ++i) 
+   std::copy(val.begin(), val.end(), extend(val.size()));
+}
+
+void script::add_bytes_with_size(byte_span val)
+{
+   size_t len = val.size();
+   uint8_t* pos;
+   if (len < OP_PUSHDATA1)
+   {
+      pos = extend(1 + len);
+      *pos++ = len;
+   }
+   else if (len <= 0xff)
+   {
+      pos = extend(2 + len);
+      *pos++ = OP_PUSHDATA1;
+      *pos++ = len;
+   }
+   else if (len <= 0xffff)
+   {
+      pos = extend(3 + len);
+      *pos++ = OP_PUSHDATA2;
+      *pos++ = len & 0xff;
+      *pos++ = len >> 8;
+   }
+   else
    {
-      bytes[byte_len] = retVal.second[i];
-      ++byte_len;
+      pos = extend(5 + len);
+      *pos++ = OP_PUSHDATA4;
+      for(int i = 0; i < 4; ++i)
+         *pos++ = (len >> (i * 8)) & 0xff;
    }
-   add_bytes(val);
+   std::copy(val.begin(), val.end(), pos);
 }
 
-std::vector<uint8_t> script::get_bytes_as_vector()
+std::vector<uint8_t> script::get_bytes_as_vector() const
 {
-   std::vector<uint8_t> retVal(bytes, bytes + byte_len);
+   std::vector<uint8_t> retVal(data(), data() + byte_len);
+   return retVal;
+}
+
+std::vector<uint8_t> script::release()
+{
+   std::vector<uint8_t> retVal;
+   if (heap.empty())
+      retVal.assign(inline_bytes, inline_bytes + byte_len);
+   else
+   {
+      heap.resize(byte_len);
+      retVal.swap(heap);
+   }
+   byte_len = 0;
    return retVal;
 }
 
 /***
  * Run bytes through SHA256 and RIPEMD-160
  */
-std::vector<uint8_t> script::hash()
+std::vector<uint8_t> script::hash() const
 {
-   std::vector<uint8_t> temp_bytes(bytes, bytes + byte_len);
-   return ripemd160(sha256(temp_bytes));
+   digest160 digest = hash160(bytes());
+   return std::vector<uint8_t>(digest.begin(), digest.end());
 }
 
-std::vector<uint8_t> script::p2sh_script()
+std::vector<uint8_t> script::p2sh_script() const
 {
    std::vector<uint8_t> retVal = hash();
    // add prefix OP_HASH160 OP_PUSHDATA 20
@@ -69,4 +158,23 @@ std::vector<uint8_t> script::p2sh_script()
    return retVal;
 }
 
-}
\ No newline at end of file
+std::vector<uint8_t> script::p2wsh_script() const
+{
+   digest256 digest;
+   sha256(bytes(), digest.data());
+   std::vector<uint8_t> retVal;
+   // OP_0 OP_PUSHDATA 32
+   retVal.push_back(bc_toolbox::OP_0);
+   retVal.push_back(0x20);
+   retVal.insert(retVal.end(), digest.begin(), digest.end());
+   return retVal;
+}
+
+std::string script::p2wsh_address(const std::string& hrp) const
+{
+   digest256 digest;
+   sha256(bytes(), digest.data());
+   return encode_segwit_address(hrp, 0, digest);
+}
+
+}
@@ -1,26 +1,74 @@
 #pragma once
 
 #include <hex_conversion.hpp>
+#include <span.hpp>
 
 namespace bc_toolbox {
 
+/*****
+ * Builds a script. Short scripts are kept inside the object; longer ones
+ * move to the heap as they grow.
+ */
 class script
 {
    public:
+      static const size_t inline_capacity = 128;
+
       script() : byte_len(0) {}
+      script(const script& other);
+      script(script&& other);
+      script& operator=(const script& other);
+      script& operator=(script&& other);
       ~script() {}
       void add_opcode(unsigned char opcode);
       void add_int(int64_t val);
-      void add_bytes(std::vector<uint8_t> val);
-      void add_bytes_with_size(std::vector<uint8_t> val);
-      unsigned char* get_bytes() { return bytes; }
-      std::vector<uint8_t> get_bytes_as_vector();
-      uint16_t get_byte_len() { return byte_len; }
-      std::vector<uint8_t> hash();
-      std::vector<uint8_t> p2sh_script();
+      /***
+       * @brief append bytes as they are
+       */
+      void add_bytes(byte_span val);
+      /***
+       * @brief append a push of the bytes (the size, using OP_PUSHDATA1/2/4 if needed, then the bytes)
+       */
+      void add_bytes_with_size(byte_span val);
+      /***
+       * @brief make room for at least new_capacity bytes
+       */
+      void reserve(size_t new_capacity);
+      void clear() { byte_len = 0; }
+      const uint8_t* get_bytes() const { return data(); }
+      /***
+       * @returns the bytes, without copying. Only valid until the script is changed.
+       */
+      byte_span bytes() const { return byte_span(data(), byte_len); }
+      std::vector<uint8_t> get_bytes_as_vector() const;
+      /***
+       * @brief take the bytes, leaving this script empty. Does not copy if the
+       * bytes are on the heap.
+       */
+      std::vector<uint8_t> release();
+      size_t get_byte_len() const { return byte_len; }
+      size_t size() const { return byte_len; }
+      size_t capacity() const { return heap.empty() ? inline_capacity : heap.size(); }
+      std::vector<uint8_t> hash() const;
+      std::vector<uint8_t> p2sh_script() const;
+      /***
+       * @returns the P2WSH output script (OP_0 followed by the SHA-256 of this script)
+       */
+      std::vector<uint8_t> p2wsh_script() const;
+      /***
+       * @param hrp "bc" for mainnet, "tb" for testnet
+       * @returns the P2WSH address of this script
+       */
+      std::string p2wsh_address(const std::string& hrp) const;
    private:
-      uint8_t bytes[520];
-      uint16_t byte_len;
+      const uint8_t* data() const { return heap.empty() ? inline_bytes : heap.data(); }
+      /***
+       * @returns where to write count more bytes (growing if needed)
+       */
+      uint8_t* extend(size_t count);
+      uint8_t inline_bytes[inline_capacity];
+      std::vector<uint8_t> heap; // empty while the bytes fit in inline_bytes
+      size_t byte_len;
 };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,429 @@
+#include <unordered_map>
+#include <stdexcept>
+#include <sstream>
+
+#include <script_asm.hpp>
+#include <hex.hpp>
+
+namespace bc_toolbox {
+
+constexpr opcode_info opcode_table[256] = {
+   { "OP_0", opcode_type::number, false }, // 0x00
+   { "OP_PUSHBYTES_1", opcode_type::push_data, false }, // 0x01
+   { "OP_PUSHBYTES_2", opcode_type::push_data, false }, // 0x02
+   { "OP_PUSHBYTES_3", opcode_type::push_data, false }, // 0x03
+   { "OP_PUSHBYTES_4", opcode_type::push_data, false }, // 0x04
+   { "OP_PUSHBYTES_5", opcode_type::push_data, false }, // 0x05
+   { "OP_PUSHBYTES_6", opcode_type::push_data, false }, // 0x06
+   { "OP_PUSHBYTES_7", opcode_type::push_data, false }, // 0x07
+   { "OP_PUSHBYTES_8", opcode_type::push_data, false }, // 0x08
+   { "OP_PUSHBYTES_9", opcode_type::push_data, false }, // 0x09
+   { "OP_PUSHBYTES_10", opcode_type::push_data, false }, // 0x0a
+   { "OP_PUSHBYTES_11", opcode_type::push_data, false }, // 0x0b
+   { "OP_PUSHBYTES_12", opcode_type::push_data, false }, // 0x0c
+   { "OP_PUSHBYTES_13", opcode_type::push_data, false }, // 0x0d
+   { "OP_PUSHBYTES_14", opcode_type::push_data, false }, // 0x0e
+   { "OP_PUSHBYTES_15", opcode_type::push_data, false }, // 0x0f
+   { "OP_PUSHBYTES_16", opcode_type::push_data, false }, // 0x10
+   { "OP_PUSHBYTES_17", opcode_type::push_data, false }, // 0x11
+   { "OP_PUSHBYTES_18", opcode_type::push_data, false }, // 0x12
+   { "OP_PUSHBYTES_19", opcode_type::push_data, false }, // 0x13
+   { "OP_PUSHBYTES_20", opcode_type::push_data, false }, // 0x14
+   { "OP_PUSHBYTES_21", opcode_type::push_data, false }, // 0x15
+   { "OP_PUSHBYTES_22", opcode_type::push_data, false }, // 0x16
+   { "OP_PUSHBYTES_23", opcode_type::push_data, false }, // 0x17
+   { "OP_PUSHBYTES_24", opcode_type::push_data, false }, // 0x18
+   { "OP_PUSHBYTES_25", opcode_type::push_data, false }, // 0x19
+   { "OP_PUSHBYTES_26", opcode_type::push_data, false }, // 0x1a
+   { "OP_PUSHBYTES_27", opcode_type::push_data, false }, // 0x1b
+   { "OP_PUSHBYTES_28", opcode_type::push_data, false }, // 0x1c
+   { "OP_PUSHBYTES_29", opcode_type::push_data, false }, // 0x1d
+   { "OP_PUSHBYTES_30", opcode_type::push_data, false }, // 0x1e
+   { "OP_PUSHBYTES_31", opcode_type::push_data, false }, // 0x1f
+   { "OP_PUSHBYTES_32", opcode_type::push_data, false }, // 0x20
+   { "OP_PUSHBYTES_33", opcode_type::push_data, false }, // 0x21
+   { "OP_PUSHBYTES_34", opcode_type::push_data, false }, // 0x22
+   { "OP_PUSHBYTES_35", opcode_type::push_data, false }, // 0x23
+   { "OP_PUSHBYTES_36", opcode_type::push_data, false }, // 0x24
+   { "OP_PUSHBYTES_37", opcode_type::push_data, false }, // 0x25
+   { "OP_PUSHBYTES_38", opcode_type::push_data, false }, // 0x26
+   { "OP_PUSHBYTES_39", opcode_type::push_data, false }, // 0x27
+   { "OP_PUSHBYTES_40", opcode_type::push_data, false }, // 0x28
+   { "OP_PUSHBYTES_41", opcode_type::push_data, false }, // 0x29
+   { "OP_PUSHBYTES_42", opcode_type::push_data, false }, // 0x2a
+   { "OP_PUSHBYTES_43", opcode_type::push_data, false }, // 0x2b
+   { "OP_PUSHBYTES_44", opcode_type::push_data, false }, // 0x2c
+   { "OP_PUSHBYTES_45", opcode_type::push_data, false }, // 0x2d
+   { "OP_PUSHBYTES_46", opcode_type::push_data, false }, // 0x2e
+   { "OP_PUSHBYTES_47", opcode_type::push_data, false }, // 0x2f
+   { "OP_PUSHBYTES_48", opcode_type::push_data, false }, // 0x30
+   { "OP_PUSHBYTES_49", opcode_type::push_data, false }, // 0x31
+   { "OP_PUSHBYTES_50", opcode_type::push_data, false }, // 0x32
+   { "OP_PUSHBYTES_51", opcode_type::push_data, false }, // 0x33
+   { "OP_PUSHBYTES_52", opcode_type::push_data, false }, // 0x34
+   { "OP_PUSHBYTES_53", opcode_type::push_data, false }, // 0x35
+   { "OP_PUSHBYTES_54", opcode_type::push_data, false }, // 0x36
+   { "OP_PUSHBYTES_55", opcode_type::push_data, false }, // 0x37
+   { "OP_PUSHBYTES_56", opcode_type::push_data, false }, // 0x38
+   { "OP_PUSHBYTES_57", opcode_type::push_data, false }, // 0x39
+   { "OP_PUSHBYTES_58", opcode_type::push_data, false }, // 0x3a
+   { "OP_PUSHBYTES_59", opcode_type::push_data, false }, // 0x3b
+   { "OP_PUSHBYTES_60", opcode_type::push_data, false }, // 0x3c
+   { "OP_PUSHBYTES_61", opcode_type::push_data, false }, // 0x3d
+   { "OP_PUSHBYTES_62", opcode_type::push_data, false }, // 0x3e
+   { "OP_PUSHBYTES_63", opcode_type::push_data, false }, // 0x3f
+   { "OP_PUSHBYTES_64", opcode_type::push_data, false }, // 0x40
+   { "OP_PUSHBYTES_65", opcode_type::push_data, false }, // 0x41
+   { "OP_PUSHBYTES_66", opcode_type::push_data, false }, // 0x42
+   { "OP_PUSHBYTES_67", opcode_type::push_data, false }, // 0x43
+   { "OP_PUSHBYTES_68", opcode_type::push_data, false }, // 0x44
+   { "OP_PUSHBYTES_69", opcode_type::push_data, false }, // 0x45
+   { "OP_PUSHBYTES_70", opcode_type::push_data, false }, // 0x46
+   { "OP_PUSHBYTES_71", opcode_type::push_data, false }, // 0x47
+   { "OP_PUSHBYTES_72", opcode_type::push_data, false }, // 0x48
+   { "OP_PUSHBYTES_73", opcode_type::push_data, false }, // 0x49
+   { "OP_PUSHBYTES_74", opcode_type::push_data, false }, // 0x4a
+   { "OP_PUSHBYTES_75", opcode_type::push_data, false }, // 0x4b
+   { "OP_PUSHDATA1", opcode_type::push_data, false }, // 0x4c
+   { "OP_PUSHDATA2", opcode_type::push_data, false }, // 0x4d
+   { "OP_PUSHDATA4", opcode_type::push_data, false }, // 0x4e
+   { "OP_1NEGATE", opcode_type::number, false }, // 0x4f
+   { "OP_RESERVED", opcode_type::reserved, false }, // 0x50
+   { "OP_1", opcode_type::number, false }, // 0x51
+   { "OP_2", opcode_type::number, false }, // 0x52
+   { "OP_3", opcode_type::number, false }, // 0x53
+   { "OP_4", opcode_type::number, false }, // 0x54
+   { "OP_5", opcode_type::number, false }, // 0x55
+   { "OP_6", opcode_type::number, false }, // 0x56
+   { "OP_7", opcode_type::number, false }, // 0x57
+   { "OP_8", opcode_type::number, false }, // 0x58
+   { "OP_9", opcode_type::number, false }, // 0x59
+   { "OP_10", opcode_type::number, false }, // 0x5a
+   { "OP_11", opcode_type::number, false }, // 0x5b
+   { "OP_12", opcode_type::number, false }, // 0x5c
+   { "OP_13", opcode_type::number, false }, // 0x5d
+   { "OP_14", opcode_type::number, false }, // 0x5e
+   { "OP_15", opcode_type::number, false }, // 0x5f
+   { "OP_16", opcode_type::number, false }, // 0x60
+   { "OP_NOP", opcode_type::nop, false }, // 0x61
+   { "OP_VER", opcode_type::reserved, false }, // 0x62
+   { "OP_IF", opcode_type::flow_control, false }, // 0x63
+   { "OP_NOTIF", opcode_type::flow_control, false }, // 0x64
+   { "OP_VERIF", opcode_type::reserved, false }, // 0x65
+   { "OP_VERNOTIF", opcode_type::reserved, false }, // 0x66
+   { "OP_ELSE", opcode_type::flow_control, false }, // 0x67
+   { "OP_ENDIF", opcode_type::flow_control, false }, // 0x68
+   { "OP_VERIFY", opcode_type::flow_control, false }, // 0x69
+   { "OP_RETURN", opcode_type::flow_control, false }, // 0x6a
+   { "OP_TOALTSTACK", opcode_type::stack, false }, // 0x6b
+   { "OP_FROMALTSTACK", opcode_type::stack, false }, // 0x6c
+   { "OP_2DROP", opcode_type::stack, false }, // 0x6d
+   { "OP_2DUP", opcode_type::stack, false }, // 0x6e
+   { "OP_3DUP", opcode_type::stack, false }, // 0x6f
+   { "OP_2OVER", opcode_type::stack, false }, // 0x70
+   { "OP_2ROT", opcode_type::stack, false }, // 0x71
+   { "OP_2SWAP", opcode_type::stack, false }, // 0x72
+   { "OP_IFDUP", opcode_type::stack, false }, // 0x73
+   { "OP_DEPTH", opcode_type::stack, false }, // 0x74
+   { "OP_DROP", opcode_type::stack, false }, // 0x75
+   { "OP_DUP", opcode_type::stack, false }, // 0x76
+   { "OP_NIP", opcode_type::stack, false }, // 0x77
+   { "OP_OVER", opcode_type::stack, false }, // 0x78
+   { "OP_PICK", opcode_type::stack, false }, // 0x79
+   { "OP_ROLL", opcode_type::stack, false }, // 0x7a
+   { "OP_ROT", opcode_type::stack, false }, // 0x7b
+   { "OP_SWAP", opcode_type::stack, false }, // 0x7c
+   { "OP_TUCK", opcode_type::stack, false }, // 0x7d
+   { "OP_CAT", opcode_type::splice, true }, // 0x7e
+   { "OP_SUBSTR", opcode_type::splice, true }, // 0x7f
+   { "OP_LEFT", opcode_type::splice, true }, // 0x80
+   { "OP_RIGHT", opcode_type::splice, true }, // 0x81
+   { "OP_SIZE", opcode_type::splice, false }, // 0x82
+   { "OP_INVERT", opcode_type::bitwise_logic, true }, // 0x83
+   { "OP_AND", opcode_type::bitwise_logic, true }, // 0x84
+   { "OP_OR", opcode_type::bitwise_logic, true }, // 0x85
+   { "OP_XOR", opcode_type::bitwise_logic, true }, // 0x86
+   { "OP_EQUAL", opcode_type::bitwise_logic, false }, // 0x87
+   { "OP_EQUALVERIFY", opcode_type::bitwise_logic, false }, // 0x88
+   { "OP_RESERVED1", opcode_type::reserved, false }, // 0x89
+   { "OP_RESERVED2", opcode_type::reserved, false }, // 0x8a
+   { "OP_1ADD", opcode_type::arithmetic, false }, // 0x8b
+   { "OP_1SUB", opcode_type::arithmetic, false }, // 0x8c
+   { "OP_2MUL", opcode_type::arithmetic, true }, // 0x8d
+   { "OP_2DIV", opcode_type::arithmetic, true }, // 0x8e
+   { "OP_NEGATE", opcode_type::arithmetic, false }, // 0x8f
+   { "OP_ABS", opcode_type::arithmetic, false }, // 0x90
+   { "OP_NOT", opcode_type::arithmetic, false }, // 0x91
+   { "OP_0NOTEQUAL", opcode_type::arithmetic, false }, // 0x92
+   { "OP_ADD", opcode_type::arithmetic, false }, // 0x93
+   { "OP_SUB", opcode_type::arithmetic, false }, // 0x94
+   { "OP_MUL", opcode_type::arithmetic, true }, // 0x95
+   { "OP_DIV", opcode_type::arithmetic, true }, // 0x96
+   { "OP_MOD", opcode_type::arithmetic, true }, // 0x97
+   { "OP_LSHIFT", opcode_type::arithmetic, true }, // 0x98
+   { "OP_RSHIFT", opcode_type::arithmetic, true }, // 0x99
+   { "OP_BOOLAND", opcode_type::arithmetic, false }, // 0x9a
+   { "OP_BOOLOR", opcode_type::arithmetic, false }, // 0x9b
+   { "OP_NUMEQUAL", opcode_type::arithmetic, false }, // 0x9c
+   { "OP_NUMEQUALVERIFY", opcode_type::arithmetic, false }, // 0x9d
+   { "OP_NUMNOTEQUAL", opcode_type::arithmetic, false }, // 0x9e
+   { "OP_LESSTHAN", opcode_type::arithmetic, false }, // 0x9f
+   { "OP_GREATERTHAN", opcode_type::arithmetic, false }, // 0xa0
+   { "OP_LESSTHANOREQUAL", opcode_type::arithmetic, false }, // 0xa1
+   { "OP_GREATERTHANOREQUAL", opcode_type::arithmetic, false }, // 0xa2
+   { "OP_MIN", opcode_type::arithmetic, false }, // 0xa3
+   { "OP_MAX", opcode_type::arithmetic, false }, // 0xa4
+   { "OP_WITHIN", opcode_type::arithmetic, false }, // 0xa5
+   { "OP_RIPEMD160", opcode_type::crypto, false }, // 0xa6
+   { "OP_SHA1", opcode_type::crypto, false }, // 0xa7
+   { "OP_SHA256", opcode_type::crypto, false }, // 0xa8
+   { "OP_HASH160", opcode_type::crypto, false }, // 0xa9
+   { "OP_HASH256", opcode_type::crypto, false }, // 0xaa
+   { "OP_CODESEPARATOR", opcode_type::crypto, false }, // 0xab
+   { "OP_CHECKSIG", opcode_type::crypto, false }, // 0xac
+   { "OP_CHECKSIGVERIFY", opcode_type::crypto, false }, // 0xad
+   { "OP_CHECKMULTISIG", opcode_type::crypto, false }, // 0xae
+   { "OP_CHECKMULTISIGVERIFY", opcode_type::crypto, false }, // 0xaf
+   { "OP_NOP1", opcode_type::nop, false }, // 0xb0
+   { "OP_CHECKLOCKTIMEVERIFY", opcode_type::locktime, false }, // 0xb1
+   { "OP_CHECKSEQUENCEVERIFY", opcode_type::locktime, false }, // 0xb2
+   { "OP_NOP4", opcode_type::nop, false }, // 0xb3
+   { "OP_NOP5", opcode_type::nop, false }, // 0xb4
+   { "OP_NOP6", opcode_type::nop, false }, // 0xb5
+   { "OP_NOP7", opcode_type::nop, false }, // 0xb6
+   { "OP_NOP8", opcode_type::nop, false }, // 0xb7
+   { "OP_NOP9", opcode_type::nop, false }, // 0xb8
+   { "OP_NOP10", opcode_type::nop, false }, // 0xb9
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xba
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xbb
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xbc
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xbd
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xbe
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xbf
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xc0
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xc1
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xc2
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xc3
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xc4
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xc5
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xc6
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xc7
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xc8
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xc9
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xca
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xcb
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xcc
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xcd
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xce
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xcf
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xd0
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xd1
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xd2
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xd3
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xd4
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xd5
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xd6
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xd7
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xd8
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xd9
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xda
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xdb
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xdc
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xdd
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xde
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xdf
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xe0
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xe1
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xe2
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xe3
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xe4
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xe5
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xe6
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xe7
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xe8
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xe9
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xea
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xeb
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xec
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xed
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xee
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xef
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xf0
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xf1
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xf2
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xf3
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xf4
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xf5
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xf6
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xf7
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xf8
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xf9
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xfa
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xfb
+   { "OP_UNKNOWN", opcode_type::invalid, false }, // 0xfc
+   { "OP_PUBKEYHASH", opcode_type::invalid, false }, // 0xfd
+   { "OP_PUBKEY", opcode_type::invalid, false }, // 0xfe
+   { "OP_INVALIDOPCODE", opcode_type::invalid, false }, // 0xff
+};
+
+namespace {
+
+void append_hex(byte_span data, std::string& out)
+{
+   size_t pos = out.size();
+   out.resize(pos + data.size() * 2);
+   hex_encode(data, span<char>(&out[pos], data.size() * 2));
+}
+
+/***
+ * @returns the opcode for each name the assembler accepts
+ */
+const std::unordered_map<std::string, uint8_t>& opcodes_by_name()
+{
+   static const std::unordered_map<std::string, uint8_t> ret_val = []()
+   {
+      std::unordered_map<std::string, uint8_t> names;
+      for(size_t i = 0; i < 256; ++i)
+      {
+         const opcode_info& info = opcode_table[i];
+         // data pushes are written as hex, and OP_UNKNOWN is not one opcode
+         if ((info.type == opcode_type::push_data && i < OP_PUSHDATA1) || std::string(info.name) == "OP_UNKNOWN")
+            continue;
+         names[info.name] = (uint8_t)i;
+      }
+      names["OP_FALSE"] = OP_FALSE;
+      names["OP_TRUE"] = OP_TRUE;
+      names["OP_NOP2"] = OP_CHECKLOCKTIMEVERIFY;
+      names["OP_NOP3"] = OP_CHECKSEQUENCEVERIFY;
+      return names;
+   }();
+   return ret_val;
+}
+
+void append_push(std::vector<uint8_t>& out, uint8_t opcode, const std::vector<uint8_t>& data)
+{
+   size_t size = data.size();
+   if (opcode == 0)
+   {
+      // the smallest push
+      opcode = size < OP_PUSHDATA1 ? (uint8_t)size : size <= 0xff ? OP_PUSHDATA1 : size <= 0xffff ? OP_PUSHDATA2 : OP_PUSHDATA4;
+   }
+   else if ((opcode == OP_PUSHDATA1 && size > 0xff) || (opcode == OP_PUSHDATA2 && size > 0xffff))
+      throw std::invalid_argument("too much data for the push");
+   out.push_back(opcode);
+   size_t width = opcode == OP_PUSHDATA1 ? 1 : opcode == OP_PUSHDATA2 ? 2 : opcode == OP_PUSHDATA4 ? 4 : 0;
+   for(size_t i = 0; i < width; ++i)
+      out.push_back((uint8_t)(size >> (8 * i)));
+   out.insert(out.end(), data.begin(), data.end());
+}
+
+} // namespace
+
+bool is_push_only(byte_span script)
+{
+   script_iterator it(script);
+   script_op op;
+   while (it.next(op))
+   {
+      if (op.opcode > OP_16)
+         return false;
+   }
+   return !it.failed();
+}
+
+bool is_p2sh(byte_span script)
+{
+   return script.size() == 23 && script[0] == OP_HASH160 && script[1] == 20 && script[22] == OP_EQUAL;
+}
+
+bool is_witness_program(byte_span script)
+{
+   if (script.size() < 4 || script.size() > 42)
+      return false;
+   if (script[0] != OP_0 && (script[0] < OP_1 || script[0] > OP_16))
+      return false;
+   return script[1] + 2U == script.size();
+}
+
+void disassemble(byte_span script, std::string& out)
+{
+   script_iterator it(script);
+   script_op op;
+   bool first = true;
+   while (it.next(op))
+   {
+      if (!first)
+         out += ' ';
+      first = false;
+      if (op.opcode > 0 && op.opcode < OP_PUSHDATA1)
+         append_hex(op.data, out);
+      else
+      {
+         out += opcode_table[op.opcode].name;
+         if (op.opcode >= OP_PUSHDATA1 && op.opcode <= OP_PUSHDATA4)
+         {
+            out += ' ';
+            if (op.data.empty())
+               out += "0x";
+            append_hex(op.data, out);
+         }
+      }
+   }
+   if (it.failed())
+      out += first ? "[error]" : " [error]";
+}
+
+std::string disassemble(byte_span script)
+{
+   std::string ret_val;
+   ret_val.reserve(script.size() * 2);
+   disassemble(script, ret_val);
+   return ret_val;
+}
+
+namespace {
+
+std::vector<uint8_t> parse_hex(const std::string& word)
+{
+   if (word.compare(0, 2, "0x") == 0)
+      return from_hex(word.substr(2));
+   return from_hex(word);
+}
+
+} // namespace
+
+std::vector<uint8_t> assemble(const std::string& text)
+{
+   const std::unordered_map<std::string, uint8_t>& names = opcodes_by_name();
+   std::vector<uint8_t> ret_val;
+   std::istringstream in(text);
+   std::string word;
+   while (in >> word)
+   {
+      auto itr = names.find(word);
+      if (itr == names.end())
+      {
+         try
+         {
+            append_push(ret_val, 0, parse_hex(word));
+         }
+         catch (const std::invalid_argument&)
+         {
+            throw std::invalid_argument("not an opcode or hex: " + word);
+         }
+         continue;
+      }
+      uint8_t opcode = itr->second;
+      if (opcode >= OP_PUSHDATA1 && opcode <= OP_PUSHDATA4)
+      {
+         if (!(in >> word))
+            throw std::invalid_argument(std::string(opcode_name(opcode)) + " needs data");
+         append_push(ret_val, opcode, parse_hex(word));
+      }
+      else
+         ret_val.push_back(opcode);
+   }
+   return ret_val;
+}
+
+} // namespace bc_toolbox
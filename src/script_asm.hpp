@@ -0,0 +1,166 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <span.hpp>
+#include <hex_conversion.hpp>
+
+namespace bc_toolbox {
+
+/*****
+ * What an opcode does
+ */
+enum class opcode_type : uint8_t
+{
+   push_data, // pushes the bytes that follow it
+   number, // pushes a small number (OP_0, OP_1NEGATE, OP_1 to OP_16)
+   flow_control,
+   stack,
+   splice,
+   bitwise_logic,
+   arithmetic,
+   crypto,
+   locktime,
+   nop,
+   reserved, // fails the script if run
+   invalid // not an opcode
+};
+
+class opcode_info
+{
+   public:
+      const char* name; // "OP_DUP", or "OP_UNKNOWN" for bytes that are not opcodes
+      opcode_type type;
+      bool disabled; // fails the script even if not run
+};
+
+/***
+ * One entry per byte value, built at compile time
+ */
+extern const opcode_info opcode_table[256];
+
+inline const opcode_info& get_opcode_info(uint8_t opcode) { return opcode_table[opcode]; }
+/***
+ * @returns the name of the opcode (never throws)
+ */
+inline const char* opcode_name(uint8_t opcode) { return opcode_table[opcode].name; }
+
+/***
+ * @brief read the next opcode and the data it pushes, if any
+ * @param pc where to read; moved past the opcode and its data
+ * @param end the end of the script
+ * @param opcode the opcode
+ * @param data the pushed bytes (empty if the opcode is not a push)
+ * @returns false if the script ends part way through a push
+ */
+inline bool read_opcode(const uint8_t*& pc, const uint8_t* end, uint8_t& opcode, byte_span& data)
+{
+   opcode = *pc++;
+   data = byte_span();
+   if (opcode > OP_PUSHDATA4)
+      return true;
+   size_t size = opcode;
+   if (opcode >= OP_PUSHDATA1)
+   {
+      size_t width = opcode == OP_PUSHDATA1 ? 1 : opcode == OP_PUSHDATA2 ? 2 : 4;
+      if ((size_t)(end - pc) < width)
+         return false;
+      size = 0;
+      for(size_t i = 0; i < width; ++i)
+         size |= (size_t)pc[i] << (8 * i);
+      pc += width;
+   }
+   if ((size_t)(end - pc) < size)
+      return false;
+   data = byte_span(pc, size);
+   pc += size;
+   return true;
+}
+
+/*****
+ * One opcode of a script
+ */
+class script_op
+{
+   public:
+      uint8_t opcode;
+      byte_span data; // points into the script
+      size_t offset; // where the opcode starts
+};
+
+/*****
+ * Walks the opcodes of a script without copying it
+ *
+ * script_iterator it(bytes);
+ * script_op op;
+ * while (it.next(op))
+ *    ...
+ * if (it.failed())
+ *    // the script ends part way through a push
+ */
+class script_iterator
+{
+   public:
+      script_iterator(byte_span script) : pc(script.begin()), begin(script.begin()), end(script.end()), bad(false) {}
+      /***
+       * @param op where to put the next opcode
+       * @returns false at the end of the script (or on a truncated push)
+       */
+      bool next(script_op& op)
+      {
+         if (pc >= end || bad)
+            return false;
+         op.offset = pc - begin;
+         if (!read_opcode(pc, end, op.opcode, op.data))
+         {
+            bad = true;
+            return false;
+         }
+         return true;
+      }
+      bool failed() const { return bad; }
+      size_t offset() const { return pc - begin; }
+   private:
+      const uint8_t* pc;
+      const uint8_t* begin;
+      const uint8_t* end;
+      bool bad;
+};
+
+/***
+ * @returns true if the script only pushes data (and parses)
+ */
+bool is_push_only(byte_span script);
+/***
+ * @returns true if the script is a P2SH output script (OP_HASH160 <20 bytes> OP_EQUAL)
+ */
+bool is_p2sh(byte_span script);
+/***
+ * @returns true if the script is a witness program (a version opcode and one push of 2 to 40 bytes)
+ */
+bool is_witness_program(byte_span script);
+
+/***
+ * @brief convert a script to text. Opcodes are written by name and pushed
+ * data as hex (after the OP_PUSHDATA1/2/4 name if one was used, with "0x"
+ * for no data). A script that ends part way through a push ends with "[error]".
+ * @param script the script
+ * @param out where to append the text
+ */
+void disassemble(byte_span script, std::string& out);
+std::string disassemble(byte_span script);
+
+/***
+ * @brief convert text from disassemble back to a script. Hex words become
+ * the smallest push that holds them, unless they follow OP_PUSHDATA1/2/4.
+ * Hex may start with "0x".
+ * OP_FALSE, OP_TRUE, OP_NOP2 and OP_NOP3 are also accepted.
+ * @param text opcode names and hex, separated by white space
+ * @returns the script
+ * @throws std::invalid_argument if a word is not an opcode name or hex
+ */
+std::vector<uint8_t> assemble(const std::string& text);
+
+} // namespace bc_toolbox
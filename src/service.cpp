@@ -0,0 +1,266 @@
+#include <sstream>
+#include <chrono>
+#include <ctime>
+#include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
+
+#include <service.hpp>
+#include <hash.hpp>
+#include <hex.hpp>
+#include <base58.hpp>
+#include <htlc.hpp>
+#include <script.hpp>
+#include <transaction.hpp>
+
+namespace bc_toolbox {
+
+const size_t latency_histogram::bucket_count;
+
+latency_histogram::latency_histogram()
+{
+   for(auto& c : counts)
+      c.store(0);
+}
+
+void latency_histogram::record(uint64_t microseconds)
+{
+   size_t bucket = 0;
+   while (bucket < bucket_count - 1 && (microseconds >> bucket) != 0)
+      ++bucket;
+   counts[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t latency_histogram::count() const
+{
+   uint64_t ret_val = 0;
+   for(const auto& c : counts)
+      ret_val += c.load(std::memory_order_relaxed);
+   return ret_val;
+}
+
+std::array<uint64_t, latency_histogram::bucket_count> latency_histogram::buckets() const
+{
+   std::array<uint64_t, bucket_count> ret_val;
+   for(size_t i = 0; i < bucket_count; ++i)
+      ret_val[i] = counts[i].load(std::memory_order_relaxed);
+   return ret_val;
+}
+
+uint64_t latency_histogram::percentile(double fraction) const
+{
+   std::array<uint64_t, bucket_count> snapshot = buckets();
+   uint64_t total = 0;
+   for(uint64_t c : snapshot)
+      total += c;
+   if (total == 0)
+      return 0;
+   uint64_t wanted = (uint64_t)(fraction * total);
+   if (wanted == 0)
+      wanted = 1;
+   uint64_t seen = 0;
+   for(size_t i = 0; i < bucket_count; ++i)
+   {
+      seen += snapshot[i];
+      if (seen >= wanted)
+         return (uint64_t)1 << i;
+   }
+   return (uint64_t)1 << (bucket_count - 1);
+}
+
+namespace {
+
+const char* names[] = { "hash160", "hash256", "redeem_script", "script_address",
+      "add_preimage", "timeout", "stats" };
+
+void require_args(const std::vector<std::string>& args, size_t count)
+{
+   if (args.size() != count)
+      throw std::invalid_argument("expected " + std::to_string(count) + " arguments");
+}
+
+std::vector<uint8_t> hex_or_text(const std::string& kind, const std::string& data)
+{
+   if (kind == "hex")
+      return from_hex(data);
+   if (kind == "text")
+      return std::vector<uint8_t>(data.begin(), data.end());
+   throw std::invalid_argument("expected hex or text");
+}
+
+bool parse_network(const std::string& network)
+{
+   if (network == "testnet")
+      return true;
+   if (network != "mainnet")
+      throw std::invalid_argument("expected testnet or mainnet");
+   return false;
+}
+
+uint32_t parse_number(const std::string& in)
+{
+   char* end = nullptr;
+   unsigned long ret_val = std::strtoul(in.c_str(), &end, 10);
+   if (in.empty() || *end != 0 || ret_val > 0xffffffffUL)
+      throw std::invalid_argument("invalid number " + in);
+   return ret_val;
+}
+
+/***
+ * HTLC arguments: HASHLOCK RECEIVER_PUBKEY TIMELOCK SENDER_PUBKEY
+ */
+htlc_params parse_htlc(const std::vector<std::string>& args, size_t first)
+{
+   htlc_params ret_val;
+   std::vector<uint8_t> hashlock = from_hex(args[first]);
+   if (hashlock.size() != 20)
+      throw std::invalid_argument("hashlock must be 20 bytes");
+   std::copy(hashlock.begin(), hashlock.end(), ret_val.hashlock.begin());
+   ret_val.recipient_pubkey_hash = hash160(from_hex(args[first + 1]));
+   ret_val.locktime = parse_number(args[first + 2]);
+   ret_val.sender_pubkey_hash = hash160(from_hex(args[first + 3]));
+   return ret_val;
+}
+
+uint64_t minutes_per(const std::string& metric)
+{
+   std::string lower(metric);
+   std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+   if (lower == "minutes")
+      return 1;
+   if (lower == "hours")
+      return 60;
+   if (lower == "days")
+      return 60 * 24;
+   throw std::invalid_argument("expected minutes, hours or days");
+}
+
+} // namespace
+
+const char* service::operation_name(operation op)
+{
+   return op < op_count ? names[op] : "unknown";
+}
+
+std::string service::execute(const std::string& request)
+{
+   std::istringstream in(request);
+   std::string id;
+   std::string name;
+   in >> id >> name;
+   if (id.empty())
+      return "- error empty request";
+   size_t op = std::find(names, names + op_count, name) - names;
+   if (op == op_count)
+      return id + " error unknown operation " + name;
+   std::vector<std::string> args;
+   std::string arg;
+   while (in >> arg)
+   {
+      args.push_back(arg);
+      // text to hash is the rest of the line after one separator, so it
+      // may hold spaces, or be empty
+      if ((op == op_hash160 || op == op_hash256) && args.size() == 1 && arg == "text")
+      {
+         std::streamoff pos = in.tellg();
+         if (pos >= 0 && (size_t)pos < request.size())
+            args.push_back(request.substr(pos + 1));
+         break;
+      }
+   }
+
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+   std::string ret_val;
+   try
+   {
+      ret_val = id + " ok " + run((operation)op, args);
+   }
+   catch (const std::exception& e)
+   {
+      ret_val = id + " error " + e.what();
+   }
+   histograms[op].record(std::chrono::duration_cast<std::chrono::microseconds>(
+         std::chrono::steady_clock::now() - start).count());
+   return ret_val;
+}
+
+std::string service::run(operation op, const std::vector<std::string>& args)
+{
+   switch(op)
+   {
+      case op_hash160:
+         require_args(args, 2);
+         return to_hex(hash160(hex_or_text(args[0], args[1])));
+      case op_hash256:
+      {
+         require_args(args, 2);
+         digest256 digest;
+         sha256(hex_or_text(args[0], args[1]), digest.data());
+         return to_hex(digest);
+      }
+      case op_redeem_script:
+         require_args(args, 5);
+         parse_network(args[0]);
+         return to_hex(htlc_script(parse_htlc(args, 1)));
+      case op_script_address:
+      {
+         require_args(args, 5);
+         bool testnet = parse_network(args[0]);
+         digest160 script_hash = hash160(htlc_script(parse_htlc(args, 1)));
+         // 0x05 for mainnet, or 0xc4 for testnet
+         uint8_t payload[21];
+         payload[0] = testnet ? 0xc4 : 0x05;
+         std::copy(script_hash.begin(), script_hash.end(), payload + 1);
+         return base58check_encode(byte_span(payload, 21));
+      }
+      case op_add_preimage:
+      {
+         require_args(args, 3);
+         std::vector<uint8_t> preimage(args[1].begin(), args[1].end());
+         std::vector<uint8_t> public_key = from_hex(args[2]);
+         script new_script;
+         new_script.add_bytes_with_size(public_key);
+         new_script.add_bytes_with_size(preimage);
+         transaction tx(from_hex(args[0]));
+         if (tx.get_inputs().empty())
+            throw std::invalid_argument("transaction has no inputs");
+         input& in = tx.edit_inputs().at(0);
+         std::vector<uint8_t> merged_script = new_script.release();
+         merged_script.insert(merged_script.end(), in.sig_script.begin(), in.sig_script.end());
+         in.sig_script = merged_script;
+         return to_hex(tx.to_bytes());
+      }
+      case op_timeout:
+      {
+         require_args(args, 2);
+         uint64_t minutes = parse_number(args[0]) * minutes_per(args[1]);
+         return std::to_string((uint64_t)std::time(nullptr) + minutes * 60);
+      }
+      case op_stats:
+         require_args(args, 0);
+         return stats();
+      default:
+         throw std::invalid_argument("unknown operation");
+   }
+}
+
+std::string service::stats() const
+{
+   std::string ret_val;
+   for(size_t op = 0; op < op_count; ++op)
+   {
+      const latency_histogram& h = histograms[op];
+      uint64_t count = h.count();
+      if (count == 0)
+         continue;
+      if (!ret_val.empty())
+         ret_val += " ";
+      ret_val += std::string(names[op]) + ":n=" + std::to_string(count)
+            + ",p50<" + std::to_string(h.percentile(0.5)) + "us"
+            + ",p90<" + std::to_string(h.percentile(0.9)) + "us"
+            + ",p99<" + std::to_string(h.percentile(0.99)) + "us";
+   }
+   return ret_val;
+}
+
+} // namespace bc_toolbox
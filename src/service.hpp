@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace bc_toolbox {
+
+/*****
+ * Counts latencies in power-of-two buckets. Bucket i holds latencies
+ * below 2^i microseconds (the last bucket holds everything slower).
+ * Safe to record from several threads at once.
+ */
+class latency_histogram
+{
+   public:
+      static const size_t bucket_count = 32;
+      latency_histogram();
+      void record(uint64_t microseconds);
+      uint64_t count() const;
+      std::array<uint64_t, bucket_count> buckets() const;
+      /***
+       * @param fraction between 0 and 1 (e.g. 0.99)
+       * @returns the upper bound (in microseconds) of the bucket holding that percentile
+       */
+      uint64_t percentile(double fraction) const;
+   private:
+      std::array<std::atomic<uint64_t>, bucket_count> counts;
+};
+
+/*****
+ * The toolbox operations behind a line-based request format, so they can
+ * be served by a long-running process.
+ *
+ * A request is one line of space separated words: a client chosen id, the
+ * operation and its arguments. The response line starts with the same id,
+ * then "ok" and the result, or "error" and a message:
+ *
+ * hash160 [ hex | text ] DATA              HASH160 of DATA
+ * hash256 [ hex | text ] DATA              SHA-256 of DATA
+ * redeem_script [ testnet | mainnet ] HASHLOCK RECEIVER_PUBKEY TIMELOCK SENDER_PUBKEY
+ * script_address [ testnet | mainnet ] HASHLOCK RECEIVER_PUBKEY TIMELOCK SENDER_PUBKEY
+ * add_preimage SIGNED_TX_HEX PREIMAGE_TEXT PUBKEY
+ * timeout NUMBER [ minutes | hours | days ]    epoch time that far from now
+ * stats                                    latency percentiles per operation
+ *
+ * Keys, hashes and transactions are hex. Text DATA to hash is the rest of
+ * the line after the space that follows "text", so it may contain spaces,
+ * or be empty.
+ */
+class service
+{
+   public:
+      enum operation
+      {
+         op_hash160,
+         op_hash256,
+         op_redeem_script,
+         op_script_address,
+         op_add_preimage,
+         op_timeout,
+         op_stats,
+         op_count
+      };
+      static const char* operation_name(operation op);
+
+      /***
+       * @brief run one request. Safe to call from several threads at once.
+       * @param request the request line (without the line ending)
+       * @returns the response line (without the line ending)
+       */
+      std::string execute(const std::string& request);
+      const latency_histogram& latencies(operation op) const { return histograms[op]; }
+      /***
+       * @returns one line with the count and latency percentiles of each operation used so far
+       */
+      std::string stats() const;
+   private:
+      std::string run(operation op, const std::vector<std::string>& args);
+      std::array<latency_histogram, op_count> histograms;
+};
+
+} // namespace bc_toolbox
@@ -0,0 +1,232 @@
+#include <stdexcept>
+#include <cstring>
+
+#include <sighash.hpp>
+#include <script_asm.hpp>
+#include <hex_conversion.hpp>
+#include <compact_size.hpp>
+
+namespace bc_toolbox {
+
+namespace {
+
+void append(std::vector<uint8_t>& out, byte_span bytes)
+{
+   out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+void append_le(std::vector<uint8_t>& out, uint64_t value, size_t bytes)
+{
+   for(size_t i = 0; i < bytes; ++i)
+      out.push_back((uint8_t)(value >> (8 * i)));
+}
+
+void write_compact_size(sha256_context& ctx, uint64_t value)
+{
+   uint8_t encoded[9];
+   ctx.write(byte_span(encoded, encode_compact_size(value, encoded)));
+}
+
+void write_outpoint(sha256_context& ctx, const input& in)
+{
+   ctx.write(in.hash).write_le(in.index, 4);
+}
+
+/***
+ * @brief write a script with its length, leaving out OP_CODESEPARATORs
+ */
+void write_script_code(sha256_context& ctx, byte_span script_code)
+{
+   if (std::memchr(script_code.data(), OP_CODESEPARATOR, script_code.size()) == nullptr)
+   {
+      write_compact_size(ctx, script_code.size());
+      ctx.write(script_code);
+      return;
+   }
+   // the byte may be push data; only real OP_CODESEPARATORs are removed
+   size_t separators = 0;
+   script_iterator it(script_code);
+   script_op op;
+   while (it.next(op))
+      if (op.opcode == OP_CODESEPARATOR)
+         ++separators;
+   write_compact_size(ctx, script_code.size() - separators);
+   it = script_iterator(script_code);
+   size_t start = 0;
+   while (it.next(op))
+   {
+      if (op.opcode == OP_CODESEPARATOR)
+      {
+         ctx.write(script_code.subspan(start, op.offset - start));
+         start = it.offset();
+      }
+   }
+   ctx.write(script_code.subspan(start));
+}
+
+} // namespace
+
+sighash_cache::sighash_cache(const transaction& tx) : tx(tx)
+{
+   const std::vector<input>& inputs = tx.get_inputs();
+   const std::vector<output>& outputs = tx.get_outputs();
+
+   blank_inputs.reserve(inputs.size() * 41);
+   input_offsets.reserve(inputs.size() + 1);
+   sha256_context prevouts;
+   sha256_context sequences;
+   for(const input& in : inputs)
+   {
+      input_offsets.push_back(blank_inputs.size());
+      append(blank_inputs, in.hash);
+      append_le(blank_inputs, in.index, 4);
+      blank_inputs.push_back(0);
+      append_le(blank_inputs, in.sequence, 4);
+      write_outpoint(prevouts, in);
+      sequences.write_le(in.sequence, 4);
+   }
+   input_offsets.push_back(blank_inputs.size());
+   prevouts.finalize_double(prevouts_hash.data());
+   sequences.finalize_double(sequence_hash.data());
+
+   output_offsets.reserve(outputs.size() + 1);
+   for(const output& out : outputs)
+   {
+      output_offsets.push_back(serialized_outputs.size());
+      append_le(serialized_outputs, out.value, 8);
+      uint8_t encoded[9];
+      append(serialized_outputs, byte_span(encoded, encode_compact_size(out.script.size(), encoded)));
+      append(serialized_outputs, out.script);
+   }
+   output_offsets.push_back(serialized_outputs.size());
+   sha256d(serialized_outputs, outputs_hash.data());
+
+   digest256 zero;
+   zero.fill(0);
+   segwit_prefix[0].write_le(tx.get_version(), 4).write(prevouts_hash).write(sequence_hash);
+   segwit_prefix[1].write_le(tx.get_version(), 4).write(prevouts_hash).write(zero);
+   segwit_prefix[2].write_le(tx.get_version(), 4).write(zero).write(zero);
+}
+
+digest256 sighash_cache::legacy(size_t input_index, byte_span script_code, uint32_t hash_type) const
+{
+   const std::vector<input>& inputs = tx.get_inputs();
+   const std::vector<output>& outputs = tx.get_outputs();
+   if (input_index >= inputs.size())
+      throw std::out_of_range("input index out of range");
+   const uint32_t base_type = hash_type & 0x1f;
+   const bool anyone_can_pay = (hash_type & SIGHASH_ANYONECANPAY) != 0;
+   digest256 ret_val;
+   if (base_type == SIGHASH_SINGLE && input_index >= outputs.size())
+   {
+      ret_val.fill(0);
+      ret_val[0] = 1;
+      return ret_val;
+   }
+
+   // the transaction, with only the signed input's script (replaced by the
+   // script code), and the outputs the hash type covers
+   byte_span blanks(blank_inputs);
+   const input& signed_input = inputs[input_index];
+   sha256_context ctx;
+   ctx.write_le(tx.get_version(), 4);
+   if (anyone_can_pay)
+      ctx.write_le(1, 1);
+   else
+      write_compact_size(ctx, inputs.size());
+   // with NONE and SINGLE, other inputs may change their sequence
+   const bool other_sequences = base_type != SIGHASH_NONE && base_type != SIGHASH_SINGLE;
+   if (!anyone_can_pay)
+   {
+      if (other_sequences)
+         ctx.write(blanks.first(input_offsets[input_index]));
+      else
+         for(size_t i = 0; i < input_index; ++i)
+            ctx.write(blanks.subspan(input_offsets[i], input_offsets[i + 1] - input_offsets[i] - 4)).write_le(0, 4);
+   }
+   write_outpoint(ctx, signed_input);
+   write_script_code(ctx, script_code);
+   ctx.write_le(signed_input.sequence, 4);
+   if (!anyone_can_pay)
+   {
+      if (other_sequences)
+         ctx.write(blanks.subspan(input_offsets[input_index + 1]));
+      else
+         for(size_t i = input_index + 1; i < inputs.size(); ++i)
+            ctx.write(blanks.subspan(input_offsets[i], input_offsets[i + 1] - input_offsets[i] - 4)).write_le(0, 4);
+   }
+
+   byte_span serialized(serialized_outputs);
+   if (base_type == SIGHASH_NONE)
+      ctx.write_le(0, 1);
+   else if (base_type == SIGHASH_SINGLE)
+   {
+      write_compact_size(ctx, input_index + 1);
+      // blank outputs (value -1, empty script) before the signed one
+      for(size_t i = 0; i < input_index; ++i)
+         ctx.write_le(0xffffffffffffffffULL, 8).write_le(0, 1);
+      ctx.write(serialized.subspan(output_offsets[input_index],
+            output_offsets[input_index + 1] - output_offsets[input_index]));
+   }
+   else
+   {
+      write_compact_size(ctx, outputs.size());
+      ctx.write(serialized);
+   }
+   ctx.write_le(tx.get_locktime(), 4).write_le(hash_type, 4);
+   ctx.finalize_double(ret_val.data());
+   return ret_val;
+}
+
+digest256 sighash_cache::segwit_v0(size_t input_index, byte_span script_code, uint64_t amount,
+      uint32_t hash_type) const
+{
+   const std::vector<input>& inputs = tx.get_inputs();
+   const std::vector<output>& outputs = tx.get_outputs();
+   if (input_index >= inputs.size())
+      throw std::out_of_range("input index out of range");
+   const uint32_t base_type = hash_type & 0x1f;
+   const bool anyone_can_pay = (hash_type & SIGHASH_ANYONECANPAY) != 0;
+
+   // start from the midstate after version | hashPrevouts | hashSequence
+   sha256_context ctx = segwit_prefix[anyone_can_pay ? 2
+         : (base_type == SIGHASH_NONE || base_type == SIGHASH_SINGLE) ? 1 : 0];
+   const input& signed_input = inputs[input_index];
+   write_outpoint(ctx, signed_input);
+   write_compact_size(ctx, script_code.size());
+   ctx.write(script_code);
+   ctx.write_le(amount, 8).write_le(signed_input.sequence, 4);
+   if (base_type != SIGHASH_SINGLE && base_type != SIGHASH_NONE)
+      ctx.write(outputs_hash);
+   else if (base_type == SIGHASH_SINGLE && input_index < outputs.size())
+   {
+      digest256 single;
+      size_t start = output_offsets[input_index];
+      sha256d(byte_span(serialized_outputs).subspan(start, output_offsets[input_index + 1] - start), single.data());
+      ctx.write(single);
+   }
+   else
+   {
+      digest256 zero;
+      zero.fill(0);
+      ctx.write(zero);
+   }
+   ctx.write_le(tx.get_locktime(), 4).write_le(hash_type, 4);
+   digest256 ret_val;
+   ctx.finalize_double(ret_val.data());
+   return ret_val;
+}
+
+digest256 legacy_signature_hash(const transaction& tx, size_t input_index, byte_span script_code,
+      uint32_t hash_type)
+{
+   return sighash_cache(tx).legacy(input_index, script_code, hash_type);
+}
+
+digest256 segwit_signature_hash(const transaction& tx, size_t input_index, byte_span script_code,
+      uint64_t amount, uint32_t hash_type)
+{
+   return sighash_cache(tx).segwit_v0(input_index, script_code, amount, hash_type);
+}
+
+} // namespace bc_toolbox
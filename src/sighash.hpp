@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <span.hpp>
+#include <hash.hpp>
+#include <transaction.hpp>
+
+namespace bc_toolbox {
+
+// signature hash types (the last byte of a signature)
+const uint32_t SIGHASH_ALL = 1;
+const uint32_t SIGHASH_NONE = 2;
+const uint32_t SIGHASH_SINGLE = 3;
+const uint32_t SIGHASH_ANYONECANPAY = 0x80;
+
+/*****
+ * Computes the hashes signed by the inputs of one transaction.
+ *
+ * Everything that does not depend on the input is done once, up front:
+ * the BIP143 hashPrevouts, hashSequence and hashOutputs, the SHA-256
+ * midstates after the BIP143 prefix, and the legacy serialization of the
+ * inputs (with empty scripts) and of the outputs. So signing or checking
+ * every input costs time linear in the number of inputs for segwit, and
+ * only hashing (no reserializing) for legacy inputs.
+ *
+ * The cache does not change after construction, so several threads may
+ * use one at once. The transaction must outlive it and not be modified.
+ */
+class sighash_cache
+{
+   public:
+      explicit sighash_cache(const transaction& tx);
+      /***
+       * @brief the hash signed by a pre-segwit signature
+       * @param input_index the input being signed
+       * @param script_code the script being run (OP_CODESEPARATORs are removed)
+       * @param hash_type the signature hash type
+       * @returns the hash (1 for SIGHASH_SINGLE without a matching output, as
+       * consensus requires)
+       * @throws std::out_of_range if input_index is not an input of the transaction
+       */
+      digest256 legacy(size_t input_index, byte_span script_code, uint32_t hash_type) const;
+      /***
+       * @brief the hash signed by a segwit version 0 signature (BIP143)
+       * @param input_index the input being signed
+       * @param script_code the script code (for P2WPKH, the equivalent P2PKH script)
+       * @param amount the amount of the output being spent
+       * @param hash_type the signature hash type
+       * @returns the hash
+       * @throws std::out_of_range if input_index is not an input of the transaction
+       */
+      digest256 segwit_v0(size_t input_index, byte_span script_code, uint64_t amount, uint32_t hash_type) const;
+
+      const transaction& get_transaction() const { return tx; }
+      const digest256& hash_prevouts() const { return prevouts_hash; }
+      const digest256& hash_sequence() const { return sequence_hash; }
+      const digest256& hash_outputs() const { return outputs_hash; }
+   private:
+      const transaction& tx;
+      digest256 prevouts_hash;
+      digest256 sequence_hash;
+      digest256 outputs_hash;
+      // version | hashPrevouts | hashSequence, with both hashes, with a zero
+      // hashSequence (NONE and SINGLE), and with both zero (ANYONECANPAY)
+      sha256_context segwit_prefix[3];
+      // every input with an empty script, and where each starts (plus the end)
+      std::vector<uint8_t> blank_inputs;
+      std::vector<size_t> input_offsets;
+      // every output, and where each starts (plus the end)
+      std::vector<uint8_t> serialized_outputs;
+      std::vector<size_t> output_offsets;
+};
+
+/***
+ * @brief the hash signed by a pre-segwit signature
+ * @see sighash_cache::legacy. When signing several inputs, use a
+ * sighash_cache instead.
+ */
+digest256 legacy_signature_hash(const transaction& tx, size_t input_index, byte_span script_code,
+      uint32_t hash_type);
+
+/***
+ * @brief the hash signed by a segwit version 0 signature (BIP143)
+ * @see sighash_cache::segwit_v0. When signing several inputs, use a
+ * sighash_cache instead.
+ */
+digest256 segwit_signature_hash(const transaction& tx, size_t input_index, byte_span script_code,
+      uint64_t amount, uint32_t hash_type);
+
+} // namespace bc_toolbox
@@ -0,0 +1,288 @@
+#include <memory>
+#include <future>
+#include <stdexcept>
+#include <algorithm>
+
+#ifdef HAVE_SECP256K1
+#include <secp256k1.h>
+#else
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+#include <openssl/bn.h>
+#include <openssl/obj_mac.h>
+#endif
+
+#include <signature.hpp>
+#include <script_asm.hpp>
+
+namespace bc_toolbox {
+
+namespace {
+
+#ifdef HAVE_SECP256K1
+/***
+ * @returns the verification context, created once and shared by every thread
+ * (verifying does not modify it)
+ */
+const secp256k1_context* verify_context()
+{
+   static const secp256k1_context* context = secp256k1_context_create(SECP256K1_CONTEXT_VERIFY);
+   return context;
+}
+#else
+// OpenSSL 3.0 deprecates the EC_KEY interface, but its replacement (EVP_PKEY)
+// allocates a key per call. This is only the fallback for when libsecp256k1
+// is not available.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+
+/*****
+ * The OpenSSL objects for a verification, reused by each call on a thread
+ */
+class openssl_verifier
+{
+   public:
+      openssl_verifier() : group(EC_GROUP_new_by_curve_name(NID_secp256k1)), key(EC_KEY_new()),
+            point(group != nullptr ? EC_POINT_new(group) : nullptr), sig(ECDSA_SIG_new()), r(BN_new()), s(BN_new())
+      {
+         // once the signature owns r and s, it frees them
+         owned = sig != nullptr && r != nullptr && s != nullptr && ECDSA_SIG_set0(sig, r, s) == 1;
+         ready = owned && key != nullptr && point != nullptr && EC_KEY_set_group(key, group) == 1;
+      }
+      ~openssl_verifier()
+      {
+         if (!owned)
+         {
+            BN_free(r);
+            BN_free(s);
+         }
+         ECDSA_SIG_free(sig);
+         EC_POINT_free(point);
+         EC_KEY_free(key);
+         EC_GROUP_free(group);
+      }
+      bool verify(const ecdsa_signature& signature, byte_span pubkey, const digest256& hash)
+      {
+         if (!ready || pubkey.empty()
+               || EC_POINT_oct2point(group, point, pubkey.data(), pubkey.size(), nullptr) != 1
+               || EC_KEY_set_public_key(key, point) != 1)
+            return false;
+         // the signature owns r and s, which are overwritten in place
+         if (BN_bin2bn(signature.r.data(), 32, r) == nullptr || BN_bin2bn(signature.s.data(), 32, s) == nullptr)
+            return false;
+         return ECDSA_do_verify(hash.data(), hash.size(), sig, key) == 1;
+      }
+   private:
+      EC_GROUP* group;
+      EC_KEY* key;
+      EC_POINT* point;
+      ECDSA_SIG* sig;
+      BIGNUM* r;
+      BIGNUM* s;
+      bool owned;
+      bool ready;
+};
+#endif
+
+/***
+ * @brief copy a DER integer into 32 big-endian bytes
+ * @returns false if it does not fit
+ */
+bool read_integer(const uint8_t* in, size_t size, std::array<uint8_t, 32>& out)
+{
+   while (size > 0 && in[0] == 0)
+   {
+      ++in;
+      --size;
+   }
+   if (size > 32)
+      return false;
+   out.fill(0);
+   std::copy(in, in + size, out.end() - size);
+   return true;
+}
+
+/***
+ * @returns the last push of a scriptSig (the redeem script, for P2SH)
+ */
+byte_span last_push(byte_span script_sig)
+{
+   script_iterator it(script_sig);
+   script_op op;
+   byte_span ret_val;
+   while (it.next(op))
+      ret_val = op.data;
+   return ret_val;
+}
+
+} // namespace
+
+bool ecdsa_signature::parse_der(byte_span der)
+{
+   // 0x30 <total length> 0x02 <length of r> <r> 0x02 <length of s> <s>
+   size_t size = der.size();
+   if (size < 8 || size > 72)
+      return false;
+   if (der[0] != 0x30 || der[1] != size - 2 || der[2] != 0x02)
+      return false;
+   size_t r_size = der[3];
+   if (r_size == 0 || 5 + r_size >= size)
+      return false;
+   size_t s_size = der[5 + r_size];
+   if (s_size == 0 || r_size + s_size + 6 != size || der[4 + r_size] != 0x02)
+      return false;
+   const uint8_t* r_bytes = der.data() + 4;
+   const uint8_t* s_bytes = der.data() + 6 + r_size;
+   // no negative values, and no unneeded leading zeros
+   if ((r_bytes[0] & 0x80) || (r_size > 1 && r_bytes[0] == 0 && !(r_bytes[1] & 0x80)))
+      return false;
+   if ((s_bytes[0] & 0x80) || (s_size > 1 && s_bytes[0] == 0 && !(s_bytes[1] & 0x80)))
+      return false;
+   return read_integer(r_bytes, r_size, r) && read_integer(s_bytes, s_size, s);
+}
+
+bool verify_ecdsa(const ecdsa_signature& signature, byte_span pubkey, const digest256& hash)
+{
+#ifdef HAVE_SECP256K1
+   const secp256k1_context* context = verify_context();
+   secp256k1_pubkey key;
+   if (pubkey.empty() || secp256k1_ec_pubkey_parse(context, &key, pubkey.data(), pubkey.size()) != 1)
+      return false;
+   // r and s were already taken from strict DER
+   uint8_t compact[64];
+   std::copy(signature.r.begin(), signature.r.end(), compact);
+   std::copy(signature.s.begin(), signature.s.end(), compact + 32);
+   secp256k1_ecdsa_signature sig;
+   if (secp256k1_ecdsa_signature_parse_compact(context, &sig, compact) != 1)
+      return false;
+   // libsecp256k1 only accepts low S, but consensus accepts either
+   secp256k1_ecdsa_signature_normalize(context, &sig, &sig);
+   return secp256k1_ecdsa_verify(context, &sig, hash.data(), &key) == 1;
+#else
+   static thread_local openssl_verifier verifier;
+   return verifier.verify(signature, pubkey, hash);
+#endif
+}
+
+#ifndef HAVE_SECP256K1
+#pragma GCC diagnostic pop
+#endif
+
+transaction_checker::transaction_checker(const sighash_cache& hashes, size_t input_index, uint64_t amount,
+      bool witness_v0)
+      : dry_run_checker(hashes.get_transaction().get_version(), hashes.get_transaction().get_locktime(),
+            hashes.get_transaction().get_inputs().at(input_index).sequence),
+        hashes(hashes), input_index(input_index), amount(amount), witness_v0(witness_v0), cached(false)
+{
+}
+
+bool transaction_checker::check_signature(byte_span signature, byte_span pubkey, byte_span script_code) const
+{
+   if (signature.empty())
+      return false;
+   uint32_t hash_type = signature[signature.size() - 1];
+   ecdsa_signature parsed;
+   if (!parsed.parse_der(signature.first(signature.size() - 1)))
+      return false;
+   if (!cached || cached_type != hash_type || cached_script.data() != script_code.data()
+         || cached_script.size() != script_code.size())
+   {
+      cached_hash = witness_v0 ? hashes.segwit_v0(input_index, script_code, amount, hash_type)
+            : hashes.legacy(input_index, script_code, hash_type);
+      cached_type = hash_type;
+      cached_script = script_code;
+      cached = true;
+   }
+   return verify_ecdsa(parsed, pubkey, cached_hash);
+}
+
+namespace {
+
+/***
+ * @brief check the witness of an input against the witness program it spends
+ */
+script_error verify_witness_program(const sighash_cache& hashes, size_t input_index, uint64_t amount,
+      byte_span witness_program, interpreter& interp, uint32_t flags)
+{
+   if (witness_program[0] != OP_0)
+      return script_error::unsupported_witness;
+   const witness_stacks& witnesses = hashes.get_transaction().get_witnesses();
+   size_t count = witnesses.item_count(input_index);
+   // reused, like the interpreter, so that checking does not allocate
+   static thread_local std::vector<byte_span> items;
+   items.clear();
+   for(size_t i = 0; i < count; ++i)
+      items.push_back(witnesses.item(input_index, i));
+   transaction_checker checker(hashes, input_index, amount, true);
+   return interp.verify_witness_v0(witness_program.subspan(2), items, checker, flags);
+}
+
+script_error verify_input(const sighash_cache& hashes, size_t input_index, const spent_output& spent, uint32_t flags)
+{
+   const transaction& tx = hashes.get_transaction();
+   const input& in = tx.get_inputs().at(input_index);
+   byte_span script_sig(in.sig_script);
+   byte_span script_pubkey(spent.script_pubkey);
+   // one interpreter per thread, reused so that checking does not allocate
+   static thread_local interpreter interp;
+   if ((flags & verify_witness) != 0)
+   {
+      if (is_witness_program(script_pubkey))
+      {
+         if (!script_sig.empty())
+            return script_error::witness_malleated;
+         return verify_witness_program(hashes, input_index, spent.amount, script_pubkey, interp, flags);
+      }
+      byte_span redeem_script = last_push(script_sig);
+      if ((flags & verify_p2sh) != 0 && is_p2sh(script_pubkey) && is_witness_program(redeem_script))
+      {
+         // the scriptSig may only push the program
+         if (script_sig.size() != redeem_script.size() + 1)
+            return script_error::witness_malleated_p2sh;
+         digest160 script_hash = hash160(redeem_script);
+         if (!std::equal(script_hash.begin(), script_hash.end(), script_pubkey.begin() + 2))
+            return script_error::eval_false;
+         return verify_witness_program(hashes, input_index, spent.amount, redeem_script, interp, flags);
+      }
+   }
+   transaction_checker checker(hashes, input_index, spent.amount);
+   script_error ret_val = interp.verify(script_sig, script_pubkey, checker, flags);
+   if (ret_val == script_error::ok && (flags & verify_witness) != 0 && tx.get_witnesses().item_count(input_index) != 0)
+      return script_error::witness_unexpected;
+   return ret_val;
+}
+
+} // namespace
+
+script_error verify_input(const transaction& tx, size_t input_index, const spent_output& spent, uint32_t flags)
+{
+   return verify_input(sighash_cache(tx), input_index, spent, flags);
+}
+
+std::vector<script_error> verify_inputs(const transaction& tx, span<const spent_output> spent,
+      thread_pool& pool, uint32_t flags)
+{
+   size_t count = tx.get_inputs().size();
+   if (spent.size() != count)
+      throw std::invalid_argument("need one spent output per input");
+   std::vector<script_error> ret_val(count);
+   // computed once, and shared by every input
+   const sighash_cache hashes(tx);
+   // a few inputs per job, so small jobs do not swamp the queue
+   size_t per_job = std::max<size_t>(1, count / (pool.size() * 4));
+   std::vector<std::future<void> > jobs;
+   for(size_t start = 0; start < count; start += per_job)
+   {
+      size_t end = std::min(count, start + per_job);
+      jobs.push_back(pool.submit( [&hashes, &spent, &ret_val, start, end, flags]()
+            {
+               for(size_t i = start; i < end; ++i)
+                  ret_val[i] = verify_input(hashes, i, spent[i], flags);
+            }));
+   }
+   for(auto& job : jobs)
+      job.get();
+   return ret_val;
+}
+
+} // namespace bc_toolbox
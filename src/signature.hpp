@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+
+#include <span.hpp>
+#include <hash.hpp>
+#include <transaction.hpp>
+#include <interpreter.hpp>
+#include <sighash.hpp>
+#include <thread_pool.hpp>
+
+namespace bc_toolbox {
+
+/*****
+ * An ECDSA signature, parsed from DER
+ */
+class ecdsa_signature
+{
+   public:
+      std::array<uint8_t, 32> r; // big-endian
+      std::array<uint8_t, 32> s; // big-endian
+      /***
+       * @brief parse a strict DER signature (BIP66), without the sighash byte
+       * @param der the encoded signature
+       * @returns false if der is not strict DER or a value is too big
+       */
+      bool parse_der(byte_span der);
+};
+
+/***
+ * @brief check an ECDSA signature over secp256k1
+ * @param signature the signature
+ * @param pubkey the public key (33 bytes compressed or 65 uncompressed)
+ * @param hash the signed hash
+ * @returns true if the signature is valid
+ */
+bool verify_ecdsa(const ecdsa_signature& signature, byte_span pubkey, const digest256& hash);
+
+/*****
+ * The output an input spends
+ */
+class spent_output
+{
+   public:
+      uint64_t amount; // in satoshis
+      std::vector<uint8_t> script_pubkey;
+};
+
+/*****
+ * Checks signatures and lock times against one input of a transaction
+ */
+class transaction_checker : public dry_run_checker
+{
+   public:
+      /***
+       * @param hashes the signature hashes of the spending transaction (must
+       * outlive the checker; may be shared by checkers of other inputs)
+       * @param input_index the input being checked
+       * @param amount the amount of the output it spends
+       * @param witness_v0 true to check signatures against BIP143 hashes
+       * (for segwit version 0 spends), false for legacy hashes
+       */
+      transaction_checker(const sighash_cache& hashes, size_t input_index, uint64_t amount,
+            bool witness_v0 = false);
+      bool check_signature(byte_span signature, byte_span pubkey, byte_span script_code) const override;
+   private:
+      const sighash_cache& hashes;
+      size_t input_index;
+      uint64_t amount;
+      bool witness_v0;
+      // the last hash, as CHECKMULTISIG asks for the same one repeatedly
+      mutable bool cached;
+      mutable uint32_t cached_type;
+      mutable byte_span cached_script;
+      mutable digest256 cached_hash;
+};
+
+const uint32_t verify_inputs_default = verify_p2sh | verify_checklocktimeverify | verify_checksequenceverify
+      | verify_witness;
+
+/***
+ * @brief check one input's scriptSig (and witness) against the output it spends
+ * @returns script_error::ok if the input is valid, or why it is not
+ */
+script_error verify_input(const transaction& tx, size_t input_index, const spent_output& spent,
+      uint32_t flags = verify_inputs_default);
+
+/***
+ * @brief check every input of a transaction, several at once
+ * @param tx the transaction
+ * @param spent the output each input spends, in input order
+ * @param pool runs the checks
+ * @param flags verify_* flags
+ * @returns the result for each input
+ * @throws std::invalid_argument if there is not one spent output per input
+ */
+std::vector<script_error> verify_inputs(const transaction& tx, span<const spent_output> spent,
+      thread_pool& pool, uint32_t flags = verify_inputs_default);
+
+} // namespace bc_toolbox
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace bc_toolbox {
+
+/*****
+ * A non-owning view of a contiguous run of T. The caller must keep the
+ * underlying storage alive for as long as the span is in use.
+ */
+template <typename T>
+class span
+{
+   public:
+      typedef T element_type;
+      typedef T* iterator;
+
+      span() : ptr(nullptr), len(0) {}
+      span(T* data, size_t size) : ptr(data), len(size) {}
+      span(T* first, T* last) : ptr(first), len(last - first) {}
+      template <typename U, typename = typename std::enable_if<std::is_convertible<U(*)[], T(*)[]>::value>::type>
+      span(const span<U>& other) : ptr(other.data()), len(other.size()) {}
+      template <typename U, typename A, typename = typename std::enable_if<std::is_convertible<U(*)[], T(*)[]>::value>::type>
+      span(std::vector<U, A>& vec) : ptr(vec.data()), len(vec.size()) {}
+      template <typename U, typename A, typename = typename std::enable_if<std::is_convertible<const U(*)[], T(*)[]>::value>::type>
+      span(const std::vector<U, A>& vec) : ptr(vec.data()), len(vec.size()) {}
+      template <typename U, typename Tr, typename A, typename = typename std::enable_if<std::is_convertible<const U(*)[], T(*)[]>::value>::type>
+      span(const std::basic_string<U, Tr, A>& str) : ptr(str.data()), len(str.size()) {}
+      template <typename U, size_t N, typename = typename std::enable_if<std::is_convertible<U(*)[], T(*)[]>::value>::type>
+      span(std::array<U, N>& arr) : ptr(arr.data()), len(N) {}
+      template <typename U, size_t N, typename = typename std::enable_if<std::is_convertible<const U(*)[], T(*)[]>::value>::type>
+      span(const std::array<U, N>& arr) : ptr(arr.data()), len(N) {}
+
+      T* data() const { return ptr; }
+      size_t size() const { return len; }
+      bool empty() const { return len == 0; }
+      T* begin() const { return ptr; }
+      T* end() const { return ptr + len; }
+      T& operator[](size_t pos) const { return ptr[pos]; }
+      /***
+       * @brief a view of part of this span (no bounds checking)
+       * @param offset the first element of the new span
+       * @param count the number of elements in the new span
+       */
+      span subspan(size_t offset, size_t count) const { return span(ptr + offset, count); }
+      span subspan(size_t offset) const { return span(ptr + offset, len - offset); }
+      span first(size_t count) const { return span(ptr, count); }
+      std::vector<typename std::remove_const<T>::type> to_vector() const
+      {
+         return std::vector<typename std::remove_const<T>::type>(ptr, ptr + len);
+      }
+   private:
+      T* ptr;
+      size_t len;
+};
+
+typedef span<const uint8_t> byte_span;
+typedef span<uint8_t> mutable_byte_span;
+typedef span<const char> char_span;
+
+} // namespace bc_toolbox
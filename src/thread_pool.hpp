@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+
+namespace bc_toolbox {
+
+/*****
+ * A fixed-size pool of worker threads that run submitted jobs
+ */
+class thread_pool
+{
+   public:
+      /***
+       * @param threads the number of workers (0 means one per core)
+       */
+      explicit thread_pool(size_t threads = 0) : stopping(false)
+      {
+         if (threads == 0)
+            threads = std::thread::hardware_concurrency();
+         if (threads == 0)
+            threads = 1;
+         for(size_t i = 0; i < threads; ++i)
+            workers.emplace_back( [this]() { run(); } );
+      }
+      ~thread_pool()
+      {
+         {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+         }
+         condition.notify_all();
+         for(auto& t : workers)
+            t.join();
+      }
+      thread_pool(const thread_pool&) = delete;
+      thread_pool& operator=(const thread_pool&) = delete;
+
+      /***
+       * @brief queue a job
+       * @param job the function to run
+       * @returns a future that holds the result (or exception) of the job
+       */
+      template <typename F>
+      std::future<typename std::result_of<F()>::type> submit(F job)
+      {
+         typedef typename std::result_of<F()>::type result_type;
+         std::shared_ptr<std::packaged_task<result_type()> > task =
+               std::make_shared<std::packaged_task<result_type()> >(std::move(job));
+         std::future<result_type> ret_val = task->get_future();
+         {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping)
+               throw std::runtime_error("thread pool is stopping");
+            jobs.push( [task]() { (*task)(); } );
+         }
+         condition.notify_one();
+         return ret_val;
+      }
+      size_t size() const { return workers.size(); }
+   private:
+      void run()
+      {
+         for(;;)
+         {
+            std::function<void()> job;
+            {
+               std::unique_lock<std::mutex> lock(mutex);
+               condition.wait(lock, [this]() { return stopping || !jobs.empty(); } );
+               if (jobs.empty())
+                  return;
+               job = std::move(jobs.front());
+               jobs.pop();
+            }
+            job();
+         }
+      }
+      std::vector<std::thread> workers;
+      std::queue<std::function<void()> > jobs;
+      std::mutex mutex;
+      std::condition_variable condition;
+      bool stopping;
+};
+
+} // namespace bc_toolbox
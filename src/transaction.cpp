@@ -1,63 +1,208 @@
 #include <hex_conversion.hpp>
 #include "transaction.hpp"
+#include "transaction_view.hpp"
+#include "compact_size.hpp"
+
+#include <openssl/sha.h>
 
 #include <cstring>
 #include <cstdlib>
+#include <stdexcept>
 #include <algorithm>
 #include <iostream>
 
 namespace bc_toolbox {
 
-void transaction::add( std::vector<uint8_t>& vec, const std::vector<uint8_t>& bytes)
+byte_span witness_stacks::item(size_t stack, size_t pos) const
+{
+   if (pos >= item_count(stack))
+      throw std::out_of_range("no such witness item");
+   size_t index = stack_offsets[stack] + pos;
+   return byte_span(data.data() + item_offsets[index], item_offsets[index + 1] - item_offsets[index]);
+}
+
+void witness_stacks::add_item(byte_span item)
+{
+   if (size() == 0)
+      throw std::out_of_range("add_stack before adding items");
+   data.insert(data.end(), item.begin(), item.end());
+   item_offsets.push_back(data.size());
+   ++stack_offsets.back();
+}
+
+namespace {
+
+inline uint8_t* write_le(uint8_t* pos, uint64_t value, size_t bytes)
+{
+   for(size_t i = 0; i < bytes; ++i)
+      pos[i] = (uint8_t)(value >> (8 * i));
+   return pos + bytes;
+}
+
+inline uint8_t* write_compact_size(uint8_t* pos, uint64_t value)
+{
+   return pos + encode_compact_size(value, pos);
+}
+
+inline uint8_t* write_bytes(uint8_t* pos, const uint8_t* bytes, size_t size)
+{
+   if (size != 0)
+      std::memcpy(pos, bytes, size);
+   return pos + size;
+}
+
+/***
+ * @brief write bytes preceded by their length
+ */
+inline uint8_t* write_sized(uint8_t* pos, const uint8_t* bytes, size_t size)
+{
+   return write_bytes(write_compact_size(pos, size), bytes, size);
+}
+
+} // namespace
+
+size_t transaction::serialized_size(bool with_witness) const
+{
+   return with_witness ? total_size() : base_size();
+}
+
+uint8_t* transaction::write_to(uint8_t* out, bool with_witness) const
 {
-   vec.insert( vec.end(), bytes.begin(), bytes.end() );
+   const bool witness = with_witness && flag != 0;
+   uint8_t* pos = write_le(out, version, 4);
+   if (witness)
+   {
+      // marker and flag
+      *pos++ = (uint8_t)(flag >> 8);
+      *pos++ = (uint8_t)flag;
+   }
+   pos = write_compact_size(pos, inputs.size());
+   for(const input& in : inputs)
+   {
+      pos = write_bytes(pos, in.hash.data(), in.hash.size());
+      pos = write_le(pos, in.index, 4);
+      pos = write_sized(pos, in.sig_script.data(), in.sig_script.size());
+      pos = write_le(pos, in.sequence, 4);
+   }
+   pos = write_compact_size(pos, outputs.size());
+   for(const output& out : outputs)
+   {
+      pos = write_le(pos, out.value, 8);
+      pos = write_sized(pos, out.script.data(), out.script.size());
+   }
+   // one stack per input (inputs without one get an empty stack)
+   if (witness)
+   {
+      for(size_t i = 0; i < inputs.size(); ++i)
+      {
+         size_t count = witnesses.item_count(i);
+         pos = write_compact_size(pos, count);
+         for(size_t j = 0; j < count; ++j)
+         {
+            byte_span item = witnesses.item(i, j);
+            pos = write_sized(pos, item.data(), item.size());
+         }
+      }
+   }
+   return write_le(pos, locktime, 4);
+}
+
+size_t transaction::write_to(mutable_byte_span out, bool with_witness) const
+{
+   size_t size = serialized_size(with_witness);
+   if (out.size() < size)
+      throw std::out_of_range("buffer too small for the transaction");
+   write_to(out.data(), with_witness);
+   return size;
 }
 
-void transaction::add_input( std::vector<uint8_t>&vec, const input& in)
+std::vector<uint8_t> transaction::to_bytes() const
 {
-   add( vec, in.hash );
-   add( vec, little_endian( in.index, 4 ) );
-   add( vec, little_endian( in.sig_script.size(), 1 ) );
-   add( vec, in.sig_script );
-   add( vec, big_endian( in.sequence, 4 ) );
+   std::vector<uint8_t> ret_val(serialized_size(true));
+   write_to(ret_val.data(), true);
+   return ret_val;
 }
 
-void transaction::add_output( std::vector<uint8_t>& vec, const output& out )
-{ 
-   add( vec, little_endian( out.value, 8 ) );
-   add( vec, to_varint( out.script.size() ) ); 
-   add( vec, out.script );
+void transaction::compute_cache() const
+{
+   if (cache.valid)
+      return;
+   compute_layout();
+   std::vector<uint8_t> serialized = to_bytes();
+   hash_serialized(serialized.data());
 }
 
-void transaction::add_witness( std::vector<uint8_t>& vec, const witness& wit )
-{ 
-   add( vec, little_endian( wit.data.size(), 1 ) );
-   add( vec, wit.data );
+void transaction::hash_serialized(const uint8_t* data) const
+{
+   // the layout says where the witnesses are, so nothing is scanned again
+   size_t witness_begin = layout.base_size - 4 + 2;
+   size_t witness_end = layout.total_size - 4;
+   bool has_witness = layout.total_size != layout.base_size;
+   // txid skips the marker, flag and witnesses
+   uint8_t first[SHA256_DIGEST_LENGTH];
+   SHA256_CTX ctx;
+   SHA256_Init(&ctx);
+   if (has_witness)
+   {
+      SHA256_Update(&ctx, data, 4);
+      SHA256_Update(&ctx, data + 6, witness_begin - 6);
+      SHA256_Update(&ctx, data + witness_end, 4);
+   }
+   else
+      SHA256_Update(&ctx, data, layout.total_size);
+   SHA256_Final(first, &ctx);
+   SHA256(first, SHA256_DIGEST_LENGTH, cache.txid.data());
+   if (has_witness)
+      sha256d(byte_span(data, layout.total_size), cache.wtxid.data());
+   else
+      cache.wtxid = cache.txid;
+   cache.valid = true;
 }
 
-std::vector<uint8_t> transaction::to_bytes()
+void transaction::compute_layout() const
 {
-   std::vector<uint8_t> ret_val;
-   add( ret_val, little_endian(version, 4) );
+   if (layout.valid)
+      return;
+   // the same walk as the serializer, adding up lengths instead of writing
+   size_t pos = 4 + compact_size_length(inputs.size());
    if (flag != 0)
-      add( ret_val, big_endian(flag, 2) );
-   add( ret_val, little_endian( inputs.size(), 1 ) );
-   for(auto i : inputs)
-      add_input( ret_val, i );
-   add( ret_val, to_varint( outputs.size() ) );
-   for(auto i : outputs)
-      add_output( ret_val, i );
+      pos += 2;
+   layout.input_offsets.clear();
+   layout.input_offsets.reserve(inputs.size());
+   for(const input& in : inputs)
+   {
+      layout.input_offsets.push_back(pos);
+      pos += in.hash.size() + 4 + compact_size_length(in.sig_script.size()) + in.sig_script.size() + 4;
+   }
+   pos += compact_size_length(outputs.size());
+   layout.output_offsets.clear();
+   layout.output_offsets.reserve(outputs.size());
+   for(const output& out : outputs)
+   {
+      layout.output_offsets.push_back(pos);
+      pos += 8 + compact_size_length(out.script.size()) + out.script.size();
+   }
+   // the stacks, plus the marker and flag (already counted in pos)
+   size_t witness_bytes = 0;
    if (flag != 0)
    {
-   add( ret_val, to_varint( witnesses.size() ) );
-   for( auto i : witnesses )
-      add_witness( ret_val, i );
+      for(size_t i = 0; i < inputs.size(); ++i)
+      {
+         size_t count = witnesses.item_count(i);
+         witness_bytes += compact_size_length(count);
+         for(size_t j = 0; j < count; ++j)
+         {
+            size_t len = witnesses.item(i, j).size();
+            witness_bytes += compact_size_length(len) + len;
+         }
+      }
    }
-   add( ret_val, little_endian( locktime, 4) );
-   return ret_val;
+   layout.total_size = pos + witness_bytes + 4;
+   layout.base_size = layout.total_size - (flag != 0 ? witness_bytes + 2 : 0);
+   layout.valid = true;
 }
 
-void swap_bytes(uint8_t* in, uint8_t length, unsigned char* out)
+void swap_bytes(const uint8_t* in, uint8_t length, unsigned char* out)
 {
    memset(out, 0, length+1);
    uint8_t pos = 0;
@@ -67,55 +212,107 @@ void swap_bytes(uint8_t* in, uint8_t length, unsigned char* out)
    }
 }
 
-void transaction::parse_raw_transaction(std::vector<uint8_t> tx)
+void transaction::parse_raw_transaction(byte_span tx)
 {
+   // check the structure first, so the decoding below stays within tx
+   transaction_bounds bounds;
+   scan_error error = scan_transaction(tx, bounds);
+   if (error == scan_error::truncated)
+      throw std::out_of_range(scan_error_string(error));
+   if (error != scan_error::ok)
+      throw std::invalid_argument(scan_error_string(error));
    parsed = true;
    // convert raw_transaction to bytes
-   uint8_t* bytes = tx.data();
-   uint16_t bytes_read = 0;
+   const uint8_t* bytes = tx.data();
+   uint8_t width = 0;
    // version (4 bytes)
    unsigned char temp[9];
    char* ptr;
    swap_bytes(bytes, 4, temp);
    version = ( (temp[0]) << 24 | (temp[1]) << 16 | (temp[2]) << 8 | temp[3]) ;
    bytes += 4;
-   // flag (optional 1 bytes)
+   // marker and flag (0x00 0x01, only if there are witnesses)
    flag = 0;
-   if (bytes[0] == 0)
+   if (bytes[0] == 0 && bytes[1] == 1)
    {
-      flag = bc_toolbox::from_varint(bytes, bytes_read);
-      bytes += bytes_read;
+      flag = 1;
+      bytes += 2;
    }
    // inputs (number of inputs as varint)
-   uint64_t num_inputs = bc_toolbox::from_varint(bytes, bytes_read);
-   bytes += bytes_read;
+   uint64_t num_inputs = read_varint_unchecked(bytes, width);
+   bytes += width;
    inputs = std::vector<input>();
+   inputs.reserve(num_inputs);
+   // the sizes and offsets come along for free
+   layout.input_offsets.clear();
+   layout.input_offsets.reserve(num_inputs);
    // loop through inputs
    for(uint64_t i = 0; i < num_inputs; ++i)
    { 
+      layout.input_offsets.push_back(bytes - tx.data());
       uint64_t bytes_read = 0;
       input new_input(bytes, bytes_read);
       inputs.push_back(new_input);
       bytes += bytes_read;
    }
    // outputs (number of outputs as varint)
-   uint64_t num_outputs = bc_toolbox::from_varint(bytes, bytes_read);
-   bytes += bytes_read;
+   uint64_t num_outputs = read_varint_unchecked(bytes, width);
+   bytes += width;
+   outputs.reserve(num_outputs);
+   layout.output_offsets.clear();
+   layout.output_offsets.reserve(num_outputs);
    // loop through outputs
    for(uint64_t i = 0; i < num_outputs; ++i)
    {
+      layout.output_offsets.push_back(bytes - tx.data());
+      uint64_t bytes_read = 0;
       output new_output(bytes, bytes_read);
       outputs.push_back(new_output);
       bytes += bytes_read;
    }
-   // witnesses (omitted if flag above is not there)
+   const uint8_t* witness_begin = bytes;
+   // witnesses (omitted if flag above is not there), one stack per input
+   witnesses.clear();
    if (flag == 1)
    {
-
+      // size everything first, so the stacks are filled without reallocating
+      const uint8_t* pos = bytes;
+      size_t num_items = 0;
+      size_t num_bytes = 0;
+      for(uint64_t i = 0; i < num_inputs; ++i)
+      {
+         uint64_t count = read_varint_unchecked(pos, width);
+         pos += width;
+         num_items += count;
+         for(uint64_t j = 0; j < count; ++j)
+         {
+            uint64_t len = read_varint_unchecked(pos, width);
+            pos += width + len;
+            num_bytes += len;
+         }
+      }
+      witnesses.reserve(num_inputs, num_items, num_bytes);
+      for(uint64_t i = 0; i < num_inputs; ++i)
+      {
+         witnesses.add_stack();
+         uint64_t count = read_varint_unchecked(bytes, width);
+         bytes += width;
+         for(uint64_t j = 0; j < count; ++j)
+         {
+            uint64_t len = read_varint_unchecked(bytes, width);
+            bytes += width;
+            witnesses.add_item(byte_span(bytes, len));
+            bytes += len;
+         }
+      }
    }
    // locktime (4 bytes)
-   locktime = bytes[0];
-   return;
+   locktime = read_le32(bytes);
+   layout.total_size = bytes + 4 - tx.data();
+   layout.base_size = layout.total_size - (flag == 1 ? bytes - witness_begin + 2 : 0);
+   layout.valid = true;
+   // the hashes wait until they are asked for
+   cache.valid = false;
 }
 
 }
\ No newline at end of file
@@ -4,6 +4,9 @@
 #include <cstdint>
 
 #include <hex_conversion.hpp>
+#include <span.hpp>
+#include <hash.hpp>
+#include <transaction_view.hpp>
 
 namespace bc_toolbox {
 
@@ -11,26 +14,20 @@ class input
 {
    public:
       input() {};
-      input(uint8_t* bytes, uint64_t& bytes_read)
+      input(const uint8_t* bytes, uint64_t& bytes_read)
       {
-         uint8_t* pos = bytes;
-         for(uint8_t i = 0; i < 32; i++)
-         {
-            hash.push_back(pos[0]);
-            pos++;
-         }
-         index = pos[0];
+         const uint8_t* pos = bytes;
+         hash.assign(pos, pos + 32);
+         pos += 32;
+         index = read_le32(pos);
          pos += 4;
          // read length of signature script
-         uint16_t read = 0;
-         uint64_t script_length = from_varint(pos, read);
-         pos += read;
-         for(uint16_t i = 0; i < script_length; ++i)
-         {
-            sig_script.push_back(pos[0]);
-            pos++;
-         }
-         sequence = ( (pos[3]) << 24 | (pos[2]) << 16 | (pos[1]) << 8 | pos[0]);
+         uint8_t width = 0;
+         uint64_t script_length = read_varint_unchecked(pos, width);
+         pos += width;
+         sig_script.assign(pos, pos + script_length);
+         pos += script_length;
+         sequence = read_le32(pos);
          bytes_read = pos + 4 - bytes;
       }
       std::vector<uint8_t> hash;
@@ -43,23 +40,18 @@ class output
 {
    public:
       output() {};
-      output(uint8_t* bytes, uint16_t& bytes_read)
+      output(const uint8_t* bytes, uint64_t& bytes_read)
       {
          //8 bytes for value
-         uint8_t* pos = bytes;
-         unsigned char temp[9];
-         value = ( ((uint64_t)(bytes[7])) << 56 | ((uint64_t)(bytes[6])) << 48 | ((uint64_t)(bytes[5])) << 40 | ((uint64_t)(bytes[4])) << 32 
-               | (bytes[3]) << 24 | (bytes[2]) << 16 | (bytes[1]) << 8 | bytes[0]) ;
+         const uint8_t* pos = bytes;
+         value = read_le64(bytes);
          pos += 8;
          // read length of signature script
-         uint16_t read = 0;
-         uint64_t script_length = from_varint(pos, read);
-         pos += read;
-         for(uint16_t i = 0; i < script_length; ++i)
-         {
-            script.push_back(pos[0]);
-            pos++;
-         }
+         uint8_t width = 0;
+         uint64_t script_length = read_varint_unchecked(pos, width);
+         pos += width;
+         script.assign(pos, pos + script_length);
+         pos += script_length;
          bytes_read = pos - bytes;
       }
       uint64_t value; // value in satoshis
@@ -68,17 +60,89 @@ class output
       bool use_data = false;
 };
 
-class witness
+/*****
+ * The witness stacks of every input of a transaction, stored flat: the
+ * bytes of all items in one buffer, with a table of where each item
+ * starts and a table of where each input's stack starts. A parsed
+ * transaction's witnesses take three allocations, however many items
+ * they have.
+ */
+class witness_stacks
 {
    public:
+      witness_stacks() : item_offsets(1, 0), stack_offsets(1, 0) {}
+      /***
+       * @returns the number of stacks (one per input, once filled in)
+       */
+      size_t size() const { return stack_offsets.size() - 1; }
+      /***
+       * @returns true if no stack has any items
+       */
+      bool empty() const { return item_offsets.size() == 1; }
+      /***
+       * @returns the number of items in an input's stack (0 past the last stack)
+       */
+      size_t item_count(size_t stack) const
+      {
+         return stack < size() ? stack_offsets[stack + 1] - stack_offsets[stack] : 0;
+      }
+      /***
+       * @param stack the input
+       * @param pos the item, bottom of the stack first
+       * @returns the item
+       * @throws std::out_of_range if there is no such item
+       */
+      byte_span item(size_t stack, size_t pos) const;
+      /***
+       * @brief start the stack of the next input
+       */
+      void add_stack() { stack_offsets.push_back(stack_offsets.back()); }
+      /***
+       * @brief add an item to the top of the last stack
+       * @throws std::out_of_range if there is no stack yet
+       */
+      void add_item(byte_span item);
+      /***
+       * @brief make room, so filling in does not reallocate
+       */
+      void reserve(size_t stacks, size_t items, size_t bytes)
+      {
+         stack_offsets.reserve(stacks + 1);
+         item_offsets.reserve(items + 1);
+         data.reserve(bytes);
+      }
+      void clear()
+      {
+         data.clear();
+         item_offsets.resize(1);
+         stack_offsets.resize(1);
+      }
+   private:
       std::vector<uint8_t> data;
+      std::vector<uint32_t> item_offsets; // item i is data[item_offsets[i], item_offsets[i + 1])
+      std::vector<uint32_t> stack_offsets; // stack s is items [stack_offsets[s], stack_offsets[s + 1])
 };
 
 class transaction
 {
    public:
       transaction() {};
-      transaction(std::vector<uint8_t> raw_transaction)
+      /***
+       * @brief parse a transaction
+       * @param raw_transaction the serialized transaction
+       * @throws std::out_of_range if the transaction is truncated
+       * @throws std::invalid_argument if it is otherwise malformed
+       */
+      transaction(const std::vector<uint8_t>& raw_transaction)
+      {
+         parse_raw_transaction(raw_transaction);
+      }
+      /***
+       * @brief parse a transaction without first copying it into a vector
+       * @param raw_transaction the serialized transaction
+       * @throws as transaction(std::vector<uint8_t>)
+       */
+      transaction(byte_span raw_transaction)
       {
          parse_raw_transaction(raw_transaction);
       }
@@ -86,21 +150,125 @@ class transaction
        * @brief Retrieve the transaction as a vector of bytes
        * @returns the binary representation of the transaction
        */
-      std::vector<uint8_t> to_bytes();
-   public:
-      uint32_t version;
-      uint16_t flag; // segwit flag, if present, will always be 0001
+      std::vector<uint8_t> to_bytes() const;
+      /***
+       * @param with_witness true to count the marker, flag and witnesses
+       * (when the transaction has them)
+       * @returns the exact number of bytes write_to() writes
+       */
+      size_t serialized_size(bool with_witness = true) const;
+      /***
+       * @brief serialize straight into a buffer, such as a shared output
+       * buffer for many transactions
+       * @param out where to write. Must have room for serialized_size(with_witness) bytes
+       * @param with_witness false to leave out the witness data (as for the txid)
+       * @returns one past the last byte written
+       */
+      uint8_t* write_to(uint8_t* out, bool with_witness = true) const;
+      /***
+       * @brief serialize into a buffer, checking that it is big enough
+       * @returns the number of bytes written
+       * @throws std::out_of_range if out is too small
+       */
+      size_t write_to(mutable_byte_span out, bool with_witness = true) const;
+
+      // accessors
+      uint32_t get_version() const { return version; }
+      uint16_t get_flag() const { return flag; }
+      uint32_t get_locktime() const { return locktime; }
+      const std::vector<input>& get_inputs() const { return inputs; }
+      const std::vector<output>& get_outputs() const { return outputs; }
+      const witness_stacks& get_witnesses() const { return witnesses; }
+      // mutators. These invalidate the cached hashes and sizes, so do not
+      // hold on to a reference from edit_* across a call to txid() and friends
+      void set_version(uint32_t in) { modified(); version = in; }
+      void set_flag(uint16_t in) { modified(); flag = in; }
+      void set_locktime(uint32_t in) { modified(); locktime = in; }
+      std::vector<input>& edit_inputs() { modified(); return inputs; }
+      std::vector<output>& edit_outputs() { modified(); return outputs; }
+      witness_stacks& edit_witnesses() { modified(); return witnesses; }
+
+      /***
+       * The hashes below are computed together on first use, from the
+       * serialized transaction, and cached until it is modified. Parsing does
+       * not hash, so a transaction whose ids are never asked for costs no
+       * SHA-256. Note: the caches make these const methods unsafe to call
+       * from several threads at once on the same object.
+       */
+      /***
+       * @returns the transaction id (double SHA-256 of the serialization without witness data)
+       */
+      const digest256& txid() const { compute_cache(); return cache.txid; }
+      /***
+       * @returns the witness transaction id (equal to txid when there is no witness data)
+       */
+      const digest256& wtxid() const { compute_cache(); return cache.wtxid; }
+
+      /***
+       * The sizes and offsets below are recorded while parsing, so they
+       * cost nothing for a parsed transaction. After a modification they
+       * are recomputed from the fields on first use, without serializing.
+       */
+      /***
+       * @returns the size in bytes without witness data
+       */
+      size_t base_size() const { compute_layout(); return layout.base_size; }
+      /***
+       * @returns the size in bytes including witness data
+       */
+      size_t total_size() const { compute_layout(); return layout.total_size; }
+      /***
+       * @returns the bytes of witness data, including the marker and flag
+       */
+      size_t witness_size() const { compute_layout(); return layout.total_size - layout.base_size; }
+      /***
+       * @returns the weight (3 * base size + total size)
+       */
+      size_t weight() const { return base_size() * 3 + total_size(); }
+      /***
+       * @returns the virtual size (weight / 4, rounded up)
+       */
+      size_t vsize() const { return (weight() + 3) / 4; }
+      /***
+       * @returns where an input starts in the serialized transaction
+       * @throws std::out_of_range if there is no such input
+       */
+      size_t input_offset(size_t pos) const { compute_layout(); return layout.input_offsets.at(pos); }
+      /***
+       * @returns where an output starts in the serialized transaction
+       * @throws std::out_of_range if there is no such output
+       */
+      size_t output_offset(size_t pos) const { compute_layout(); return layout.output_offsets.at(pos); }
+   private:
+      uint32_t version = 1;
+      uint16_t flag = 0; // segwit flag, if present, will always be 0001
       std::vector<input> inputs;
       std::vector<output> outputs;
-      std::vector<witness> witnesses;
-      uint32_t locktime; // block height or timestamp when tx finalizes
+      witness_stacks witnesses; // one stack per input, when flag is set
+      uint32_t locktime = 0; // block height or timestamp when tx finalizes
    private:
-      static void add( std::vector<uint8_t>& vec, const std::vector<uint8_t>& bytes );
-      static void add_input( std::vector<uint8_t>& vec, const input& in );
-      static void add_output( std::vector<uint8_t>& vec, const output& out );
-      static void add_witness( std::vector<uint8_t>& vec, const witness& wit );
-      void parse_raw_transaction(std::vector<uint8_t> raw_transaction);
+      void parse_raw_transaction(byte_span raw_transaction);
+      void modified() { cache.valid = false; layout.valid = false; }
+      void compute_cache() const;
+      void hash_serialized(const uint8_t* serialized) const;
+      void compute_layout() const;
       bool parsed = false;
+      struct digest_cache
+      {
+         bool valid = false;
+         digest256 txid;
+         digest256 wtxid;
+      };
+      mutable digest_cache cache;
+      struct size_layout
+      {
+         bool valid = false;
+         size_t base_size;
+         size_t total_size;
+         std::vector<uint32_t> input_offsets;
+         std::vector<uint32_t> output_offsets;
+      };
+      mutable size_layout layout;
 };
 
 }
\ No newline at end of file
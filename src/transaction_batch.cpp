@@ -0,0 +1,144 @@
+#include <stdexcept>
+
+#include <transaction_batch.hpp>
+#include <transaction_view.hpp>
+
+namespace bc_toolbox {
+
+void transaction_batch::reserve(size_t transactions, size_t inputs, size_t outputs, size_t items,
+      size_t arena_bytes)
+{
+   versions.reserve(transactions);
+   locktimes.reserve(transactions);
+   segwit.reserve(transactions);
+   input_ends.reserve(transactions);
+   output_ends.reserve(transactions);
+   prev_hashes.reserve(inputs * 32);
+   prev_indexes.reserve(inputs);
+   sequences.reserve(inputs);
+   input_scripts.reserve(inputs);
+   input_script_lengths.reserve(inputs);
+   witness_ends.reserve(inputs);
+   values.reserve(outputs);
+   output_scripts.reserve(outputs);
+   output_script_lengths.reserve(outputs);
+   witness_items.reserve(items);
+   witness_item_lengths.reserve(items);
+   arena.reserve(arena_bytes);
+}
+
+size_t transaction_batch::add(byte_span raw)
+{
+   // the view checks the whole transaction before anything is appended
+   transaction_view view(raw);
+   if (arena.size() + view.size() > UINT32_MAX)
+      throw std::out_of_range("transaction batch is full");
+   versions.push_back(view.version());
+   locktimes.push_back(view.locktime());
+   segwit.push_back(view.has_witness() ? 1 : 0);
+   for(auto in : view.inputs())
+   {
+      byte_span hash = in.prev_hash();
+      prev_hashes.insert(prev_hashes.end(), hash.begin(), hash.end());
+      prev_indexes.push_back(in.index());
+      sequences.push_back(in.sequence());
+      byte_span script = in.script();
+      input_scripts.push_back(arena.size());
+      input_script_lengths.push_back(script.size());
+      arena.insert(arena.end(), script.begin(), script.end());
+   }
+   input_ends.push_back(sequences.size());
+   for(auto out : view.outputs())
+   {
+      values.push_back(out.value());
+      byte_span script = out.script();
+      output_scripts.push_back(arena.size());
+      output_script_lengths.push_back(script.size());
+      arena.insert(arena.end(), script.begin(), script.end());
+   }
+   output_ends.push_back(values.size());
+   // walk the witness section once, rather than looking up each input's stack
+   const uint8_t* pos = view.bytes().data() + view.witness_begin();
+   uint8_t width = 0;
+   for(size_t i = 0; i < view.input_count(); ++i)
+   {
+      if (view.has_witness())
+      {
+         uint64_t count = read_varint_unchecked(pos, width);
+         pos += width;
+         for(uint64_t j = 0; j < count; ++j)
+         {
+            witness_item_view item(pos);
+            byte_span data = item.data();
+            witness_items.push_back(arena.size());
+            witness_item_lengths.push_back(data.size());
+            arena.insert(arena.end(), data.begin(), data.end());
+            pos += item.size();
+         }
+      }
+      witness_ends.push_back(witness_items.size());
+   }
+   return view.size();
+}
+
+size_t transaction_batch::add_all(byte_span raw)
+{
+   size_t count = 0;
+   size_t pos = 0;
+   while (pos < raw.size())
+   {
+      pos += add(raw.subspan(pos));
+      ++count;
+   }
+   return count;
+}
+
+void transaction_batch::clear()
+{
+   versions.clear();
+   locktimes.clear();
+   segwit.clear();
+   input_ends.clear();
+   output_ends.clear();
+   prev_hashes.clear();
+   prev_indexes.clear();
+   sequences.clear();
+   input_scripts.clear();
+   input_script_lengths.clear();
+   witness_ends.clear();
+   witness_items.clear();
+   witness_item_lengths.clear();
+   values.clear();
+   output_scripts.clear();
+   output_script_lengths.clear();
+   arena.clear();
+}
+
+byte_span transaction_batch::witness_item(size_t input, size_t pos) const
+{
+   size_t count = witness_item_count(input);
+   if (pos >= count)
+      throw std::out_of_range("no such witness item");
+   return script(witness_items, witness_item_lengths, witness_ends[input] - count + pos);
+}
+
+uint64_t transaction_batch::output_value(size_t tx) const
+{
+   uint64_t ret_val = 0;
+   for(size_t i = output_begin(tx), end = output_end(tx); i < end; ++i)
+      ret_val += values[i];
+   return ret_val;
+}
+
+uint64_t transaction_batch::total_value() const
+{
+   // a plain loop over one contiguous column, which the compiler vectorizes
+   const uint64_t* value = values.data();
+   const size_t count = values.size();
+   uint64_t ret_val = 0;
+   for(size_t i = 0; i < count; ++i)
+      ret_val += value[i];
+   return ret_val;
+}
+
+} // namespace bc_toolbox
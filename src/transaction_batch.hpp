@@ -0,0 +1,139 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <span.hpp>
+
+namespace bc_toolbox {
+
+/*****
+ * Many parsed transactions, stored column by column.
+ *
+ * Each field is a flat array across the whole batch: one entry per
+ * transaction for versions and locktimes, one per input for outpoints and
+ * sequences, one per output for values. All script and witness bytes live
+ * in one arena, and are found through offset and length columns. Adding a
+ * transaction appends to the columns, so a batch built with reserve()
+ * does not allocate per transaction, and a scan over one field (summing
+ * values, say) reads only that field's memory.
+ *
+ * Inputs and outputs are numbered across the batch. Transaction t owns
+ * inputs [input_begin(t), input_end(t)) and likewise for outputs.
+ */
+class transaction_batch
+{
+   public:
+      /***
+       * @brief make room, so adding does not reallocate
+       * @param transactions the number of transactions
+       * @param inputs the number of inputs, across all transactions
+       * @param outputs the number of outputs, across all transactions
+       * @param items the number of witness items, across all inputs
+       * @param arena_bytes the bytes of scripts and witness items
+       */
+      void reserve(size_t transactions, size_t inputs, size_t outputs, size_t items, size_t arena_bytes);
+      /***
+       * @brief parse a transaction onto the end of the batch
+       * @param raw the buffer. Bytes after the end of the transaction are ignored
+       * @returns the number of bytes the transaction occupied
+       * @throws std::out_of_range if the transaction is truncated
+       * @throws std::invalid_argument if the segwit flag is unknown, or a length
+       * is not minimally encoded
+       * (either way, the batch is unchanged)
+       */
+      size_t add(byte_span raw);
+      /***
+       * @brief parse transactions laid end to end, such as the body of a block
+       * @param raw the transactions
+       * @returns the number of transactions added
+       * @throws as add(). Transactions before the bad one stay in the batch
+       */
+      size_t add_all(byte_span raw);
+      void clear();
+
+      /***
+       * @returns the number of transactions
+       */
+      size_t size() const { return versions.size(); }
+      bool empty() const { return versions.empty(); }
+      size_t input_count() const { return sequences.size(); }
+      size_t output_count() const { return values.size(); }
+
+      // per transaction
+      span<const uint32_t> get_versions() const { return span<const uint32_t>(versions.data(), versions.size()); }
+      span<const uint32_t> get_locktimes() const { return span<const uint32_t>(locktimes.data(), locktimes.size()); }
+      bool has_witness(size_t tx) const { return segwit.at(tx) != 0; }
+      size_t input_begin(size_t tx) const { return tx == 0 ? 0 : input_ends.at(tx - 1); }
+      size_t input_end(size_t tx) const { return input_ends.at(tx); }
+      size_t output_begin(size_t tx) const { return tx == 0 ? 0 : output_ends.at(tx - 1); }
+      size_t output_end(size_t tx) const { return output_ends.at(tx); }
+      /***
+       * @returns the sum of a transaction's output values
+       */
+      uint64_t output_value(size_t tx) const;
+
+      // per input
+      /***
+       * @returns the 32 byte hash of the transaction an input spends
+       */
+      byte_span prev_hash(size_t input) const { return byte_span(prev_hashes.data() + input * 32, 32); }
+      span<const uint32_t> get_prev_indexes() const { return span<const uint32_t>(prev_indexes.data(), prev_indexes.size()); }
+      span<const uint32_t> get_sequences() const { return span<const uint32_t>(sequences.data(), sequences.size()); }
+      byte_span input_script(size_t input) const { return script(input_scripts, input_script_lengths, input); }
+      size_t witness_item_count(size_t input) const
+      {
+         return witness_ends.at(input) - (input == 0 ? 0 : witness_ends[input - 1]);
+      }
+      /***
+       * @param input the input
+       * @param pos the item, bottom of the stack first
+       * @throws std::out_of_range if there is no such item
+       */
+      byte_span witness_item(size_t input, size_t pos) const;
+
+      // per output
+      span<const uint64_t> get_values() const { return span<const uint64_t>(values.data(), values.size()); }
+      byte_span output_script(size_t output) const { return script(output_scripts, output_script_lengths, output); }
+      span<const uint32_t> get_output_script_lengths() const
+      {
+         return span<const uint32_t>(output_script_lengths.data(), output_script_lengths.size());
+      }
+
+      /***
+       * @returns the sum of every output value in the batch
+       */
+      uint64_t total_value() const;
+      /***
+       * @returns the arena that holds every script and witness item
+       */
+      byte_span get_arena() const { return byte_span(arena); }
+   private:
+      byte_span script(const std::vector<uint32_t>& offsets, const std::vector<uint32_t>& lengths, size_t pos) const
+      {
+         return byte_span(arena.data() + offsets.at(pos), lengths[pos]);
+      }
+      // one per transaction
+      std::vector<uint32_t> versions;
+      std::vector<uint32_t> locktimes;
+      std::vector<uint8_t> segwit;
+      std::vector<uint32_t> input_ends; // one past the transaction's last input
+      std::vector<uint32_t> output_ends;
+      // one per input
+      std::vector<uint8_t> prev_hashes; // 32 bytes each
+      std::vector<uint32_t> prev_indexes;
+      std::vector<uint32_t> sequences;
+      std::vector<uint32_t> input_scripts; // arena offsets
+      std::vector<uint32_t> input_script_lengths;
+      std::vector<uint32_t> witness_ends; // one past the input's last witness item
+      // one per witness item
+      std::vector<uint32_t> witness_items;
+      std::vector<uint32_t> witness_item_lengths;
+      // one per output
+      std::vector<uint64_t> values;
+      std::vector<uint32_t> output_scripts;
+      std::vector<uint32_t> output_script_lengths;
+      std::vector<uint8_t> arena;
+};
+
+} // namespace bc_toolbox
@@ -0,0 +1,228 @@
+#include <stdexcept>
+
+#include "transaction_view.hpp"
+#include "compact_size.hpp"
+
+namespace bc_toolbox {
+
+namespace {
+
+/*****
+ * Where the sections of a transaction are, as found by walk()
+ */
+struct sections
+{
+   bool segwit;
+   uint64_t num_inputs;
+   uint64_t num_outputs;
+   size_t inputs_offset;
+   size_t inputs_end;
+   size_t outputs_offset;
+   size_t outputs_end;
+   size_t locktime_offset;
+   size_t len;
+};
+
+/*****
+ * Bounds-checked reads. Each returns false (with error set) instead of
+ * reading past len.
+ */
+class cursor
+{
+   public:
+      cursor(const uint8_t* base, size_t len) : base(base), len(len), pos(0), error(scan_error::ok) {}
+      bool skip(uint64_t bytes)
+      {
+         if (bytes > len - pos)
+            return fail(scan_error::truncated);
+         pos += bytes;
+         return true;
+      }
+      bool read_varint(uint64_t& value)
+      {
+         size_t width = 0;
+         compact_size_error result = decode_compact_size(byte_span(base + pos, len - pos), value, width);
+         if (result != compact_size_error::ok)
+            return fail(result == compact_size_error::truncated ? scan_error::truncated : scan_error::non_canonical);
+         pos += width;
+         return true;
+      }
+      /***
+       * @brief read a count of records, each at least min_size bytes. A count
+       * the rest of the buffer cannot hold is rejected before any record is
+       * read, so a hostile count cannot make the caller loop
+       */
+      bool read_count(uint64_t& count, size_t min_size)
+      {
+         if (!read_varint(count))
+            return false;
+         if (count > (len - pos) / min_size)
+            return fail(scan_error::truncated);
+         return true;
+      }
+      /***
+       * @brief skip over a varint length followed by that many bytes
+       */
+      bool skip_sized()
+      {
+         uint64_t size = 0;
+         return read_varint(size) && skip(size);
+      }
+      bool fail(scan_error e) { error = e; return false; }
+      const uint8_t* base;
+      size_t len;
+      size_t pos;
+      scan_error error;
+};
+
+/***
+ * Walk one transaction, checking that every length stays within the buffer
+ */
+scan_error walk(const uint8_t* base, size_t max, sections& out)
+{
+   cursor c(base, max);
+   // version
+   if (!c.skip(4))
+      return c.error;
+   // segwit marker and flag
+   out.segwit = false;
+   if (max - c.pos < 2)
+      return scan_error::truncated;
+   if (base[c.pos] == 0 && base[c.pos+1] != 0)
+   {
+      if (base[c.pos+1] != 1)
+         return scan_error::unknown_flag;
+      out.segwit = true;
+      c.pos += 2;
+   }
+   // inputs (outpoint, script length, sequence: at least 41 bytes)
+   if (!c.read_count(out.num_inputs, 41))
+      return c.error;
+   out.inputs_offset = c.pos;
+   for(uint64_t i = 0; i < out.num_inputs; ++i)
+      if (!c.skip(36) || !c.skip_sized() || !c.skip(4))
+         return c.error;
+   out.inputs_end = c.pos;
+   // outputs (value, script length: at least 9 bytes)
+   if (!c.read_count(out.num_outputs, 9))
+      return c.error;
+   out.outputs_offset = c.pos;
+   for(uint64_t i = 0; i < out.num_outputs; ++i)
+      if (!c.skip(8) || !c.skip_sized())
+         return c.error;
+   out.outputs_end = c.pos;
+   // witnesses (one stack per input)
+   if (out.segwit)
+   {
+      for(uint64_t i = 0; i < out.num_inputs; ++i)
+      {
+         uint64_t items = 0;
+         if (!c.read_count(items, 1))
+            return c.error;
+         for(uint64_t j = 0; j < items; ++j)
+            if (!c.skip_sized())
+               return c.error;
+      }
+   }
+   // locktime
+   out.locktime_offset = c.pos;
+   if (!c.skip(4))
+      return c.error;
+   out.len = c.pos;
+   return scan_error::ok;
+}
+
+} // namespace
+
+const char* scan_error_string(scan_error error)
+{
+   switch(error)
+   {
+      case scan_error::ok: return "no error";
+      case scan_error::truncated: return "transaction truncated";
+      case scan_error::non_canonical: return "non-canonical varint";
+      case scan_error::unknown_flag: return "unknown transaction flag";
+   }
+   return "unknown error";
+}
+
+scan_error scan_transaction(byte_span raw, transaction_bounds& bounds)
+{
+   sections found;
+   scan_error ret_val = walk(raw.data(), raw.size(), found);
+   if (ret_val == scan_error::ok)
+   {
+      bounds.offset = 0;
+      bounds.length = found.len;
+      bounds.segwit = found.segwit;
+   }
+   return ret_val;
+}
+
+scan_error scan_transactions(byte_span raw, std::vector<transaction_bounds>& found, size_t& consumed)
+{
+   size_t pos = 0;
+   scan_error ret_val = scan_error::ok;
+   while (pos < raw.size())
+   {
+      transaction_bounds bounds;
+      ret_val = scan_transaction(raw.subspan(pos), bounds);
+      if (ret_val != scan_error::ok)
+         break;
+      bounds.offset = pos;
+      found.push_back(bounds);
+      pos += bounds.length;
+   }
+   consumed = pos;
+   return ret_val;
+}
+
+transaction_view::transaction_view(byte_span raw) : base(raw.data())
+{
+   sections found;
+   switch(walk(base, raw.size(), found))
+   {
+      case scan_error::ok:
+         break;
+      case scan_error::truncated:
+         throw std::out_of_range("transaction truncated");
+      case scan_error::non_canonical:
+         throw std::invalid_argument("non-canonical varint");
+      case scan_error::unknown_flag:
+         throw std::invalid_argument("unknown transaction flag");
+   }
+   segwit = found.segwit;
+   num_inputs = found.num_inputs;
+   num_outputs = found.num_outputs;
+   inputs_offset = found.inputs_offset;
+   inputs_end = found.inputs_end;
+   outputs_offset = found.outputs_offset;
+   outputs_end = found.outputs_end;
+   locktime_offset = found.locktime_offset;
+   len = found.len;
+}
+
+witness_view transaction_view::witness(size_t input_pos) const
+{
+   if (input_pos >= num_inputs)
+      throw std::out_of_range("input out of range");
+   if (!segwit)
+      return witness_view(base + locktime_offset, base + locktime_offset, 0);
+   const uint8_t* pos = base + outputs_end;
+   uint8_t width = 0;
+   for(size_t i = 0; i < input_pos; ++i)
+   {
+      uint64_t items = read_varint_unchecked(pos, width);
+      pos += width;
+      for(uint64_t j = 0; j < items; ++j)
+         pos += witness_item_view(pos).size();
+   }
+   uint64_t items = read_varint_unchecked(pos, width);
+   pos += width;
+   const uint8_t* first = pos;
+   for(uint64_t j = 0; j < items; ++j)
+      pos += witness_item_view(pos).size();
+   return witness_view(first, pos, items);
+}
+
+} // namespace bc_toolbox
@@ -0,0 +1,291 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+
+#include <span.hpp>
+
+namespace bc_toolbox {
+
+/*****
+ * Helpers to read little-endian integers from a byte stream
+ */
+inline uint32_t read_le32(const uint8_t* pos)
+{
+   return (uint32_t)pos[0] | (uint32_t)pos[1] << 8 | (uint32_t)pos[2] << 16 | (uint32_t)pos[3] << 24;
+}
+
+inline uint64_t read_le64(const uint8_t* pos)
+{
+   return (uint64_t)read_le32(pos) | (uint64_t)read_le32(pos + 4) << 32;
+}
+
+/****
+ * Decode a varint that is already known to be within bounds
+ * @param pos the first byte of the varint
+ * @param width set to the number of bytes the varint occupies
+ * @returns the value
+ */
+inline uint64_t read_varint_unchecked(const uint8_t* pos, uint8_t& width)
+{
+   switch(pos[0])
+   {
+      case 0xfd:
+         width = 3;
+         return (uint64_t)pos[1] | (uint64_t)pos[2] << 8;
+      case 0xfe:
+         width = 5;
+         return read_le32(pos + 1);
+      case 0xff:
+         width = 9;
+         return read_le64(pos + 1);
+      default:
+         width = 1;
+         return pos[0];
+   }
+}
+
+/*****
+ * A read-only view of one input inside a raw transaction
+ */
+class input_view
+{
+   public:
+      input_view(const uint8_t* bytes) : pos(bytes)
+      {
+         uint8_t width = 0;
+         script_len = read_varint_unchecked(pos + 36, width);
+         script_offset = 36 + width;
+      }
+      byte_span prev_hash() const { return byte_span(pos, 32); }
+      uint32_t index() const { return read_le32(pos + 32); }
+      byte_span script() const { return byte_span(pos + script_offset, script_len); }
+      uint32_t sequence() const { return read_le32(pos + script_offset + script_len); }
+      /***
+       * @returns the number of bytes this input occupies
+       */
+      size_t size() const { return script_offset + script_len + 4; }
+   private:
+      const uint8_t* pos;
+      size_t script_offset;
+      size_t script_len;
+};
+
+/*****
+ * A read-only view of one output inside a raw transaction
+ */
+class output_view
+{
+   public:
+      output_view(const uint8_t* bytes) : pos(bytes)
+      {
+         uint8_t width = 0;
+         script_len = read_varint_unchecked(pos + 8, width);
+         script_offset = 8 + width;
+      }
+      uint64_t value() const { return read_le64(pos); }
+      byte_span script() const { return byte_span(pos + script_offset, script_len); }
+      size_t size() const { return script_offset + script_len; }
+   private:
+      const uint8_t* pos;
+      size_t script_offset;
+      size_t script_len;
+};
+
+/*****
+ * A read-only view of one witness item
+ */
+class witness_item_view
+{
+   public:
+      witness_item_view(const uint8_t* bytes) : pos(bytes)
+      {
+         uint8_t width = 0;
+         len = read_varint_unchecked(pos, width);
+         offset = width;
+      }
+      byte_span data() const { return byte_span(pos + offset, len); }
+      size_t size() const { return offset + len; }
+   private:
+      const uint8_t* pos;
+      size_t offset;
+      size_t len;
+};
+
+/*****
+ * Walks a run of variable-length records, decoding each one only when
+ * it is dereferenced
+ */
+template <typename View>
+class view_iterator
+{
+   public:
+      view_iterator(const uint8_t* bytes) : pos(bytes) {}
+      View operator*() const { return View(pos); }
+      view_iterator& operator++() { pos += View(pos).size(); return *this; }
+      view_iterator operator++(int) { view_iterator tmp(*this); ++(*this); return tmp; }
+      bool operator==(const view_iterator& other) const { return pos == other.pos; }
+      bool operator!=(const view_iterator& other) const { return pos != other.pos; }
+   private:
+      const uint8_t* pos;
+};
+
+template <typename View>
+class view_range
+{
+   public:
+      view_range(const uint8_t* first, const uint8_t* last, size_t count)
+            : first(first), last(last), count(count) {}
+      view_iterator<View> begin() const { return view_iterator<View>(first); }
+      view_iterator<View> end() const { return view_iterator<View>(last); }
+      size_t size() const { return count; }
+      bool empty() const { return count == 0; }
+      /***
+       * @brief random access (walks from the start of the range)
+       * @throws std::out_of_range if pos is not within the range
+       */
+      View operator[](size_t pos) const
+      {
+         if (pos >= count)
+            throw std::out_of_range("position out of range");
+         view_iterator<View> itr = begin();
+         for(size_t i = 0; i < pos; ++i)
+            ++itr;
+         return *itr;
+      }
+   private:
+      const uint8_t* first;
+      const uint8_t* last;
+      size_t count;
+};
+
+typedef view_range<witness_item_view> witness_view;
+
+/*****
+ * Why a buffer does not hold a well-formed transaction
+ */
+enum class scan_error
+{
+   ok,
+   truncated, // a length or count runs past the end of the buffer
+   non_canonical, // a length is not minimally encoded
+   unknown_flag // a segwit marker with a flag other than 1
+};
+
+/***
+ * @returns a short description of the error
+ */
+const char* scan_error_string(scan_error error);
+
+/*****
+ * Where a transaction sits within a buffer
+ */
+struct transaction_bounds
+{
+   size_t offset;
+   size_t length;
+   bool segwit;
+};
+
+/***
+ * @brief find the end of the transaction at the front of a buffer, checking
+ * its structure but decoding nothing else. Never throws, and never reads
+ * outside raw.
+ * @param raw the buffer. Bytes after the end of the transaction are ignored
+ * @param bounds set to where the transaction is (offset 0), if it is well formed
+ * @returns scan_error::ok, or why the bytes are not a transaction
+ */
+scan_error scan_transaction(byte_span raw, transaction_bounds& bounds);
+
+/***
+ * @brief find transactions laid end to end, such as the body of a block
+ * @param raw the transactions
+ * @param found where to append the bounds of each one
+ * @param consumed set to the number of bytes of well-formed transactions
+ * @returns scan_error::ok if raw is whole transactions, or why scanning
+ * stopped at consumed
+ */
+scan_error scan_transactions(byte_span raw, std::vector<transaction_bounds>& found, size_t& consumed);
+
+/*****
+ * A read-only, zero-copy view of a serialized transaction
+ *
+ * Construction walks the transaction once (as scan_transaction does) to
+ * validate its structure and record where each section begins. Inputs,
+ * outputs and witnesses are decoded only when they are visited. The bytes
+ * are owned by the caller and must outlive the view.
+ */
+class transaction_view
+{
+   public:
+      /***
+       * @brief view the transaction at the front of a buffer
+       * @param raw the buffer. Bytes after the end of the transaction are ignored
+       * @throws std::out_of_range if the transaction is truncated
+       * @throws std::invalid_argument if the segwit flag is unknown, or a length
+       * is not minimally encoded
+       */
+      transaction_view(byte_span raw);
+      uint32_t version() const { return read_le32(base); }
+      uint32_t locktime() const { return read_le32(base + locktime_offset); }
+      bool has_witness() const { return segwit; }
+      size_t input_count() const { return num_inputs; }
+      size_t output_count() const { return num_outputs; }
+      view_range<input_view> inputs() const
+      {
+         return view_range<input_view>(base + inputs_offset, base + inputs_end, num_inputs);
+      }
+      view_range<output_view> outputs() const
+      {
+         return view_range<output_view>(base + outputs_offset, base + outputs_end, num_outputs);
+      }
+      /***
+       * @throws std::out_of_range if there is no such input
+       */
+      input_view input(size_t pos) const { return inputs()[pos]; }
+      /***
+       * @throws std::out_of_range if there is no such output
+       */
+      output_view output(size_t pos) const { return outputs()[pos]; }
+      /***
+       * @brief the witness stack of an input
+       * @param input_pos the input
+       * @returns the items of the stack (empty if the transaction has no witness data)
+       */
+      witness_view witness(size_t input_pos) const;
+      /***
+       * @returns where the witness data starts (equal to witness_end() if there is none)
+       */
+      size_t witness_begin() const { return outputs_end; }
+      /***
+       * @returns where the witness data ends, which is where the locktime starts
+       */
+      size_t witness_end() const { return locktime_offset; }
+      /***
+       * @returns the size of the transaction without the segwit marker, flag and witnesses
+       */
+      size_t base_size() const { return segwit ? len - 2 - (locktime_offset - outputs_end) : len; }
+      /***
+       * @returns the bytes of the whole transaction
+       */
+      byte_span bytes() const { return byte_span(base, len); }
+      /***
+       * @returns the number of bytes the transaction occupies
+       */
+      size_t size() const { return len; }
+   private:
+      const uint8_t* base;
+      size_t len;
+      bool segwit;
+      size_t num_inputs;
+      size_t num_outputs;
+      size_t inputs_offset;
+      size_t inputs_end;
+      size_t outputs_offset;
+      size_t outputs_end;
+      size_t locktime_offset;
+};
+
+} // namespace bc_toolbox
@@ -1,3 +1,4 @@
+#include <string>
 #include <functional>
 
 const std::function<std::string(const char*)> G_TRANSLATION_FUN = [](const char* str) { return str; };
\ No newline at end of file
@@ -0,0 +1,627 @@
+#include <stdexcept>
+#include <algorithm>
+#include <random>
+#include <future>
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <utxo_set.hpp>
+#include <compact_size.hpp>
+#include <hash.hpp>
+#include <hex_conversion.hpp>
+
+namespace bc_toolbox {
+
+namespace {
+
+/*****
+ * A standard output script, stored as its kind and payload (the hash or
+ * key). The script is prefix | payload | suffix.
+ */
+struct script_template
+{
+   size_t size;
+   uint8_t prefix[3];
+   size_t prefix_len;
+   size_t payload_len;
+   uint8_t suffix[2];
+   size_t suffix_len;
+};
+
+/*****
+ * SipHash-2-4 of a 36 byte outpoint (the txid, then the index), as Bitcoin
+ * Core hashes outpoints for its coins cache
+ */
+class siphash_outpoint
+{
+   public:
+      siphash_outpoint(uint64_t k0, uint64_t k1)
+            : v0(0x736f6d6570736575ULL ^ k0), v1(0x646f72616e646f6dULL ^ k1),
+              v2(0x6c7967656e657261ULL ^ k0), v3(0x7465646279746573ULL ^ k1) {}
+      uint64_t hash(const uint8_t* key)
+      {
+         for(size_t i = 0; i < 32; i += 8)
+            compress(read_le64(key + i));
+         // the last word holds the index and the message length
+         compress((uint64_t)36 << 56 | read_le32(key + 32));
+         v2 ^= 0xff;
+         round();
+         round();
+         round();
+         round();
+         return v0 ^ v1 ^ v2 ^ v3;
+      }
+   private:
+      static uint64_t rotl(uint64_t x, int b) { return (x << b) | (x >> (64 - b)); }
+      void round()
+      {
+         v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+         v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+         v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+         v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+      }
+      void compress(uint64_t m)
+      {
+         v3 ^= m;
+         round();
+         round();
+         v0 ^= m;
+      }
+      uint64_t v0, v1, v2, v3;
+};
+
+// the index is the kind stored in the entry. Other scripts are stored as
+// their length plus template_count, followed by the script.
+const script_template templates[] = {
+   { 25, { OP_DUP, OP_HASH160, 20 }, 3, 20, { OP_EQUALVERIFY, OP_CHECKSIG }, 2 }, // P2PKH
+   { 23, { OP_HASH160, 20 }, 2, 20, { OP_EQUAL, 0 }, 1 }, // P2SH
+   { 35, { 33, 0x02 }, 2, 32, { OP_CHECKSIG, 0 }, 1 }, // P2PK, compressed even key
+   { 35, { 33, 0x03 }, 2, 32, { OP_CHECKSIG, 0 }, 1 }, // P2PK, compressed odd key
+   { 22, { OP_0, 20 }, 2, 20, { 0, 0 }, 0 }, // P2WPKH
+   { 34, { OP_0, 32 }, 2, 32, { 0, 0 }, 0 }, // P2WSH
+   { 34, { OP_1, 32 }, 2, 32, { 0, 0 }, 0 } // P2TR
+};
+const size_t template_count = sizeof(templates) / sizeof(templates[0]);
+
+bool matches(const script_template& t, byte_span script)
+{
+   return script.size() == t.size
+         && std::memcmp(script.data(), t.prefix, t.prefix_len) == 0
+         && std::memcmp(script.data() + t.size - t.suffix_len, t.suffix, t.suffix_len) == 0;
+}
+
+void append_compact_size(std::vector<uint8_t>& out, uint64_t value)
+{
+   uint8_t encoded[9];
+   out.insert(out.end(), encoded, encoded + encode_compact_size(value, encoded));
+}
+
+/***
+ * @brief append an entry: height * 2 + coinbase, compressed amount, then the script
+ */
+void encode_entry(std::vector<uint8_t>& out, uint64_t amount, byte_span script, uint32_t height, bool coinbase)
+{
+   append_compact_size(out, (uint64_t)height * 2 + (coinbase ? 1 : 0));
+   append_compact_size(out, compress_amount(amount));
+   for(size_t kind = 0; kind < template_count; ++kind)
+   {
+      const script_template& t = templates[kind];
+      if (matches(t, script))
+      {
+         out.push_back(kind);
+         byte_span payload = script.subspan(t.prefix_len, t.payload_len);
+         out.insert(out.end(), payload.begin(), payload.end());
+         return;
+      }
+   }
+   append_compact_size(out, script.size() + template_count);
+   out.insert(out.end(), script.begin(), script.end());
+}
+
+/***
+ * @brief read the fields of an entry
+ * @returns the size of the entry, or 0 if it is malformed or runs past the end of in
+ */
+size_t read_entry(byte_span in, uint64_t& code, uint64_t& compressed_amount, uint64_t& kind)
+{
+   size_t pos = 0;
+   size_t width = 0;
+   if (decode_compact_size(in, code, width) != compact_size_error::ok || code > (uint64_t)UINT32_MAX * 2 + 1)
+      return 0;
+   pos += width;
+   if (decode_compact_size(in.subspan(pos), compressed_amount, width) != compact_size_error::ok)
+      return 0;
+   pos += width;
+   if (decode_compact_size(in.subspan(pos), kind, width) != compact_size_error::ok)
+      return 0;
+   pos += width;
+   uint64_t payload = kind < template_count ? templates[kind].payload_len : kind - template_count;
+   if (payload > in.size() - pos)
+      return 0;
+   return pos + payload;
+}
+
+void decode_entry(byte_span entry, prevout& result)
+{
+   uint64_t code = 0;
+   uint64_t compressed_amount = 0;
+   uint64_t kind = 0;
+   size_t len = read_entry(entry, code, compressed_amount, kind);
+   result.found = true;
+   result.height = code >> 1;
+   result.coinbase = (code & 1) != 0;
+   result.amount = decompress_amount(compressed_amount);
+   if (kind < template_count)
+   {
+      const script_template& t = templates[kind];
+      byte_span payload = entry.subspan(len - t.payload_len, t.payload_len);
+      result.script.assign(t.prefix, t.prefix + t.prefix_len);
+      result.script.insert(result.script.end(), payload.begin(), payload.end());
+      result.script.insert(result.script.end(), t.suffix, t.suffix + t.suffix_len);
+   }
+   else
+   {
+      size_t script_len = kind - template_count;
+      byte_span script = entry.subspan(len - script_len, script_len);
+      result.script.assign(script.begin(), script.end());
+   }
+}
+
+bool is_coinbase(const transaction& tx)
+{
+   if (tx.get_inputs().size() != 1)
+      return false;
+   const input& in = tx.get_inputs()[0];
+   if (in.index != 0xffffffff)
+      return false;
+   for(uint8_t b : in.hash)
+      if (b != 0)
+         return false;
+   return true;
+}
+
+// snapshot file: magic, version, entry count, the entries (outpoint then
+// entry), then the double SHA-256 of everything before it
+const uint32_t snapshot_magic = 0x6f787475; // "utxo"
+const uint32_t snapshot_version = 1;
+const size_t snapshot_header = 16;
+
+void write_all(int fd, const std::vector<uint8_t>& buffer, const std::string& filename)
+{
+   size_t pos = 0;
+   while (pos < buffer.size())
+   {
+      ssize_t written = write(fd, buffer.data() + pos, buffer.size() - pos);
+      if (written < 0 && errno == EINTR)
+         continue;
+      if (written <= 0)
+      {
+         std::string error = strerror(errno);
+         close(fd);
+         throw std::runtime_error("Unable to write " + filename + ": " + error);
+      }
+      pos += written;
+   }
+}
+
+} // namespace
+
+uint64_t compress_amount(uint64_t amount)
+{
+   if (amount == 0)
+      return 0;
+   int exponent = 0;
+   while (amount % 10 == 0 && exponent < 9)
+   {
+      amount /= 10;
+      ++exponent;
+   }
+   if (exponent < 9)
+   {
+      uint64_t last = amount % 10;
+      amount /= 10;
+      return 1 + (amount * 9 + last - 1) * 10 + exponent;
+   }
+   return 1 + (amount - 1) * 10 + 9;
+}
+
+uint64_t decompress_amount(uint64_t compressed)
+{
+   if (compressed == 0)
+      return 0;
+   --compressed;
+   int exponent = compressed % 10;
+   compressed /= 10;
+   uint64_t amount = 0;
+   if (exponent < 9)
+   {
+      uint64_t last = compressed % 9 + 1;
+      compressed /= 9;
+      amount = compressed * 10 + last;
+   }
+   else
+      amount = compressed + 1;
+   while (exponent > 0)
+   {
+      amount *= 10;
+      --exponent;
+   }
+   return amount;
+}
+
+outpoint::outpoint(byte_span txid, uint32_t index)
+{
+   if (txid.size() != 32)
+      throw std::invalid_argument("txid must be 32 bytes");
+   std::memcpy(bytes.data(), txid.data(), 32);
+   for(size_t i = 0; i < 4; ++i)
+      bytes[32 + i] = (uint8_t)(index >> (8 * i));
+}
+
+utxo_set::utxo_set() : mask(0), count(0), dead_bytes(0)
+{
+   // a random key, so crafted txids cannot pile up in one run of slots
+   std::random_device rd;
+   salt[0] = (uint64_t)rd() << 32 | rd();
+   salt[1] = (uint64_t)rd() << 32 | rd();
+   rehash(16);
+}
+
+uint64_t utxo_set::hash(const uint8_t* key) const
+{
+   // keyed over the whole outpoint: mixing a salt into part of the txid
+   // would leave keys that collide under every salt
+   return siphash_outpoint(salt[0], salt[1]).hash(key);
+}
+
+size_t utxo_set::locate(const uint8_t* key, uint64_t h) const
+{
+   const uint32_t tag = h >> 32;
+   for(size_t pos = h & mask; ; pos = (pos + 1) & mask)
+   {
+      const slot& s = slots[pos];
+      if (s.offset == empty_slot)
+         return pos;
+      if (s.tag == tag && std::memcmp(s.key, key, 36) == 0)
+         return pos;
+   }
+}
+
+void utxo_set::reserve(size_t entries)
+{
+   // keep the table at most 3/4 full
+   size_t needed = 16;
+   while (needed / 4 * 3 < entries)
+      needed *= 2;
+   if (needed > slots.size())
+      rehash(needed);
+}
+
+void utxo_set::rehash(size_t new_capacity)
+{
+   std::vector<slot> old;
+   old.swap(slots);
+   slot empty;
+   std::memset(&empty, 0, sizeof(empty));
+   empty.offset = empty_slot;
+   slots.assign(new_capacity, empty);
+   mask = new_capacity - 1;
+   for(const slot& s : old)
+      if (s.offset != empty_slot)
+         slots[locate(s.key, hash(s.key))] = s;
+}
+
+void utxo_set::clear()
+{
+   count = 0;
+   arena.clear();
+   dead_bytes = 0;
+   slots.clear();
+   rehash(16);
+}
+
+void utxo_set::insert(const uint8_t* key, byte_span entry)
+{
+   if ((count + 1) > slots.size() / 4 * 3)
+      rehash(slots.size() * 2);
+   uint64_t h = hash(key);
+   size_t pos = locate(key, h);
+   slot& s = slots[pos];
+   if (s.offset == empty_slot)
+   {
+      std::memcpy(s.key, key, 36);
+      s.tag = h >> 32;
+      ++count;
+   }
+   else
+   {
+      uint64_t unused;
+      dead_bytes += read_entry(byte_span(arena).subspan(s.offset), unused, unused, unused);
+   }
+   s.offset = arena.size();
+   arena.insert(arena.end(), entry.begin(), entry.end());
+}
+
+void utxo_set::add(const outpoint& point, uint64_t amount, byte_span script, uint32_t height, bool coinbase)
+{
+   std::vector<uint8_t> entry;
+   entry.reserve(script.size() + 16);
+   encode_entry(entry, amount, script, height, coinbase);
+   insert(point.bytes.data(), entry);
+}
+
+void utxo_set::erase(size_t pos)
+{
+   uint64_t unused;
+   dead_bytes += read_entry(byte_span(arena).subspan(slots[pos].offset), unused, unused, unused);
+   --count;
+   // shift later members of the run back, so no probe sequence has a gap
+   size_t hole = pos;
+   for(size_t next = (pos + 1) & mask; slots[next].offset != empty_slot; next = (next + 1) & mask)
+   {
+      size_t home = hash(slots[next].key) & mask;
+      // move it if its home is not cyclically within (hole, next]
+      bool stays = hole <= next ? (home > hole && home <= next) : (home > hole || home <= next);
+      if (!stays)
+      {
+         slots[hole] = slots[next];
+         hole = next;
+      }
+   }
+   slots[hole].offset = empty_slot;
+   if (dead_bytes > 4096 && dead_bytes > arena.size() / 2)
+      compact();
+}
+
+void utxo_set::compact()
+{
+   std::vector<uint8_t> fresh;
+   fresh.reserve(arena.size() - dead_bytes);
+   for(slot& s : slots)
+   {
+      if (s.offset == empty_slot)
+         continue;
+      uint64_t unused;
+      byte_span entry = byte_span(arena).subspan(s.offset);
+      entry = entry.first(read_entry(entry, unused, unused, unused));
+      s.offset = fresh.size();
+      fresh.insert(fresh.end(), entry.begin(), entry.end());
+   }
+   arena.swap(fresh);
+   dead_bytes = 0;
+}
+
+bool utxo_set::spend(const outpoint& point, prevout* spent)
+{
+   size_t pos = locate(point.bytes.data(), hash(point.bytes.data()));
+   if (slots[pos].offset == empty_slot)
+   {
+      if (spent != nullptr)
+         spent->found = false;
+      return false;
+   }
+   if (spent != nullptr)
+      decode(pos, *spent);
+   erase(pos);
+   return true;
+}
+
+size_t utxo_set::apply(const transaction& tx, uint32_t height)
+{
+   size_t missing = 0;
+   const bool coinbase = is_coinbase(tx);
+   if (!coinbase)
+      for(const input& in : tx.get_inputs())
+         if (!spend(outpoint(in)))
+            ++missing;
+   const std::vector<output>& outputs = tx.get_outputs();
+   const digest256& txid = tx.txid();
+   std::vector<uint8_t> entry;
+   for(size_t i = 0; i < outputs.size(); ++i)
+   {
+      const std::vector<uint8_t>& script = outputs[i].script;
+      if (!script.empty() && script[0] == OP_RETURN)
+         continue;
+      entry.clear();
+      encode_entry(entry, outputs[i].value, script, height, coinbase);
+      insert(outpoint(txid, i).bytes.data(), entry);
+   }
+   return missing;
+}
+
+void utxo_set::decode(size_t pos, prevout& result) const
+{
+   decode_entry(byte_span(arena).subspan(slots[pos].offset), result);
+}
+
+bool utxo_set::find(const outpoint& point, prevout& result) const
+{
+   size_t pos = locate(point.bytes.data(), hash(point.bytes.data()));
+   if (slots[pos].offset == empty_slot)
+   {
+      result.found = false;
+      return false;
+   }
+   decode(pos, result);
+   return true;
+}
+
+size_t utxo_set::find_range(const outpoint* points, size_t n, prevout* results) const
+{
+   // hash a group of keys and prefetch their home slots, then probe them
+   const size_t group = 16;
+   uint64_t hashes[group];
+   size_t found = 0;
+   for(size_t first = 0; first < n; first += group)
+   {
+      size_t len = std::min(group, n - first);
+      for(size_t i = 0; i < len; ++i)
+      {
+         hashes[i] = hash(points[first + i].bytes.data());
+#if defined(__GNUC__)
+         __builtin_prefetch(&slots[hashes[i] & mask]);
+#endif
+      }
+      for(size_t i = 0; i < len; ++i)
+      {
+         size_t pos = locate(points[first + i].bytes.data(), hashes[i]);
+         if (slots[pos].offset == empty_slot)
+            results[first + i].found = false;
+         else
+         {
+            decode(pos, results[first + i]);
+            ++found;
+         }
+      }
+   }
+   return found;
+}
+
+size_t utxo_set::find(span<const outpoint> points, std::vector<prevout>& results) const
+{
+   results.resize(points.size());
+   return find_range(points.data(), points.size(), results.data());
+}
+
+size_t utxo_set::find(span<const outpoint> points, std::vector<prevout>& results, thread_pool& pool) const
+{
+   results.resize(points.size());
+   // a few chunks per thread, but not so small that queueing dominates
+   size_t chunk = std::max<size_t>(points.size() / (pool.size() * 4) + 1, 1024);
+   std::vector<std::future<size_t> > pending;
+   for(size_t first = 0; first < points.size(); first += chunk)
+   {
+      size_t len = std::min(chunk, points.size() - first);
+      const outpoint* in = points.data() + first;
+      prevout* out = results.data() + first;
+      pending.push_back( pool.submit( [this, in, len, out]() { return find_range(in, len, out); } ) );
+   }
+   size_t found = 0;
+   for(auto& f : pending)
+      found += f.get();
+   return found;
+}
+
+std::vector<prevout> utxo_set::prevouts(const transaction& tx) const
+{
+   std::vector<outpoint> points;
+   points.reserve(tx.get_inputs().size());
+   for(const input& in : tx.get_inputs())
+      points.push_back(outpoint(in));
+   std::vector<prevout> ret_val;
+   find(span<const outpoint>(points.data(), points.size()), ret_val);
+   return ret_val;
+}
+
+void utxo_set::save(const std::string& filename) const
+{
+   int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   if (fd < 0)
+      throw std::runtime_error("Unable to open " + filename + ": " + strerror(errno));
+   sha256_context checksum;
+   std::vector<uint8_t> buffer;
+   buffer.reserve(1 << 20);
+   for(size_t i = 0; i < 4; ++i)
+      buffer.push_back((uint8_t)(snapshot_magic >> (8 * i)));
+   for(size_t i = 0; i < 4; ++i)
+      buffer.push_back((uint8_t)(snapshot_version >> (8 * i)));
+   for(size_t i = 0; i < 8; ++i)
+      buffer.push_back((uint8_t)((uint64_t)count >> (8 * i)));
+   // the arena already holds the entries in their stored form
+   for(const slot& s : slots)
+   {
+      if (s.offset == empty_slot)
+         continue;
+      uint64_t unused;
+      byte_span entry = byte_span(arena).subspan(s.offset);
+      entry = entry.first(read_entry(entry, unused, unused, unused));
+      buffer.insert(buffer.end(), s.key, s.key + 36);
+      buffer.insert(buffer.end(), entry.begin(), entry.end());
+      if (buffer.size() >= (1 << 20) - 64)
+      {
+         checksum.write(buffer);
+         write_all(fd, buffer, filename);
+         buffer.clear();
+      }
+   }
+   checksum.write(buffer);
+   digest256 digest;
+   checksum.finalize_double(digest.data());
+   buffer.insert(buffer.end(), digest.begin(), digest.end());
+   write_all(fd, buffer, filename);
+   if (close(fd) != 0)
+      throw std::runtime_error("Unable to write " + filename + ": " + strerror(errno));
+}
+
+void utxo_set::load(const std::string& filename)
+{
+   int fd = open(filename.c_str(), O_RDONLY);
+   if (fd < 0)
+      throw std::runtime_error("Unable to open " + filename + ": " + strerror(errno));
+   struct stat st;
+   if (fstat(fd, &st) != 0)
+   {
+      close(fd);
+      throw std::runtime_error("Unable to stat " + filename + ": " + strerror(errno));
+   }
+   std::vector<uint8_t> contents(st.st_size);
+   size_t pos = 0;
+   while (pos < contents.size())
+   {
+      ssize_t got = read(fd, contents.data() + pos, contents.size() - pos);
+      if (got < 0 && errno == EINTR)
+         continue;
+      if (got <= 0)
+      {
+         std::string error = got < 0 ? strerror(errno) : "unexpected end of file";
+         close(fd);
+         throw std::runtime_error("Unable to read " + filename + ": " + error);
+      }
+      pos += got;
+   }
+   close(fd);
+
+   const std::string corrupt = "Corrupt UTXO snapshot " + filename;
+   if (contents.size() < snapshot_header + 32
+         || read_le32(contents.data()) != snapshot_magic
+         || read_le32(contents.data() + 4) != snapshot_version)
+      throw std::runtime_error(corrupt);
+   byte_span body = byte_span(contents).first(contents.size() - 32);
+   digest256 digest;
+   sha256d(body, digest.data());
+   if (std::memcmp(digest.data(), body.end(), 32) != 0)
+      throw std::runtime_error(corrupt);
+   uint64_t entries = read_le64(contents.data() + 8);
+   // every entry is at least 36 + 3 bytes, so don't trust a larger count
+   if (entries > (body.size() - snapshot_header) / 39)
+      throw std::runtime_error(corrupt);
+
+   // build a new set, so a bad file leaves this one alone
+   utxo_set fresh;
+   fresh.salt = salt;
+   fresh.reserve(entries);
+   fresh.arena.reserve(body.size() - snapshot_header - entries * 36);
+   pos = snapshot_header;
+   for(uint64_t i = 0; i < entries; ++i)
+   {
+      if (body.size() - pos < 36)
+         throw std::runtime_error(corrupt);
+      const uint8_t* key = body.data() + pos;
+      pos += 36;
+      uint64_t unused;
+      size_t len = read_entry(body.subspan(pos), unused, unused, unused);
+      if (len == 0)
+         throw std::runtime_error(corrupt);
+      fresh.insert(key, body.subspan(pos, len));
+      pos += len;
+   }
+   if (pos != body.size())
+      throw std::runtime_error(corrupt);
+   *this = std::move(fresh);
+}
+
+} // namespace bc_toolbox
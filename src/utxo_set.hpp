@@ -0,0 +1,164 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#include <span.hpp>
+#include <transaction.hpp>
+#include <thread_pool.hpp>
+
+namespace bc_toolbox {
+
+/*****
+ * A reference to a transaction output: the txid (internal byte order)
+ * and output index, packed into 36 bytes as they appear in an input
+ */
+class outpoint
+{
+   public:
+      outpoint() { bytes.fill(0); }
+      /***
+       * @throws std::invalid_argument if txid is not 32 bytes
+       */
+      outpoint(byte_span txid, uint32_t index);
+      /***
+       * @brief the output an input spends
+       */
+      explicit outpoint(const input& in) : outpoint(in.hash, in.index) {}
+      byte_span txid() const { return byte_span(bytes.data(), 32); }
+      uint32_t index() const { return read_le32(bytes.data() + 32); }
+      bool operator==(const outpoint& other) const { return bytes == other.bytes; }
+      bool operator!=(const outpoint& other) const { return bytes != other.bytes; }
+      std::array<uint8_t, 36> bytes;
+};
+
+/*****
+ * The result of looking up an outpoint
+ */
+struct prevout
+{
+   bool found = false; // false if the output is spent or never existed
+   uint64_t amount = 0;
+   std::vector<uint8_t> script;
+   uint32_t height = 0; // of the block that created it
+   bool coinbase = false;
+};
+
+/***
+ * @brief shrink an amount for storage (most amounts are round numbers)
+ * @returns a value that decompress_amount maps back to amount
+ */
+uint64_t compress_amount(uint64_t amount);
+uint64_t decompress_amount(uint64_t compressed);
+
+/*****
+ * The set of unspent transaction outputs, built by applying transactions
+ * in block order.
+ *
+ * Outpoints live in an open-addressing (linear probing) hash table of
+ * fixed-size slots. Each slot points into one byte arena holding the
+ * entry: height and coinbase flag, compressed amount, and the script,
+ * with the standard templates (P2PKH, P2SH, P2PK, P2WPKH, P2WSH, P2TR)
+ * reduced to their hash or key. Spending an entry leaves a hole in the
+ * arena, which is compacted once holes are half of it.
+ *
+ * Lookups do not modify the set, so several threads may look up at once,
+ * as long as none is adding or spending.
+ */
+class utxo_set
+{
+   public:
+      utxo_set();
+      /***
+       * @brief make room for a number of entries, so adding does not rehash
+       */
+      void reserve(size_t entries);
+      void clear();
+      size_t size() const { return count; }
+      bool empty() const { return count == 0; }
+
+      /***
+       * @brief spend the inputs of a transaction and add its outputs.
+       * Outputs that can never be spent (OP_RETURN) are not added.
+       * @param tx the transaction
+       * @param height the height of the block that contains it
+       * @returns the number of inputs whose outputs were not in the set
+       * (not counting the input of a coinbase)
+       */
+      size_t apply(const transaction& tx, uint32_t height);
+      /***
+       * @brief add an output, replacing any entry with the same outpoint
+       */
+      void add(const outpoint& point, uint64_t amount, byte_span script, uint32_t height, bool coinbase);
+      /***
+       * @brief remove an output
+       * @param point the output
+       * @param spent if not null, set to the entry that was removed
+       * @returns false if the output was not in the set
+       */
+      bool spend(const outpoint& point, prevout* spent = nullptr);
+
+      /***
+       * @brief look up an output
+       * @returns false (with result.found false) if it is not in the set
+       */
+      bool find(const outpoint& point, prevout& result) const;
+      /***
+       * @brief look up many outputs. The probes of a group of keys are
+       * issued together, so their cache misses overlap.
+       * @param points the outputs
+       * @param results resized to one result per outpoint
+       * @returns the number found
+       */
+      size_t find(span<const outpoint> points, std::vector<prevout>& results) const;
+      /***
+       * @brief look up many outputs, split across the threads of a pool
+       * @see find(span<const outpoint>, std::vector<prevout>&)
+       */
+      size_t find(span<const outpoint> points, std::vector<prevout>& results, thread_pool& pool) const;
+      /***
+       * @brief the outputs spent by each input of a transaction (for signing,
+       * checking signatures, or computing the fee)
+       */
+      std::vector<prevout> prevouts(const transaction& tx) const;
+
+      /***
+       * @brief write every entry to a file
+       * @throws std::runtime_error if the file cannot be written
+       */
+      void save(const std::string& filename) const;
+      /***
+       * @brief replace the contents of the set with a file written by save()
+       * @throws std::runtime_error if the file cannot be read or is corrupt
+       * (the set is then unchanged)
+       */
+      void load(const std::string& filename);
+   private:
+      struct slot
+      {
+         uint8_t key[36];
+         uint32_t tag; // the high bits of the key's hash, to skip most key compares
+         uint64_t offset; // of the entry in the arena, or empty_slot
+      };
+      static const uint64_t empty_slot = UINT64_MAX;
+      uint64_t hash(const uint8_t* key) const;
+      size_t locate(const uint8_t* key, uint64_t h) const;
+      void insert(const uint8_t* key, byte_span entry);
+      void erase(size_t pos);
+      void rehash(size_t new_capacity);
+      void compact();
+      void decode(size_t pos, prevout& result) const;
+      size_t find_range(const outpoint* points, size_t n, prevout* results) const;
+
+      std::vector<slot> slots; // a power of two in size
+      size_t mask;
+      size_t count;
+      std::array<uint64_t, 2> salt; // the SipHash key
+      std::vector<uint8_t> arena;
+      size_t dead_bytes; // arena bytes of spent entries
+};
+
+} // namespace bc_toolbox
@@ -0,0 +1,336 @@
+#include <stdexcept>
+#include <algorithm>
+#include <random>
+#include <cstring>
+
+#include <watch_list.hpp>
+#include <script_asm.hpp>
+#include <hex_conversion.hpp>
+#include <base58.hpp>
+#include <bech32.hpp>
+
+namespace bc_toolbox {
+
+namespace {
+
+const uint8_t kind_pubkey_hash = 0;
+const uint8_t kind_script_hash = 1;
+const uint8_t kind_witness = 2; // plus the version
+const size_t bucket_size = 4;
+const size_t max_kicks = 500;
+
+inline uint16_t fingerprint_of(uint64_t h)
+{
+   uint16_t ret_val = h >> 48;
+   return ret_val == 0 ? 1 : ret_val;
+}
+
+} // namespace
+
+watch_list::watch_list() : mask(0), kick_state(0)
+{
+   std::random_device rd;
+   salt = (uint64_t)rd() << 32 | rd();
+   kick_state = salt | 1;
+   rebuild(16);
+}
+
+bool watch_list::make_key(byte_span script, key& out)
+{
+   byte_span payload;
+   if (script.size() == 25 && script[0] == OP_DUP && script[1] == OP_HASH160 && script[2] == 20
+         && script[23] == OP_EQUALVERIFY && script[24] == OP_CHECKSIG)
+   {
+      out.bytes[0] = kind_pubkey_hash;
+      payload = script.subspan(3, 20);
+   }
+   else if (is_p2sh(script))
+   {
+      out.bytes[0] = kind_script_hash;
+      payload = script.subspan(2, 20);
+   }
+   else if (is_witness_program(script))
+   {
+      uint8_t version = script[0] == OP_0 ? 0 : script[0] - OP_1 + 1;
+      payload = script.subspan(2);
+      out.bytes[0] = (version == 0 && payload.size() == 20) ? kind_pubkey_hash : kind_witness + version;
+   }
+   else
+      return false;
+   std::memcpy(out.bytes + 1, payload.data(), payload.size());
+   out.len = payload.size() + 1;
+   return true;
+}
+
+uint64_t watch_list::hash(const key& k) const
+{
+   // eight bytes at a time, zero padded
+   uint64_t h = salt ^ (k.len * 0x9e3779b97f4a7c15ULL);
+   for(size_t pos = 0; pos < k.len; pos += 8)
+   {
+      uint64_t chunk = 0;
+      std::memcpy(&chunk, k.bytes + pos, std::min<size_t>(8, k.len - pos));
+      h = (h ^ chunk) * 0xd6e8feb86659fd93ULL;
+      h ^= h >> 32;
+   }
+   return h;
+}
+
+size_t watch_list::other_bucket(size_t bucket, uint16_t fingerprint) const
+{
+   // partial-key cuckoo hashing: either bucket can be found from the other
+   // and the fingerprint alone
+   return (bucket ^ ((uint64_t)fingerprint * 0x5bd1e995ULL)) & mask;
+}
+
+bool watch_list::filter_insert(uint64_t h)
+{
+   uint16_t fingerprint = fingerprint_of(h);
+   size_t bucket = h & mask;
+   for(size_t attempt = 0; attempt < 2; ++attempt)
+   {
+      uint16_t* slots = &buckets[bucket * bucket_size];
+      for(size_t i = 0; i < bucket_size; ++i)
+      {
+         if (slots[i] == 0)
+         {
+            slots[i] = fingerprint;
+            return true;
+         }
+      }
+      bucket = other_bucket(bucket, fingerprint);
+   }
+   // both full: move a fingerprint to its other bucket, and so on
+   for(size_t kick = 0; kick < max_kicks; ++kick)
+   {
+      kick_state ^= kick_state << 13;
+      kick_state ^= kick_state >> 7;
+      kick_state ^= kick_state << 17;
+      std::swap(fingerprint, buckets[bucket * bucket_size + kick_state % bucket_size]);
+      bucket = other_bucket(bucket, fingerprint);
+      uint16_t* slots = &buckets[bucket * bucket_size];
+      for(size_t i = 0; i < bucket_size; ++i)
+      {
+         if (slots[i] == 0)
+         {
+            slots[i] = fingerprint;
+            return true;
+         }
+      }
+   }
+   // the caller rebuilds the filter, larger, from the exact set
+   return false;
+}
+
+bool watch_list::filter_contains(uint64_t h) const
+{
+   uint16_t fingerprint = fingerprint_of(h);
+   size_t first = h & mask;
+   const uint16_t* a = &buckets[first * bucket_size];
+   const uint16_t* b = &buckets[other_bucket(first, fingerprint) * bucket_size];
+   return a[0] == fingerprint || a[1] == fingerprint || a[2] == fingerprint || a[3] == fingerprint
+         || b[0] == fingerprint || b[1] == fingerprint || b[2] == fingerprint || b[3] == fingerprint;
+}
+
+void watch_list::filter_remove(uint64_t h)
+{
+   uint16_t fingerprint = fingerprint_of(h);
+   size_t bucket = h & mask;
+   for(size_t attempt = 0; attempt < 2; ++attempt)
+   {
+      uint16_t* slots = &buckets[bucket * bucket_size];
+      for(size_t i = 0; i < bucket_size; ++i)
+      {
+         if (slots[i] == fingerprint)
+         {
+            slots[i] = 0;
+            return;
+         }
+      }
+      bucket = other_bucket(bucket, fingerprint);
+   }
+}
+
+void watch_list::rebuild(size_t bucket_count)
+{
+   for(;;)
+   {
+      buckets.assign(bucket_count * bucket_size, 0);
+      mask = bucket_count - 1;
+      bool ok = true;
+      for(const std::string& entry : exact)
+      {
+         key k;
+         k.len = entry.size();
+         std::memcpy(k.bytes, entry.data(), k.len);
+         if (!filter_insert(hash(k)))
+         {
+            ok = false;
+            break;
+         }
+      }
+      if (ok)
+         return;
+      bucket_count *= 2;
+   }
+}
+
+void watch_list::reserve(size_t entries)
+{
+   // a filter of 4-way buckets fills reliably to about 90%
+   size_t needed = 16;
+   while (needed * bucket_size * 9 / 10 < entries)
+      needed *= 2;
+   if (needed > mask + 1)
+      rebuild(needed);
+   exact.reserve(entries);
+}
+
+void watch_list::clear()
+{
+   exact.clear();
+   rebuild(16);
+}
+
+bool watch_list::add_key(const key& k)
+{
+   if (!exact.insert(std::string((const char*)k.bytes, k.len)).second)
+      return false;
+   if ((mask + 1) * bucket_size * 9 / 10 < exact.size())
+      rebuild((mask + 1) * 2);
+   else if (!filter_insert(hash(k)))
+      rebuild((mask + 1) * 2);
+   return true;
+}
+
+bool watch_list::add_pubkey_hash(byte_span hash)
+{
+   if (hash.size() != 20)
+      throw std::invalid_argument("pubkey hash must be 20 bytes");
+   key k;
+   k.bytes[0] = kind_pubkey_hash;
+   std::memcpy(k.bytes + 1, hash.data(), 20);
+   k.len = 21;
+   return add_key(k);
+}
+
+bool watch_list::add_script_hash(byte_span hash)
+{
+   if (hash.size() != 20)
+      throw std::invalid_argument("script hash must be 20 bytes");
+   key k;
+   k.bytes[0] = kind_script_hash;
+   std::memcpy(k.bytes + 1, hash.data(), 20);
+   k.len = 21;
+   return add_key(k);
+}
+
+bool watch_list::add_witness_program(uint8_t version, byte_span program)
+{
+   if (version > 16 || program.size() < 2 || program.size() > 40)
+      throw std::invalid_argument("invalid witness program");
+   key k;
+   k.bytes[0] = (version == 0 && program.size() == 20) ? kind_pubkey_hash : kind_witness + version;
+   std::memcpy(k.bytes + 1, program.data(), program.size());
+   k.len = program.size() + 1;
+   return add_key(k);
+}
+
+bool watch_list::add_script(byte_span script_pubkey)
+{
+   key k;
+   if (!make_key(script_pubkey, k))
+      throw std::invalid_argument("script is not P2PKH, P2SH or a witness program");
+   return add_key(k);
+}
+
+bool watch_list::add_address(const std::string& address)
+{
+   decoded_address legacy = decode_address(address);
+   if (legacy.type == address_type::p2pkh)
+      return add_pubkey_hash(legacy.hash);
+   if (legacy.type == address_type::p2sh)
+      return add_script_hash(legacy.hash);
+   segwit_address segwit = decode_segwit_address(address);
+   if (!segwit.valid())
+      throw std::invalid_argument("not a Base58Check or segwit address: " + address);
+   return add_witness_program(segwit.version, segwit.get_program());
+}
+
+bool watch_list::remove_script(byte_span script_pubkey)
+{
+   key k;
+   if (!make_key(script_pubkey, k) || exact.erase(std::string((const char*)k.bytes, k.len)) == 0)
+      return false;
+   filter_remove(hash(k));
+   return true;
+}
+
+bool watch_list::contains(byte_span script_pubkey) const
+{
+   key k;
+   if (!make_key(script_pubkey, k))
+      return false;
+   return filter_contains(hash(k)) && exact.count(std::string((const char*)k.bytes, k.len)) != 0;
+}
+
+size_t watch_list::match(span<const byte_span> scripts, std::vector<size_t>& matches) const
+{
+   // hash a group of scripts and prefetch both of their buckets, then probe them
+   const size_t group = 32;
+   key keys[group];
+   uint64_t hashes[group];
+   bool usable[group];
+   size_t found = 0;
+   for(size_t first = 0; first < scripts.size(); first += group)
+   {
+      size_t len = std::min(group, scripts.size() - first);
+      for(size_t i = 0; i < len; ++i)
+      {
+         usable[i] = make_key(scripts[first + i], keys[i]);
+         if (!usable[i])
+            continue;
+         hashes[i] = hash(keys[i]);
+#if defined(__GNUC__)
+         size_t bucket = hashes[i] & mask;
+         __builtin_prefetch(&buckets[bucket * bucket_size]);
+         __builtin_prefetch(&buckets[other_bucket(bucket, fingerprint_of(hashes[i])) * bucket_size]);
+#endif
+      }
+      for(size_t i = 0; i < len; ++i)
+      {
+         if (usable[i] && filter_contains(hashes[i])
+               && exact.count(std::string((const char*)keys[i].bytes, keys[i].len)) != 0)
+         {
+            matches.push_back(first + i);
+            ++found;
+         }
+      }
+   }
+   return found;
+}
+
+size_t watch_list::match(span<const transaction> txs, std::vector<watch_match>& matches) const
+{
+   std::vector<byte_span> scripts;
+   std::vector<watch_match> where;
+   for(size_t t = 0; t < txs.size(); ++t)
+   {
+      const std::vector<output>& outputs = txs[t].get_outputs();
+      for(size_t o = 0; o < outputs.size(); ++o)
+      {
+         scripts.push_back(byte_span(outputs[o].script));
+         watch_match m;
+         m.tx = t;
+         m.output = o;
+         where.push_back(m);
+      }
+   }
+   std::vector<size_t> hits;
+   match(span<const byte_span>(scripts.data(), scripts.size()), hits);
+   for(size_t hit : hits)
+      matches.push_back(where[hit]);
+   return hits.size();
+}
+
+} // namespace bc_toolbox
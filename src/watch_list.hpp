@@ -0,0 +1,133 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <cstdint>
+
+#include <span.hpp>
+#include <transaction.hpp>
+
+namespace bc_toolbox {
+
+/*****
+ * Where a watched output was found
+ */
+struct watch_match
+{
+   size_t tx; // the transaction, within the span that was matched
+   size_t output; // the output, within the transaction
+};
+
+/*****
+ * A set of output scripts to watch for, such as the P2SH addresses of
+ * every HTLC ever generated.
+ *
+ * Entries are the part of an output script that identifies its owner:
+ * a pubkey hash (matching P2PKH and P2WPKH outputs), a script hash
+ * (P2SH), or a witness program (any other version or length). The exact
+ * entries are kept in a hash set, and a cuckoo filter of 16-bit
+ * fingerprints sits in front of it, so an output that is not watched (the
+ * usual case) costs two cache lines and no hashing of strings. About one
+ * in 8000 unwatched outputs gets past the filter and is rejected by the
+ * exact set.
+ *
+ * Matching does not modify the list, so several threads may match at
+ * once, as long as none is adding or removing.
+ */
+class watch_list
+{
+   public:
+      watch_list();
+      /***
+       * @brief make room for a number of entries, so adding does not rebuild the filter
+       */
+      void reserve(size_t entries);
+      void clear();
+      size_t size() const { return exact.size(); }
+      bool empty() const { return exact.empty(); }
+
+      /***
+       * @brief watch for outputs paying to a 20 byte public key hash (P2PKH or P2WPKH)
+       * @returns false if it was already watched
+       * @throws std::invalid_argument if hash is not 20 bytes
+       */
+      bool add_pubkey_hash(byte_span hash);
+      /***
+       * @brief watch for P2SH outputs paying to a 20 byte script hash
+       * @returns false if it was already watched
+       * @throws std::invalid_argument if hash is not 20 bytes
+       */
+      bool add_script_hash(byte_span hash);
+      /***
+       * @brief watch for a witness program (a version 0, 20 byte program
+       * is a pubkey hash, and also matches P2PKH)
+       * @returns false if it was already watched
+       * @throws std::invalid_argument if the version is above 16 or the
+       * program is not 2 to 40 bytes
+       */
+      bool add_witness_program(uint8_t version, byte_span program);
+      /***
+       * @brief watch for outputs with the same owner as an output script,
+       * such as script::p2sh_script() or script::p2wsh_script()
+       * @returns false if it was already watched
+       * @throws std::invalid_argument if the script is not P2PKH, P2SH or a witness program
+       */
+      bool add_script(byte_span script_pubkey);
+      /***
+       * @brief watch for outputs paying to an address, mainnet or testnet:
+       * Base58Check (P2PKH or P2SH, such as calc_script_address prints) or
+       * Bech32/Bech32m (a witness program)
+       * @returns false if it was already watched
+       * @throws std::invalid_argument if the address cannot be decoded
+       */
+      bool add_address(const std::string& address);
+      /***
+       * @brief stop watching the owner of an output script
+       * @returns false if it was not watched
+       */
+      bool remove_script(byte_span script_pubkey);
+
+      /***
+       * @returns true if the output script is watched
+       */
+      bool contains(byte_span script_pubkey) const;
+      /***
+       * @brief test many output scripts at once. The filter buckets of a
+       * group of scripts are prefetched together, so their cache misses overlap.
+       * @param scripts the output scripts
+       * @param matches where to append the index of each watched script
+       * @returns the number of matches appended
+       */
+      size_t match(span<const byte_span> scripts, std::vector<size_t>& matches) const;
+      /***
+       * @brief test every output of many transactions, such as a block
+       * @param txs the transactions
+       * @param matches where to append each watched output
+       * @returns the number of matches appended
+       */
+      size_t match(span<const transaction> txs, std::vector<watch_match>& matches) const;
+   private:
+      // one entry: its kind, then the hash or program
+      struct key
+      {
+         uint8_t bytes[42];
+         size_t len;
+      };
+      static bool make_key(byte_span script_pubkey, key& out);
+      bool add_key(const key& k);
+      uint64_t hash(const key& k) const;
+      size_t other_bucket(size_t bucket, uint16_t fingerprint) const;
+      bool filter_insert(uint64_t h);
+      bool filter_contains(uint64_t h) const;
+      void filter_remove(uint64_t h);
+      void rebuild(size_t bucket_count);
+
+      std::unordered_set<std::string> exact;
+      std::vector<uint16_t> buckets; // 4 fingerprints per bucket, 0 is empty
+      size_t mask; // bucket count - 1 (a power of two)
+      uint64_t salt;
+      uint64_t kick_state; // chooses which fingerprint to move when both buckets are full
+};
+
+} // namespace bc_toolbox
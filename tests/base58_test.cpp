@@ -0,0 +1,99 @@
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+
+#include <hex.hpp>
+#include <base58.hpp>
+
+BOOST_AUTO_TEST_SUITE( base58_test )
+
+BOOST_AUTO_TEST_CASE( encode_decode )
+{
+   std::vector<std::pair<std::string, std::string> > vectors = {
+      { "", "" },
+      { "61", "2g" },
+      { "626262", "a3gV" },
+      { "636363", "aPEr" },
+      { "73696d706c792061206c6f6e6720737472696e67", "2cFupjhnEsSn59qHXstmK2ffpLv2" },
+      { "00eb15231dfceb60925886b67d065299925915aeb172c06647", "1NS17iag9jJgTHD1VXjvLCEnZuQ3rJDE9L" },
+      { "516b6fcd0f", "ABnLTmg" },
+      { "bf4f89001e670274dd", "3SEo3LWLoPntC" },
+      { "572e4794", "3EFU7m" },
+      { "ecac89cad93923c02321", "EJDM8drfXA6uyA" },
+      { "10c8511e", "Rt5zm" },
+      { "00000000000000000000", "1111111111" }
+   };
+   for(auto& v : vectors)
+   {
+      std::vector<uint8_t> bytes = bc_toolbox::from_hex(v.first);
+      BOOST_CHECK_EQUAL( bc_toolbox::base58_encode(bytes), v.second );
+      BOOST_CHECK_EQUAL( bc_toolbox::to_hex(bc_toolbox::base58_decode(v.second)), v.first );
+   }
+   BOOST_CHECK_THROW( bc_toolbox::base58_decode(std::string("3SEo3LWL0PntC")), std::invalid_argument );
+   BOOST_CHECK_THROW( bc_toolbox::base58_decode(std::string("3SEo3LWLoPnt ")), std::invalid_argument );
+}
+
+BOOST_AUTO_TEST_CASE( check )
+{
+   // the genesis block coinbase address
+   std::vector<uint8_t> payload = bc_toolbox::from_hex(std::string("0062e907b15cbf27d5425399ebf6f0fb50ebb88f18"));
+   BOOST_CHECK_EQUAL( bc_toolbox::base58check_encode(payload), "1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa" );
+   BOOST_CHECK( bc_toolbox::base58check_decode(std::string("1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa")) == payload );
+   BOOST_CHECK_THROW( bc_toolbox::base58check_decode(std::string("1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNb")),
+         std::invalid_argument );
+   BOOST_CHECK_THROW( bc_toolbox::base58check_decode(std::string("1A")), std::invalid_argument );
+}
+
+BOOST_AUTO_TEST_CASE( addresses )
+{
+   std::vector<uint8_t> hash = bc_toolbox::from_hex(std::string("62e907b15cbf27d5425399ebf6f0fb50ebb88f18"));
+   std::vector<std::string> addresses;
+   addresses.push_back("1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNa");
+   std::vector<uint8_t> payload(1, 0x05);
+   payload.insert(payload.end(), hash.begin(), hash.end());
+   addresses.push_back(bc_toolbox::base58check_encode(payload));
+   payload[0] = 0x6f;
+   addresses.push_back(bc_toolbox::base58check_encode(payload));
+   payload[0] = 0xc4;
+   addresses.push_back(bc_toolbox::base58check_encode(payload));
+   addresses.push_back("1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfNb"); // bad checksum
+   addresses.push_back("1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfN"); // too short
+   addresses.push_back("1A1zP1eP5QGefi2DMPTfTL5SLmv7DivfN0"); // not Base58
+   payload[0] = 0x30; // unknown version
+   addresses.push_back(bc_toolbox::base58check_encode(payload));
+   // enough to fill the hashing lanes
+   for(int i = 0; i < 20; ++i)
+      addresses.push_back(addresses[i % 8]);
+
+   std::vector<bc_toolbox::decoded_address> results(addresses.size());
+   bc_toolbox::decode_addresses(addresses, results);
+   for(size_t i = 0; i < addresses.size(); ++i)
+   {
+      bc_toolbox::decoded_address single = bc_toolbox::decode_address(addresses[i]);
+      BOOST_CHECK( single.type == results[i].type );
+      BOOST_CHECK( single.testnet == results[i].testnet );
+      BOOST_CHECK( single.hash == results[i].hash );
+   }
+   BOOST_CHECK( results[0].type == bc_toolbox::address_type::p2pkh );
+   BOOST_CHECK( !results[0].testnet );
+   BOOST_CHECK( std::equal(hash.begin(), hash.end(), results[0].hash.begin()) );
+   BOOST_CHECK_EQUAL( bc_toolbox::to_hex(results[0].script_pubkey()),
+         "76a91462e907b15cbf27d5425399ebf6f0fb50ebb88f1888ac" );
+   BOOST_CHECK( results[1].type == bc_toolbox::address_type::p2sh );
+   BOOST_CHECK( !results[1].testnet );
+   BOOST_CHECK_EQUAL( bc_toolbox::to_hex(results[1].script_pubkey()),
+         "a91462e907b15cbf27d5425399ebf6f0fb50ebb88f1887" );
+   BOOST_CHECK( results[2].type == bc_toolbox::address_type::p2pkh );
+   BOOST_CHECK( results[2].testnet );
+   BOOST_CHECK( results[3].type == bc_toolbox::address_type::p2sh );
+   BOOST_CHECK( results[3].testnet );
+   for(size_t i = 4; i < 8; ++i)
+   {
+      BOOST_CHECK( results[i].type == bc_toolbox::address_type::invalid );
+      BOOST_CHECK( results[i].script_pubkey().empty() );
+   }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,110 @@
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+
+#include <hex.hpp>
+#include <hash.hpp>
+#include <bech32.hpp>
+#include <script.hpp>
+
+BOOST_AUTO_TEST_SUITE( bech32_test )
+
+/***
+ * Valid addresses from BIP173 and BIP350, with their output scripts
+ */
+std::vector<std::pair<std::string, std::string> > valid_addresses()
+{
+   return {
+      { "BC1QW508D6QEJXTDG4Y5R3ZARVARY0C5XW7KV8F3T4", "0014751e76e8199196d454941c45d1b3a323f1433bd6" },
+      { "tb1qrp33g0q5c5txsp9arysrx4k6zdkfs4nce4xj0gdcccefvpysxf3q0sl5k7",
+            "00201863143c14c5166804bd19203356da136c985678cd4d27a1b8c6329604903262" },
+      { "bc1pw508d6qejxtdg4y5r3zarvary0c5xw7kw508d6qejxtdg4y5r3zarvary0c5xw7kt5nd6y",
+            "5128751e76e8199196d454941c45d1b3a323f1433bd6751e76e8199196d454941c45d1b3a323f1433bd6" },
+      { "BC1SW50QGDZ25J", "6002751e" },
+      { "bc1zw508d6qejxtdg4y5r3zarvaryvaxxpcs", "5210751e76e8199196d454941c45d1b3a323" },
+      { "tb1pqqqqp399et2xygdj5xreqhjjvcmzhxw4aywxecjdzew6hylgvsesf3hn0c",
+            "5120000000c4a5cad46221b2a187905e5266362b99d5e91c6ce24d165dab93e86433" },
+      { "bc1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vqzk5jj0",
+            "512079be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798" }
+   };
+}
+
+BOOST_AUTO_TEST_CASE( valid )
+{
+   for(auto& v : valid_addresses())
+   {
+      bc_toolbox::segwit_address address = bc_toolbox::decode_segwit_address(v.first);
+      BOOST_REQUIRE( address.valid() );
+      BOOST_CHECK_EQUAL( bc_toolbox::to_hex(address.script_pubkey()), v.second );
+      // encoding gives back the lower case form
+      std::string lower = v.first;
+      std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+      BOOST_CHECK_EQUAL( bc_toolbox::encode_segwit_address(address.hrp, address.version, address.get_program()),
+            lower );
+   }
+}
+
+BOOST_AUTO_TEST_CASE( invalid )
+{
+   std::vector<std::string> addresses = {
+      "bc1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vqh2y7hd", // v1 with a Bech32 checksum
+      "tb1q0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vq24jc47", // v0 with a Bech32m checksum
+      "BC1QR508D6QEJXTDG4Y5R3ZARVARYV98GJ9P", // v0 program of 16 bytes
+      "bc1zw508d6qejxtdg4y5r3zarvaryvqyzf3du", // v2 with a Bech32 checksum
+      "BC1QW508D6QEJXTDG4Y5R3ZARVARY0C5XW7KV8F3T5", // bad checksum
+      "tb1qrp33g0q5c5txsp9arysrx4k6zdkfs4nce4xj0gdcccefvpysxf3q0sL5k7", // mixed case
+      "bc1gmk9yu", // no data
+      "BC130XLXVLHEMJA6C4DQV22UAPCTQUPFHLXM9H8Z3K2E72Q4K9HCZ7VQ7ZWS8R", // version 17
+      "bc1rw5uspcuh", // program of 1 byte
+      "bc10w508d6qejxtdg4y5r3zarvary0c5xw7kw508d6qejxtdg4y5r3zarvary0c5xw7kw5rljs90", // program too long
+      "tb1z0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vqglt7rf" // non-zero padding
+   };
+   std::vector<bc_toolbox::segwit_address> results(addresses.size());
+   bc_toolbox::decode_segwit_addresses(addresses, results);
+   for(size_t i = 0; i < addresses.size(); ++i)
+   {
+      BOOST_CHECK_MESSAGE( !results[i].valid(), addresses[i] );
+      BOOST_CHECK( results[i].script_pubkey().empty() );
+   }
+   std::string hrp;
+   std::vector<uint8_t> values;
+   BOOST_CHECK_THROW( bc_toolbox::bech32_decode(addresses[4], hrp, values), std::invalid_argument );
+   BOOST_CHECK_THROW( bc_toolbox::encode_segwit_address("bc", 0, std::vector<uint8_t>(16)), std::invalid_argument );
+   BOOST_CHECK_THROW( bc_toolbox::encode_segwit_address("bc", 17, std::vector<uint8_t>(32)), std::invalid_argument );
+}
+
+BOOST_AUTO_TEST_CASE( p2wsh )
+{
+   // BIP173: a 1-of-1 pay to pubkey script
+   bc_toolbox::script s;
+   s.add_bytes_with_size(bc_toolbox::from_hex(
+         std::string("0279be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798")));
+   s.add_opcode(bc_toolbox::OP_CHECKSIG);
+   BOOST_CHECK_EQUAL( s.p2wsh_address("tb"), "tb1qrp33g0q5c5txsp9arysrx4k6zdkfs4nce4xj0gdcccefvpysxf3q0sl5k7" );
+   BOOST_CHECK_EQUAL( bc_toolbox::to_hex(s.p2wsh_script()),
+         "00201863143c14c5166804bd19203356da136c985678cd4d27a1b8c6329604903262" );
+
+   // many at once
+   std::vector<std::vector<uint8_t> > scripts;
+   for(int i = 0; i < 11; ++i)
+      scripts.push_back(std::vector<uint8_t>(i * 10 + 1, (uint8_t)i));
+   scripts[5] = s.get_bytes_as_vector();
+   std::vector<bc_toolbox::byte_span> spans(scripts.begin(), scripts.end());
+   std::vector<std::string> addresses(scripts.size());
+   bc_toolbox::p2wsh_addresses("bc", spans, addresses);
+   for(size_t i = 0; i < scripts.size(); ++i)
+   {
+      bc_toolbox::segwit_address decoded = bc_toolbox::decode_segwit_address(addresses[i]);
+      BOOST_REQUIRE( decoded.valid() );
+      BOOST_CHECK_EQUAL( decoded.hrp, "bc" );
+      BOOST_CHECK_EQUAL( decoded.version, 0 );
+      bc_toolbox::digest256 expected;
+      bc_toolbox::sha256(spans[i], expected.data());
+      BOOST_CHECK( std::equal(expected.begin(), expected.end(), decoded.get_program().begin()) );
+   }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,105 @@
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <stdexcept>
+
+#include <hex_conversion.hpp>
+#include <block_file.hpp>
+
+BOOST_AUTO_TEST_SUITE( block_file_test )
+
+// the genesis block
+const std::string genesis_hex = 
+      "0100000000000000000000000000000000000000000000000000000000000000000000003ba3edfd7a7b12b27ac72c3e67768f617fc81bc3888a51323a9fb8aa4b1e5e4a29ab5f49ffff001d1dac2b7c"
+      "01"
+      "01000000010000000000000000000000000000000000000000000000000000000000000000ffffffff4d04ffff001d0104455468652054696d65732030332f4a616e2f32303039204368616e63656c6c6f72206f6e206272696e6b206f66207365636f6e64206261696c6f757420666f722062616e6b73ffffffff0100f2052a01000000434104678afdb0fe5548271967f1a67130b7105cd6a828e03909a67962e0ea1f61deb649f6bc3f4cef38c4f35504e51ec112de5c384df7ba0b8d578a4c702b6bf11d5fac00000000";
+
+/***
+ * Write a block file holding the genesis block "count" times, followed by padding
+ */
+std::string write_block_file(size_t count)
+{
+   std::string filename = "block_file_test.dat";
+   std::vector<uint8_t> block = bc_toolbox::hex_string_to_vector(genesis_hex);
+   std::ofstream out(filename, std::ios::binary);
+   for(size_t i = 0; i < count; ++i)
+   {
+      std::vector<uint8_t> header = bc_toolbox::little_endian(bc_toolbox::MAINNET_MAGIC, 4);
+      std::vector<uint8_t> size = bc_toolbox::little_endian(block.size(), 4);
+      out.write((const char*)header.data(), header.size());
+      out.write((const char*)size.data(), size.size());
+      out.write((const char*)block.data(), block.size());
+   }
+   std::vector<char> padding(64, 0);
+   out.write(padding.data(), padding.size());
+   return filename;
+}
+
+BOOST_AUTO_TEST_CASE( walk_records )
+{
+   std::string filename = write_block_file(3);
+   {
+      bc_toolbox::block_file file(filename);
+      std::vector<bc_toolbox::block_record> records = file.records();
+      BOOST_CHECK_EQUAL( records.size(), 3 );
+      BOOST_CHECK_EQUAL( records[0].offset, 8 );
+      BOOST_CHECK_EQUAL( records[1].offset, 8 + 285 + 8 );
+      bc_toolbox::block_header header = records[2].header();
+      BOOST_CHECK_EQUAL( header.version, 1 );
+      BOOST_CHECK_EQUAL( header.timestamp, 1231006505 );
+      BOOST_CHECK_EQUAL( header.bits, 0x1d00ffff );
+      BOOST_CHECK_EQUAL( header.nonce, 2083236893 );
+      BOOST_CHECK_EQUAL( header.merkle_root[0], 0x3b );
+      std::vector<bc_toolbox::byte_span> txs = records[0].transaction_bytes();
+      BOOST_CHECK_EQUAL( txs.size(), 1 );
+      BOOST_CHECK_EQUAL( txs[0].size(), 204 );
+   }
+   std::remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( parallel_parse )
+{
+   std::string filename = write_block_file(20);
+   {
+      bc_toolbox::block_file file(filename);
+      bc_toolbox::thread_pool pool(4);
+      std::vector<bc_toolbox::block> blocks = file.parse_blocks(pool);
+      BOOST_CHECK_EQUAL( blocks.size(), 20 );
+      for(size_t i = 1; i < blocks.size(); ++i)
+         BOOST_CHECK( blocks[i-1].offset < blocks[i].offset );
+      bc_toolbox::transaction& coinbase = blocks[19].transactions.at(0);
+      BOOST_CHECK_EQUAL( coinbase.get_version(), 1 );
+      BOOST_CHECK_EQUAL( coinbase.get_inputs().size(), 1 );
+      BOOST_CHECK_EQUAL( coinbase.get_inputs()[0].index, 0xffffffff );
+      BOOST_CHECK_EQUAL( coinbase.get_outputs().size(), 1 );
+      BOOST_CHECK_EQUAL( coinbase.get_outputs()[0].value, 5000000000 );
+      BOOST_CHECK_EQUAL( coinbase.get_locktime(), 0 );
+   }
+   std::remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( bad_magic )
+{
+   std::string filename = write_block_file(1);
+   {
+      bc_toolbox::block_file file(filename, bc_toolbox::TESTNET_MAGIC);
+      BOOST_CHECK_THROW( file.records(), std::invalid_argument );
+   }
+   std::remove(filename.c_str());
+   BOOST_CHECK_THROW( bc_toolbox::block_file file("no_such_file.dat"), std::runtime_error );
+}
+
+BOOST_AUTO_TEST_CASE( short_record )
+{
+   // a size field under 80 leaves no room for a header
+   std::vector<uint8_t> block = bc_toolbox::hex_string_to_vector(genesis_hex);
+   bc_toolbox::block_record record(0, bc_toolbox::byte_span(block.data(), 79));
+   BOOST_CHECK_THROW( record.header(), std::out_of_range );
+   BOOST_CHECK_THROW( record.transaction_bytes(), std::out_of_range );
+   BOOST_CHECK_EQUAL( bc_toolbox::block_record(0, block).header().nonce, 0x7c2bac1dU );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,108 @@
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+#include <compact_size.hpp>
+#include <hex_conversion.hpp>
+
+using namespace bc_toolbox;
+
+BOOST_AUTO_TEST_SUITE( compact_size_test )
+
+BOOST_AUTO_TEST_CASE( round_trip )
+{
+   const uint64_t values[] = { 0, 1, 0xfc, 0xfd, 0xfe, 0xff, 0xffff, 0x10000, 0xffffffff, 0x100000000ULL,
+         0xffffffffffffffffULL };
+   const size_t lengths[] = { 1, 1, 1, 3, 3, 3, 3, 5, 5, 9, 9 };
+   for(size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+   {
+      uint8_t buf[9];
+      BOOST_CHECK_EQUAL( compact_size_length(values[i]), lengths[i] );
+      BOOST_CHECK_EQUAL( encode_compact_size(values[i], buf), lengths[i] );
+      uint64_t value = 0;
+      size_t width = 0;
+      BOOST_CHECK( decode_compact_size(byte_span(buf, 9), value, width) == compact_size_error::ok );
+      BOOST_CHECK_EQUAL( value, values[i] );
+      BOOST_CHECK_EQUAL( width, lengths[i] );
+      // the vector functions agree
+      std::vector<uint8_t> vec = to_varint(values[i]);
+      BOOST_CHECK( vec == std::vector<uint8_t>(buf, buf + lengths[i]) );
+      BOOST_CHECK_EQUAL( from_varint(vec), values[i] );
+   }
+   std::vector<uint8_t> encoded = { 0xfd, 0x26, 0x02 };
+   BOOST_CHECK_EQUAL( from_varint(encoded), 550U );
+   encoded.push_back(0);
+   BOOST_CHECK_THROW( from_varint(encoded), std::out_of_range );
+}
+
+BOOST_AUTO_TEST_CASE( encode_span )
+{
+   uint8_t buf[9];
+   BOOST_CHECK_EQUAL( encode_compact_size(0x10000, mutable_byte_span(buf, 4)), 0U );
+   BOOST_CHECK_EQUAL( encode_compact_size(0x10000, mutable_byte_span(buf, 5)), 5U );
+   BOOST_CHECK_EQUAL( buf[0], 0xfe );
+   BOOST_CHECK_EQUAL( encode_compact_size(5, mutable_byte_span(buf, (size_t)0)), 0U );
+}
+
+BOOST_AUTO_TEST_CASE( bad_encodings )
+{
+   uint64_t value = 0;
+   size_t width = 0;
+   std::vector<uint8_t> empty;
+   BOOST_CHECK( decode_compact_size(empty, value, width) == compact_size_error::truncated );
+   std::vector<uint8_t> truncated = { 0xfe, 0x01, 0x02, 0x03 };
+   BOOST_CHECK( decode_compact_size(truncated, value, width) == compact_size_error::truncated );
+   // each is a value that fits a shorter encoding
+   std::vector<uint8_t> fd = { 0xfd, 0xfc, 0x00 };
+   std::vector<uint8_t> fe = { 0xfe, 0xff, 0xff, 0x00, 0x00 };
+   std::vector<uint8_t> ff = { 0xff, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+   BOOST_CHECK( decode_compact_size(fd, value, width) == compact_size_error::non_canonical );
+   BOOST_CHECK( decode_compact_size(fe, value, width) == compact_size_error::non_canonical );
+   BOOST_CHECK( decode_compact_size(ff, value, width) == compact_size_error::non_canonical );
+   BOOST_CHECK_THROW( from_varint(fd), std::out_of_range );
+   uint16_t bytes_read = 0;
+   BOOST_CHECK_THROW( from_varint(ff.data(), bytes_read), std::out_of_range );
+}
+
+BOOST_AUTO_TEST_CASE( bulk_decode )
+{
+   // a run of one byte values long enough for the eight-at-a-time path,
+   // broken up by longer encodings and bytes just under the 0xfd prefix
+   std::vector<uint64_t> values;
+   for(uint64_t i = 0; i < 20; ++i)
+      values.push_back(i * 13 % 0xfd);
+   values.push_back(0xfc);
+   values.push_back(0xfd);
+   for(uint64_t i = 0; i < 9; ++i)
+      values.push_back(0xf0 + i);
+   values.push_back(0x12345678);
+   values.push_back(0x123456789aULL);
+   values.push_back(7);
+   std::vector<uint8_t> encoded;
+   for(uint64_t v : values)
+   {
+      uint8_t buf[9];
+      encoded.insert(encoded.end(), buf, buf + encode_compact_size(v, buf));
+   }
+   std::vector<uint64_t> decoded(values.size());
+   size_t consumed = 0;
+   BOOST_CHECK( decode_compact_sizes(encoded, span<uint64_t>(decoded.data(), decoded.size()), consumed)
+         == compact_size_error::ok );
+   BOOST_CHECK_EQUAL( consumed, encoded.size() );
+   BOOST_CHECK( decoded == values );
+
+   // fewer than are there: stops after the last one asked for
+   consumed = 0;
+   BOOST_CHECK( decode_compact_sizes(encoded, span<uint64_t>(decoded.data(), 3), consumed) == compact_size_error::ok );
+   BOOST_CHECK_EQUAL( consumed, 3U );
+
+   // more than are there: reports where it stopped
+   decoded.push_back(0);
+   BOOST_CHECK( decode_compact_sizes(encoded, span<uint64_t>(decoded.data(), decoded.size()), consumed)
+         == compact_size_error::truncated );
+   BOOST_CHECK_EQUAL( consumed, encoded.size() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
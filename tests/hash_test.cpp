@@ -0,0 +1,111 @@
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <stdexcept>
+
+#include <hex_conversion.hpp>
+#include <hash.hpp>
+
+BOOST_AUTO_TEST_SUITE( hash_test )
+
+/***
+ * Messages of many different lengths, to cover the padding edge cases
+ */
+std::vector<std::vector<uint8_t> > make_messages(size_t count)
+{
+   std::vector<std::vector<uint8_t> > ret_val;
+   for(size_t i = 0; i < count; ++i)
+   {
+      std::vector<uint8_t> msg((i * 37) % 200);
+      for(size_t j = 0; j < msg.size(); ++j)
+         msg[j] = (uint8_t)(i * 7 + j);
+      ret_val.push_back(msg);
+   }
+   return ret_val;
+}
+
+BOOST_AUTO_TEST_CASE( single )
+{
+   BOOST_TEST_MESSAGE( "SHA-256 implementation: " + bc_toolbox::sha256_implementation() );
+   std::string abc = "abc";
+   bc_toolbox::digest256 digest;
+   bc_toolbox::sha256(bc_toolbox::byte_span((const uint8_t*)abc.data(), abc.size()), digest.data());
+   BOOST_CHECK_EQUAL( bc_toolbox::vector_to_hex_string(std::vector<uint8_t>(digest.begin(), digest.end())),
+         "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" );
+   bc_toolbox::sha256d(bc_toolbox::byte_span((const uint8_t*)abc.data(), abc.size()), digest.data());
+   BOOST_CHECK_EQUAL( bc_toolbox::vector_to_hex_string(std::vector<uint8_t>(digest.begin(), digest.end())),
+         "4f8b42c22dd3729b519ba6f68d2da7cc5b2d606d05daed5ad5128cc03e6c6358" );
+}
+
+BOOST_AUTO_TEST_CASE( kernel_selected )
+{
+   // on x86 the multi-lane kernels are always built, so a CPU that can
+   // run them must get one (this fails if the build leaves them out)
+#if defined(__x86_64__) || defined(__i386__)
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("avx2"))
+      BOOST_CHECK_EQUAL( bc_toolbox::sha256_implementation(), "avx2(8-way)" );
+   else if (__builtin_cpu_supports("sse4.1"))
+      BOOST_CHECK_EQUAL( bc_toolbox::sha256_implementation(), "sse4.1(4-way)" );
+#else
+   BOOST_CHECK_EQUAL( bc_toolbox::sha256_implementation(), "scalar" );
+#endif
+}
+
+BOOST_AUTO_TEST_CASE( batch_matches_single )
+{
+   for(size_t count : { 1, 3, 4, 8, 13, 37 })
+   {
+      std::vector<std::vector<uint8_t> > messages = make_messages(count);
+      std::vector<bc_toolbox::byte_span> spans(messages.begin(), messages.end());
+      std::vector<bc_toolbox::digest256> digests(count);
+      std::vector<bc_toolbox::digest256> double_digests(count);
+      bc_toolbox::sha256_batch(spans, digests);
+      bc_toolbox::sha256d_batch(spans, double_digests);
+      for(size_t i = 0; i < count; ++i)
+      {
+         BOOST_CHECK( bc_toolbox::sha256(messages[i]) == std::vector<uint8_t>(digests[i].begin(), digests[i].end()) );
+         bc_toolbox::digest256 expected;
+         bc_toolbox::sha256d(messages[i], expected.data());
+         BOOST_CHECK( expected == double_digests[i] );
+      }
+   }
+}
+
+BOOST_AUTO_TEST_CASE( batch_too_small )
+{
+   std::vector<std::vector<uint8_t> > messages = make_messages(4);
+   std::vector<bc_toolbox::byte_span> spans(messages.begin(), messages.end());
+   std::vector<bc_toolbox::digest256> digests(3);
+   BOOST_CHECK_THROW( bc_toolbox::sha256_batch(spans, digests), std::invalid_argument );
+}
+
+BOOST_AUTO_TEST_CASE( hash160_single )
+{
+   std::string text = "Bitcoin_rules!";
+   std::vector<uint8_t> message(text.begin(), text.end());
+   bc_toolbox::digest160 digest = bc_toolbox::hash160(message);
+   std::vector<uint8_t> expected = {
+      0x81, 0x03, 0xb0, 0xdf, 0x9a, 0xd7, 0x5e, 0x2b, 0x77, 0x4f,
+      0x43, 0xd6, 0xe7, 0xe7, 0x1e, 0xea, 0xa2, 0xc7, 0x3e, 0xfb
+   };
+   BOOST_CHECK( std::vector<uint8_t>(digest.begin(), digest.end()) == expected );
+}
+
+BOOST_AUTO_TEST_CASE( hash160_batch_matches_single )
+{
+   for(size_t count : { 1, 5, 8, 64, 71, 150 })
+   {
+      std::vector<std::vector<uint8_t> > messages = make_messages(count);
+      std::vector<bc_toolbox::byte_span> spans(messages.begin(), messages.end());
+      std::vector<bc_toolbox::digest160> digests(count);
+      bc_toolbox::hash160_batch(spans, digests);
+      for(size_t i = 0; i < count; ++i)
+      {
+         std::vector<uint8_t> expected = bc_toolbox::ripemd160(bc_toolbox::sha256(messages[i]));
+         BOOST_CHECK( expected == std::vector<uint8_t>(digests[i].begin(), digests[i].end()) );
+      }
+   }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
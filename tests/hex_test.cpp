@@ -0,0 +1,99 @@
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+
+#include <hex.hpp>
+
+BOOST_AUTO_TEST_SUITE( hex_test )
+
+/***
+ * One character at a time, for comparison
+ */
+std::string simple_hex(const std::vector<uint8_t>& in)
+{
+   const char digits[] = "0123456789abcdef";
+   std::string ret_val;
+   for(uint8_t b : in)
+   {
+      ret_val += digits[b >> 4];
+      ret_val += digits[b & 0x0f];
+   }
+   return ret_val;
+}
+
+BOOST_AUTO_TEST_CASE( kernel_selected )
+{
+   // on x86 the SIMD kernels are always built, so a CPU that can run them
+   // must get one (this fails if the build leaves them out)
+#if defined(__x86_64__) || defined(__i386__)
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("avx2"))
+      BOOST_CHECK_EQUAL( bc_toolbox::hex_implementation(), "avx2" );
+   else if (__builtin_cpu_supports("ssse3"))
+      BOOST_CHECK_EQUAL( bc_toolbox::hex_implementation(), "ssse3" );
+#else
+   BOOST_CHECK_EQUAL( bc_toolbox::hex_implementation(), "table" );
+#endif
+}
+
+BOOST_AUTO_TEST_CASE( round_trip )
+{
+   BOOST_TEST_MESSAGE( "Hex implementation: " + bc_toolbox::hex_implementation() );
+   // lengths around the 16 and 32 byte blocks of the SIMD kernels
+   for(size_t len = 0; len < 100; ++len)
+   {
+      std::vector<uint8_t> bytes(len);
+      for(size_t i = 0; i < len; ++i)
+         bytes[i] = (uint8_t)(i * 73 + len);
+      std::vector<uint8_t> reversed(bytes.rbegin(), bytes.rend());
+      std::string hex = bc_toolbox::to_hex(bytes);
+      BOOST_CHECK_EQUAL( hex, simple_hex(bytes) );
+      BOOST_CHECK_EQUAL( bc_toolbox::to_hex_reversed(bytes), simple_hex(reversed) );
+      BOOST_CHECK( bc_toolbox::from_hex(hex) == bytes );
+      BOOST_CHECK( bc_toolbox::from_hex_reversed(hex) == reversed );
+   }
+   // upper case is accepted
+   std::string upper = "00FFaBcDeF0123456789ABCDEFabcdef0123456789aBcDeFAbCdEf00ff";
+   std::vector<uint8_t> decoded = bc_toolbox::from_hex(upper);
+   BOOST_CHECK_EQUAL( bc_toolbox::to_hex(decoded), "00ffabcdef0123456789abcdefabcdef0123456789abcdefabcdef00ff" );
+}
+
+BOOST_AUTO_TEST_CASE( txid_display )
+{
+   std::string txid = "4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b";
+   uint8_t raw[32];
+   BOOST_CHECK_EQUAL( bc_toolbox::hex_decode_reversed(txid, bc_toolbox::mutable_byte_span(raw, 32)), 32 );
+   BOOST_CHECK_EQUAL( raw[0], 0x3b );
+   BOOST_CHECK_EQUAL( raw[31], 0x4a );
+   char out[64];
+   BOOST_CHECK_EQUAL( bc_toolbox::hex_encode_reversed(bc_toolbox::byte_span(raw, 32),
+         bc_toolbox::span<char>(out, 64)), 64 );
+   BOOST_CHECK_EQUAL( std::string(out, 64), txid );
+}
+
+BOOST_AUTO_TEST_CASE( bad_input )
+{
+   std::string good(128, 'a');
+   BOOST_CHECK_THROW( bc_toolbox::from_hex(std::string("abc")), std::invalid_argument );
+   // a bad character in every position, inside and outside the SIMD blocks
+   for(size_t pos = 0; pos < good.size(); ++pos)
+   {
+      std::string bad = good;
+      bad[pos] = (pos % 3 == 0 ? 'g' : (pos % 3 == 1 ? ' ' : (char)0xc3));
+      BOOST_CHECK_THROW( bc_toolbox::from_hex(bad), std::invalid_argument );
+   }
+   BOOST_CHECK_THROW( bc_toolbox::from_hex(std::string("0/")), std::invalid_argument );
+   BOOST_CHECK_THROW( bc_toolbox::from_hex(std::string("0:")), std::invalid_argument );
+   BOOST_CHECK_THROW( bc_toolbox::from_hex(std::string("0@")), std::invalid_argument );
+   BOOST_CHECK_THROW( bc_toolbox::from_hex(std::string("0G")), std::invalid_argument );
+   uint8_t small[1] = { 0 };
+   BOOST_CHECK_THROW( bc_toolbox::hex_decode(std::string("0000"), bc_toolbox::mutable_byte_span(small, 1)),
+         std::invalid_argument );
+   char out[3];
+   BOOST_CHECK_THROW( bc_toolbox::hex_encode(bc_toolbox::byte_span(small, 1),
+         bc_toolbox::span<char>(out, 1)), std::invalid_argument );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
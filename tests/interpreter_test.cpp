@@ -0,0 +1,226 @@
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <string>
+
+#include <interpreter.hpp>
+#include <hex_conversion.hpp>
+#include <script.hpp>
+#include <htlc.hpp>
+#include <hash.hpp>
+
+using namespace bc_toolbox;
+
+BOOST_AUTO_TEST_SUITE( interpreter_test )
+
+script_error run(const std::vector<uint8_t>& script, uint32_t flags = verify_standard)
+{
+   interpreter interp;
+   signature_checker checker;
+   script_error ret_val = interp.eval(script, checker, flags);
+   if (ret_val == script_error::ok && (interp.stack().empty() || !cast_to_bool(interp.stack()[interp.stack().size() - 1])))
+      return script_error::eval_false;
+   return ret_val;
+}
+
+BOOST_AUTO_TEST_CASE( arithmetic )
+{
+   BOOST_CHECK( run({ OP_2, OP_3, OP_ADD, OP_5, OP_EQUAL }) == script_error::ok );
+   BOOST_CHECK( run({ OP_2, OP_3, OP_SUB, OP_1NEGATE, OP_NUMEQUAL }) == script_error::ok );
+   BOOST_CHECK( run({ OP_1NEGATE, OP_ABS, OP_1, OP_EQUAL }) == script_error::ok );
+   BOOST_CHECK( run({ OP_16, OP_16, OP_ADD, 0x01, 0x20, OP_EQUAL }) == script_error::ok );
+   BOOST_CHECK( run({ OP_5, OP_2, OP_7, OP_WITHIN }) == script_error::ok );
+   BOOST_CHECK( run({ OP_7, OP_2, OP_7, OP_WITHIN }) == script_error::eval_false );
+   BOOST_CHECK( run({ OP_3, OP_9, OP_MAX, OP_9, OP_NUMEQUALVERIFY, OP_1 }) == script_error::ok );
+   BOOST_CHECK( run({ OP_3, OP_9, OP_MIN, OP_9, OP_NUMEQUALVERIFY, OP_1 }) == script_error::numequalverify );
+   // 0x80 is negative zero, so false
+   BOOST_CHECK( run({ 0x01, 0x80 }, verify_none) == script_error::eval_false );
+   BOOST_CHECK( run({ 0x01, 0x80, OP_1ADD }) == script_error::bad_number );
+   // numbers are limited to 4 bytes
+   BOOST_CHECK( run({ 0x05, 1, 2, 3, 4, 5, OP_1ADD }) == script_error::bad_number );
+   BOOST_CHECK( run({ 0x01, 0x05 }) == script_error::minimal_data );
+   BOOST_CHECK( run({ 0x01, 0x05 }, verify_none) == script_error::ok );
+}
+
+BOOST_AUTO_TEST_CASE( stack_operations )
+{
+   BOOST_CHECK( run({ OP_1, OP_2, OP_SWAP, OP_1, OP_EQUALVERIFY, OP_2, OP_EQUAL }) == script_error::ok );
+   BOOST_CHECK( run({ OP_1, OP_2, OP_3, OP_ROT, OP_1, OP_EQUALVERIFY, OP_2DROP, OP_1 }) == script_error::ok );
+   BOOST_CHECK( run({ OP_1, OP_2, OP_3, OP_2, OP_PICK, OP_1, OP_EQUALVERIFY, OP_DEPTH, OP_3, OP_EQUAL }) == script_error::ok );
+   BOOST_CHECK( run({ OP_1, OP_2, OP_3, OP_2, OP_ROLL, OP_1, OP_EQUALVERIFY, OP_DEPTH, OP_2, OP_EQUAL }) == script_error::ok );
+   BOOST_CHECK( run({ OP_1, OP_TOALTSTACK, OP_2, OP_FROMALTSTACK, OP_1, OP_EQUALVERIFY }) == script_error::ok );
+   BOOST_CHECK( run({ OP_FROMALTSTACK }) == script_error::invalid_altstack_operation );
+   BOOST_CHECK( run({ OP_1, OP_2, OP_TUCK, OP_DEPTH, OP_3, OP_EQUALVERIFY, OP_2, OP_EQUAL }) == script_error::ok );
+   BOOST_CHECK( run({ OP_1, OP_2, OP_3, OP_4, OP_2SWAP, OP_2, OP_EQUALVERIFY, OP_1, OP_EQUALVERIFY, OP_2DROP, OP_1 }) == script_error::ok );
+   BOOST_CHECK( run({ OP_DROP }) == script_error::invalid_stack_operation );
+   BOOST_CHECK( run({ 0x03, 'a', 'b', 'c', OP_SIZE, OP_3, OP_EQUAL }) == script_error::ok );
+   // the stack may not grow past 1000 elements
+   std::vector<uint8_t> big = { OP_1 };
+   for(int i = 0; i < 999; ++i)
+      big.push_back(OP_1);
+   BOOST_CHECK( run(big) == script_error::ok );
+   big.push_back(OP_1);
+   BOOST_CHECK( run(big) == script_error::stack_size );
+}
+
+BOOST_AUTO_TEST_CASE( flow_control )
+{
+   BOOST_CHECK( run({ OP_1, OP_IF, OP_2, OP_ELSE, OP_3, OP_ENDIF, OP_2, OP_EQUAL }) == script_error::ok );
+   BOOST_CHECK( run({ OP_0, OP_IF, OP_2, OP_ELSE, OP_3, OP_ENDIF, OP_3, OP_EQUAL }) == script_error::ok );
+   BOOST_CHECK( run({ OP_0, OP_NOTIF, OP_1, OP_IF, OP_4, OP_ENDIF, OP_ELSE, OP_5, OP_ENDIF, OP_4, OP_EQUAL }) == script_error::ok );
+   // ELSE may appear more than once
+   BOOST_CHECK( run({ OP_1, OP_IF, OP_2, OP_ELSE, OP_3, OP_ELSE, OP_4, OP_ENDIF, OP_DEPTH, OP_2, OP_EQUAL }) == script_error::ok );
+   BOOST_CHECK( run({ OP_1, OP_IF, OP_1 }) == script_error::unbalanced_conditional );
+   BOOST_CHECK( run({ OP_ENDIF }) == script_error::unbalanced_conditional );
+   BOOST_CHECK( run({ OP_1, OP_RETURN }) == script_error::op_return );
+   BOOST_CHECK( run({ OP_0, OP_IF, OP_RETURN, OP_ENDIF, OP_1 }) == script_error::ok );
+   // disabled and bad opcodes
+   BOOST_CHECK( run({ OP_0, OP_IF, OP_CAT, OP_ENDIF, OP_1 }) == script_error::disabled_opcode );
+   BOOST_CHECK( run({ OP_0, OP_IF, OP_VERIF, OP_ENDIF, OP_1 }) == script_error::bad_opcode );
+   BOOST_CHECK( run({ OP_0, OP_IF, OP_RESERVED, OP_ENDIF, OP_1 }) == script_error::ok );
+   BOOST_CHECK( run({ OP_RESERVED }) == script_error::bad_opcode );
+   BOOST_CHECK( run({ OP_1, OP_VERIFY }) == script_error::eval_false );
+   BOOST_CHECK( run({ OP_0, OP_VERIFY }) == script_error::verify );
+   // a push that runs past the end
+   BOOST_CHECK( run({ 0x05, 1, 2 }) == script_error::bad_opcode );
+}
+
+BOOST_AUTO_TEST_CASE( hashing )
+{
+   std::vector<uint8_t> s = { 0x03, 'a', 'b', 'c', OP_SHA256, 0x20 };
+   std::vector<uint8_t> digest = hex_string_to_vector("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+   s.insert(s.end(), digest.begin(), digest.end());
+   s.push_back(OP_EQUAL);
+   BOOST_CHECK( run(s) == script_error::ok );
+
+   std::vector<uint8_t> r = { 0x03, 'a', 'b', 'c', OP_RIPEMD160, 0x14 };
+   digest = hex_string_to_vector("8eb208f7e05d987a9b044a8e98c6b087f15a0bfc");
+   r.insert(r.end(), digest.begin(), digest.end());
+   r.push_back(OP_EQUAL);
+   BOOST_CHECK( run(r) == script_error::ok );
+
+   std::vector<uint8_t> h = { 0x03, 'a', 'b', 'c', OP_HASH160, 0x14 };
+   std::vector<uint8_t> abc = { 'a', 'b', 'c' };
+   digest160 expected = hash160(abc);
+   h.insert(h.end(), expected.begin(), expected.end());
+   h.push_back(OP_EQUAL);
+   BOOST_CHECK( run(h) == script_error::ok );
+}
+
+/***
+ * Accepts a signature if its first byte matches the first byte of the key
+ */
+class matching_checker : public signature_checker
+{
+   public:
+      bool check_signature(byte_span signature, byte_span pubkey, byte_span /* script_code */) const override
+      {
+         return !signature.empty() && !pubkey.empty() && signature[0] == pubkey[0];
+      }
+};
+
+BOOST_AUTO_TEST_CASE( multisig )
+{
+   interpreter interp;
+   matching_checker checker;
+   // 0 <sig b> 1 <key a> <key b> 2 CHECKMULTISIG
+   std::vector<uint8_t> s = { OP_0, 0x01, 0xbb, OP_1, 0x01, 0xaa, 0x01, 0xbb, OP_2, OP_CHECKMULTISIG };
+   BOOST_CHECK( interp.verify(byte_span(), s, checker, verify_standard) == script_error::ok );
+   s[2] = 0xcc;
+   BOOST_CHECK( interp.verify(byte_span(), s, checker, verify_standard) == script_error::eval_false );
+   // signatures must be in the same order as the keys
+   std::vector<uint8_t> t = { OP_0, 0x01, 0xbb, 0x01, 0xaa, OP_2, 0x01, 0xaa, 0x01, 0xbb, OP_2, OP_CHECKMULTISIG };
+   BOOST_CHECK( interp.verify(byte_span(), t, checker, verify_standard) == script_error::eval_false );
+   std::swap(t[2], t[4]);
+   BOOST_CHECK( interp.verify(byte_span(), t, checker, verify_standard) == script_error::ok );
+}
+
+class htlc_fixture
+{
+   public:
+      htlc_fixture()
+      {
+         preimage = { 'h', 'e', 'l', 'l', 'o' };
+         recipient_key = std::vector<uint8_t>(33, 0x02);
+         sender_key = std::vector<uint8_t>(33, 0x03);
+         params.hashlock = hash160(preimage);
+         params.recipient_pubkey_hash = hash160(recipient_key);
+         params.sender_pubkey_hash = hash160(sender_key);
+         params.locktime = 600000;
+         redeem.add_bytes(htlc_script(params));
+         script_pubkey = redeem.p2sh_script();
+      }
+      std::vector<uint8_t> claim(const std::vector<uint8_t>& secret)
+      {
+         script s;
+         s.add_bytes_with_size(std::vector<uint8_t>(71, 0x30));
+         s.add_bytes_with_size(recipient_key);
+         s.add_bytes_with_size(secret);
+         s.add_opcode(OP_1);
+         s.add_bytes_with_size(redeem.bytes());
+         return s.release();
+      }
+      std::vector<uint8_t> refund()
+      {
+         script s;
+         s.add_bytes_with_size(std::vector<uint8_t>(71, 0x30));
+         s.add_bytes_with_size(sender_key);
+         s.add_opcode(OP_0);
+         s.add_bytes_with_size(redeem.bytes());
+         return s.release();
+      }
+      std::vector<uint8_t> preimage;
+      std::vector<uint8_t> recipient_key;
+      std::vector<uint8_t> sender_key;
+      htlc_params params;
+      script redeem;
+      std::vector<uint8_t> script_pubkey;
+      interpreter interp;
+};
+
+BOOST_FIXTURE_TEST_CASE( htlc_spend_paths, htlc_fixture )
+{
+   dry_run_checker before(2, 599999, 0xfffffffe);
+   dry_run_checker after(2, 600000, 0xfffffffe);
+   dry_run_checker bad_signatures(2, 600000, 0xfffffffe, false);
+
+   BOOST_CHECK( interp.verify(claim(preimage), script_pubkey, before, verify_standard) == script_error::ok );
+   BOOST_CHECK( interp.verify(claim({ 'n', 'o' }), script_pubkey, before, verify_standard) == script_error::equalverify );
+   BOOST_CHECK( interp.verify(claim(preimage), script_pubkey, bad_signatures, verify_standard) == script_error::eval_false );
+
+   BOOST_CHECK( interp.verify(refund(), script_pubkey, after, verify_standard) == script_error::ok );
+   BOOST_CHECK( interp.verify(refund(), script_pubkey, before, verify_standard) == script_error::unsatisfied_locktime );
+   // a final input, or a timestamp lock time, does not satisfy a block height
+   BOOST_CHECK( interp.verify(refund(), script_pubkey, dry_run_checker(2, 600000, 0xffffffff), verify_standard)
+         == script_error::unsatisfied_locktime );
+   BOOST_CHECK( interp.verify(refund(), script_pubkey, dry_run_checker(2, 1600000000, 0), verify_standard)
+         == script_error::unsatisfied_locktime );
+   // without BIP65, OP_CHECKLOCKTIMEVERIFY does nothing
+   BOOST_CHECK( interp.verify(refund(), script_pubkey, before, verify_p2sh) == script_error::ok );
+   // the recipient can not use the refund path
+   std::vector<uint8_t> wrong = refund();
+   std::copy(recipient_key.begin(), recipient_key.end(), wrong.begin() + 73);
+   BOOST_CHECK( interp.verify(wrong, script_pubkey, after, verify_standard) == script_error::equalverify );
+
+   // the stacks and arena are reused, so repeated runs do not grow
+   interp.verify(claim(preimage), script_pubkey, before, verify_standard);
+   size_t used = interp.arena_used();
+   BOOST_CHECK( used > 0 );
+   for(int i = 0; i < 100; ++i)
+      interp.verify(claim(preimage), script_pubkey, before, verify_standard);
+   BOOST_CHECK_EQUAL( interp.arena_used(), used );
+}
+
+BOOST_AUTO_TEST_CASE( check_sequence )
+{
+   interpreter interp;
+   // 10 blocks relative lock time
+   std::vector<uint8_t> s = { OP_10, OP_CHECKSEQUENCEVERIFY, OP_DROP, OP_1 };
+   BOOST_CHECK( interp.verify(byte_span(), s, dry_run_checker(2, 0, 10), verify_standard) == script_error::ok );
+   BOOST_CHECK( interp.verify(byte_span(), s, dry_run_checker(2, 0, 9), verify_standard) == script_error::unsatisfied_locktime );
+   BOOST_CHECK( interp.verify(byte_span(), s, dry_run_checker(1, 0, 10), verify_standard) == script_error::unsatisfied_locktime );
+   s[0] = OP_1NEGATE;
+   BOOST_CHECK( interp.verify(byte_span(), s, dry_run_checker(2, 0, 10), verify_standard) == script_error::negative_locktime );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,129 @@
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+
+#include <hex_conversion.hpp>
+#include <merkle.hpp>
+
+BOOST_AUTO_TEST_SUITE( merkle_test )
+
+/***
+ * Hashes are displayed byte-reversed
+ */
+bc_toolbox::digest256 from_display(const std::string& hex)
+{
+   std::vector<uint8_t> bytes = bc_toolbox::hex_string_to_vector(hex);
+   bc_toolbox::digest256 ret_val;
+   std::copy(bytes.rbegin(), bytes.rend(), ret_val.begin());
+   return ret_val;
+}
+
+std::string to_display(const bc_toolbox::digest256& hash)
+{
+   return bc_toolbox::vector_to_hex_string(std::vector<uint8_t>(hash.rbegin(), hash.rend()));
+}
+
+/***
+ * The transactions of block 100000
+ */
+std::vector<bc_toolbox::digest256> block_100000()
+{
+   std::vector<bc_toolbox::digest256> ret_val;
+   ret_val.push_back(from_display("8c14f0db3df150123e6f3dbbf30f8b955a8249b62ac1d1ff16284aefa3d06d87"));
+   ret_val.push_back(from_display("fff2525b8931402dd09222c50775608f75787bd2b87e56995a7bdd30f79702c4"));
+   ret_val.push_back(from_display("6359f0868171b1d194cbee1af2f16ea598ae8fad666d9b012c8ed2b79a236ec4"));
+   ret_val.push_back(from_display("e9a66845e05d5abc0ad04ec80f774a7e585c6e8db975962d069a522137b80c1d"));
+   return ret_val;
+}
+
+BOOST_AUTO_TEST_CASE( sha256d64_matches_sha256d )
+{
+   std::vector<uint8_t> in(64 * 19);
+   for(size_t i = 0; i < in.size(); ++i)
+      in[i] = (uint8_t)(i * 13);
+   std::vector<uint8_t> out(32 * 19);
+   bc_toolbox::sha256d64(out.data(), in.data(), 19);
+   for(size_t i = 0; i < 19; ++i)
+   {
+      bc_toolbox::digest256 expected;
+      bc_toolbox::sha256d(bc_toolbox::byte_span(in.data() + i * 64, 64), expected.data());
+      BOOST_CHECK( std::equal(expected.begin(), expected.end(), out.begin() + i * 32) );
+   }
+   // in place
+   bc_toolbox::sha256d64(in.data(), in.data(), 19);
+   BOOST_CHECK( std::equal(out.begin(), out.end(), in.begin()) );
+}
+
+BOOST_AUTO_TEST_CASE( roots )
+{
+   std::vector<bc_toolbox::digest256> txids = block_100000();
+   bool mutated = true;
+   BOOST_CHECK_EQUAL( to_display(bc_toolbox::merkle_root(txids, &mutated)),
+         "f3e94742aca4b5ef85488dc37c06c3282295ffec960994b2c0d5ac2a25a95766" );
+   BOOST_CHECK( !mutated );
+   // an odd number of transactions duplicates the last one
+   std::string x = "x";
+   bc_toolbox::digest256 extra;
+   bc_toolbox::sha256d(bc_toolbox::byte_span((const uint8_t*)x.data(), x.size()), extra.data());
+   txids.push_back(extra);
+   BOOST_CHECK_EQUAL( to_display(bc_toolbox::merkle_root(txids, &mutated)),
+         "317589f9c62f4493d36a6ec8c5d3cd6d6b754688363af81ec0c54a8c17a1fedd" );
+   BOOST_CHECK( !mutated );
+   // doing the duplication by hand gives the same root, but is flagged
+   txids.push_back(extra);
+   BOOST_CHECK_EQUAL( to_display(bc_toolbox::merkle_root(txids, &mutated)),
+         "317589f9c62f4493d36a6ec8c5d3cd6d6b754688363af81ec0c54a8c17a1fedd" );
+   BOOST_CHECK( mutated );
+   // a block with only a coinbase has the coinbase txid as its root
+   bc_toolbox::digest256 genesis = from_display("4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b");
+   BOOST_CHECK( bc_toolbox::merkle_root(std::vector<bc_toolbox::digest256>(1, genesis)) == genesis );
+   // the coinbase wtxid does not count
+   BOOST_CHECK( bc_toolbox::witness_merkle_root(std::vector<bc_toolbox::digest256>(1, genesis))
+         == bc_toolbox::digest256() );
+}
+
+BOOST_AUTO_TEST_CASE( branches )
+{
+   std::vector<bc_toolbox::digest256> txids = block_100000();
+   std::string x = "x";
+   bc_toolbox::digest256 extra;
+   bc_toolbox::sha256d(bc_toolbox::byte_span((const uint8_t*)x.data(), x.size()), extra.data());
+   txids.push_back(extra);
+   bc_toolbox::digest256 root = bc_toolbox::merkle_root(txids);
+
+   std::vector<bc_toolbox::merkle_proof> proofs;
+   for(uint32_t i = 0; i < txids.size(); ++i)
+   {
+      bc_toolbox::merkle_proof proof;
+      proof.leaf = txids[i];
+      proof.branch = bc_toolbox::merkle_branch(txids, i);
+      proof.index = i;
+      proof.root = root;
+      BOOST_CHECK_EQUAL( proof.branch.size(), 3 );
+      BOOST_CHECK( bc_toolbox::verify_proof(proof) );
+      proofs.push_back(proof);
+   }
+   // a proof from a smaller block, with a shorter branch
+   bc_toolbox::merkle_proof small;
+   small.leaf = txids[1];
+   small.branch = bc_toolbox::merkle_branch(bc_toolbox::span<const bc_toolbox::digest256>(txids.data(), 2), 1);
+   small.index = 1;
+   small.root = bc_toolbox::merkle_root(bc_toolbox::span<const bc_toolbox::digest256>(txids.data(), 2));
+   proofs.push_back(small);
+   // a proof with the wrong position
+   bc_toolbox::merkle_proof wrong = proofs[0];
+   wrong.index = 1;
+   proofs.push_back(wrong);
+
+   std::vector<bool> results = bc_toolbox::verify_proofs(proofs);
+   BOOST_REQUIRE_EQUAL( results.size(), proofs.size() );
+   for(size_t i = 0; i < results.size() - 1; ++i)
+      BOOST_CHECK( results[i] );
+   BOOST_CHECK( !results.back() );
+
+   BOOST_CHECK_THROW( bc_toolbox::merkle_branch(txids, txids.size()), std::out_of_range );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
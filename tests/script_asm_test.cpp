@@ -0,0 +1,113 @@
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include <script_asm.hpp>
+#include <hex_conversion.hpp>
+#include <hex.hpp>
+#include <htlc.hpp>
+
+BOOST_AUTO_TEST_SUITE( script_asm_test )
+
+BOOST_AUTO_TEST_CASE( opcode_table )
+{
+   BOOST_CHECK_EQUAL( bc_toolbox::opcode_name(bc_toolbox::OP_DUP), "OP_DUP" );
+   BOOST_CHECK_EQUAL( bc_toolbox::opcode_name(bc_toolbox::OP_TOALTSTACK), "OP_TOALTSTACK" );
+   BOOST_CHECK_EQUAL( bc_toolbox::opcode_name(bc_toolbox::OP_NOP4), "OP_NOP4" );
+   BOOST_CHECK_EQUAL( bc_toolbox::opcode_name(0x14), "OP_PUSHBYTES_20" );
+   BOOST_CHECK_EQUAL( bc_toolbox::opcode_name(0xc0), "OP_UNKNOWN" );
+   BOOST_CHECK( bc_toolbox::get_opcode_info(bc_toolbox::OP_CAT).disabled );
+   BOOST_CHECK( !bc_toolbox::get_opcode_info(bc_toolbox::OP_SIZE).disabled );
+   BOOST_CHECK( bc_toolbox::get_opcode_info(bc_toolbox::OP_CHECKLOCKTIMEVERIFY).type == bc_toolbox::opcode_type::locktime );
+   BOOST_CHECK( bc_toolbox::get_opcode_info(bc_toolbox::OP_16).type == bc_toolbox::opcode_type::number );
+   // every named opcode agrees with opcode_to_string
+   for(int i = 0; i < 256; ++i)
+   {
+      if (bc_toolbox::get_opcode_info(i).type == bc_toolbox::opcode_type::invalid && i < bc_toolbox::OP_PUBKEYHASH)
+         BOOST_CHECK_THROW( bc_toolbox::opcode_to_string(i), std::invalid_argument );
+      else
+         BOOST_CHECK_EQUAL( bc_toolbox::opcode_to_string(i), bc_toolbox::opcode_name(i) );
+   }
+}
+
+BOOST_AUTO_TEST_CASE( iterate )
+{
+   std::vector<uint8_t> script = bc_toolbox::from_hex(std::string("76a914000102030405060708090a0b0c0d0e0f1011121388ac"));
+   bc_toolbox::script_iterator it(script);
+   bc_toolbox::script_op op;
+   std::vector<uint8_t> opcodes;
+   while (it.next(op))
+   {
+      opcodes.push_back(op.opcode);
+      if (op.opcode == 0x14)
+      {
+         BOOST_CHECK_EQUAL( op.offset, 2 );
+         BOOST_CHECK_EQUAL( op.data.size(), 20 );
+         // points into the script
+         BOOST_CHECK( op.data.data() == script.data() + 3 );
+      }
+   }
+   BOOST_CHECK( !it.failed() );
+   BOOST_CHECK_EQUAL( opcodes.size(), 5 );
+
+   // OP_PUSHDATA2 with a 2 byte length, then a push that runs past the end
+   std::vector<uint8_t> truncated = { bc_toolbox::OP_PUSHDATA2, 0x02, 0x00, 0xaa, 0xbb, 0x05, 0x01 };
+   bc_toolbox::script_iterator it2(truncated);
+   BOOST_CHECK( it2.next(op) );
+   BOOST_CHECK_EQUAL( op.data.size(), 2 );
+   BOOST_CHECK( !it2.next(op) );
+   BOOST_CHECK( it2.failed() );
+   BOOST_CHECK( !bc_toolbox::is_push_only(truncated) );
+   BOOST_CHECK( bc_toolbox::is_push_only(std::vector<uint8_t>{ bc_toolbox::OP_0, 0x01, 0x07, bc_toolbox::OP_16 }) );
+   BOOST_CHECK( !bc_toolbox::is_push_only(std::vector<uint8_t>{ bc_toolbox::OP_0, bc_toolbox::OP_DUP }) );
+}
+
+BOOST_AUTO_TEST_CASE( disassemble )
+{
+   std::vector<uint8_t> p2pkh = bc_toolbox::from_hex(std::string("76a914000102030405060708090a0b0c0d0e0f1011121388ac"));
+   BOOST_CHECK_EQUAL( bc_toolbox::disassemble(p2pkh),
+         "OP_DUP OP_HASH160 000102030405060708090a0b0c0d0e0f10111213 OP_EQUALVERIFY OP_CHECKSIG" );
+   std::vector<uint8_t> odd = { bc_toolbox::OP_0, bc_toolbox::OP_PUSHDATA1, 0x00, bc_toolbox::OP_PUSHDATA1, 0x01, 0xff, 0x03, 0x01 };
+   BOOST_CHECK_EQUAL( bc_toolbox::disassemble(odd), "OP_0 OP_PUSHDATA1 0x OP_PUSHDATA1 ff [error]" );
+
+   // appends to the string
+   std::string out = "x: ";
+   bc_toolbox::disassemble(std::vector<uint8_t>{ bc_toolbox::OP_1 }, out);
+   BOOST_CHECK_EQUAL( out, "x: OP_1" );
+}
+
+BOOST_AUTO_TEST_CASE( assemble )
+{
+   std::vector<uint8_t> expected = bc_toolbox::from_hex(std::string("76a914000102030405060708090a0b0c0d0e0f1011121388ac"));
+   BOOST_CHECK( bc_toolbox::assemble("OP_DUP OP_HASH160 000102030405060708090a0b0c0d0e0f10111213 OP_EQUALVERIFY OP_CHECKSIG")
+         == expected );
+   BOOST_CHECK( bc_toolbox::assemble("OP_TRUE  0x05\nOP_NOP2") == (std::vector<uint8_t>{ 0x51, 0x01, 0x05, 0xb1 }) );
+   BOOST_CHECK( bc_toolbox::assemble("OP_PUSHDATA2 abcd") == (std::vector<uint8_t>{ 0x4d, 0x02, 0x00, 0xab, 0xcd }) );
+   BOOST_CHECK( bc_toolbox::assemble("").empty() );
+   // big pushes get OP_PUSHDATA1
+   std::string big(200, 'a');
+   std::vector<uint8_t> assembled = bc_toolbox::assemble(big);
+   BOOST_CHECK_EQUAL( assembled.size(), 102 );
+   BOOST_CHECK_EQUAL( assembled[0], bc_toolbox::OP_PUSHDATA1 );
+   BOOST_CHECK_EQUAL( assembled[1], 100 );
+
+   BOOST_CHECK_THROW( bc_toolbox::assemble("OP_FROB"), std::invalid_argument );
+   BOOST_CHECK_THROW( bc_toolbox::assemble("abc"), std::invalid_argument );
+   BOOST_CHECK_THROW( bc_toolbox::assemble("OP_PUSHDATA1"), std::invalid_argument );
+   BOOST_CHECK_THROW( bc_toolbox::assemble("OP_PUSHBYTES_1 00"), std::invalid_argument );
+
+   // round trip, including unusual pushes
+   bc_toolbox::htlc_params params;
+   params.hashlock.fill(1);
+   params.recipient_pubkey_hash.fill(2);
+   params.sender_pubkey_hash.fill(3);
+   params.locktime = 600000;
+   std::vector<uint8_t> htlc = bc_toolbox::htlc_script(params);
+   BOOST_CHECK( bc_toolbox::assemble(bc_toolbox::disassemble(htlc)) == htlc );
+   std::vector<uint8_t> odd = { bc_toolbox::OP_PUSHDATA1, 0x00, 0x01, 0x05, bc_toolbox::OP_PUSHDATA4, 0x01, 0x00, 0x00, 0x00, 0x10 };
+   BOOST_CHECK( bc_toolbox::assemble(bc_toolbox::disassemble(odd)) == odd );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,12 +3,15 @@
 
 #include <vector> 
 #include <stdexcept>
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
 
 #include <script.hpp>
 #include <transaction.hpp>
+#include <hash.hpp>
+#include <htlc.hpp>
 
 BOOST_AUTO_TEST_SUITE( script_test )
 
@@ -59,6 +62,15 @@ std::vector<uint8_t> pubkey_hash(std::vector<uint8_t> incoming)
    return bc_toolbox::ripemd160(sh256);
 }
 
+/*****
+ * a hash in the byte order bitcoind displays it
+ */
+std::string display_hash(const bc_toolbox::digest256& hash)
+{
+   std::vector<uint8_t> reversed(hash.rbegin(), hash.rend());
+   return vector_to_hex_string(reversed);
+}
+
 std::string read_pk_from_file(std::string filename)
 {
    std::ifstream infile(filename);
@@ -108,6 +120,18 @@ BOOST_AUTO_TEST_CASE( int_conv )
       BOOST_CHECK_EQUAL( 8, rslt.first );
       test_vector( rslt.second, expected );
    }
+   {
+      // the top bit is the sign, so 128 needs a second byte
+      auto rslt = bc_toolbox::pack(128);
+      std::vector<uint8_t> expected{0x80, 0x00};
+      BOOST_CHECK_EQUAL( 4, rslt.first );
+      test_vector( rslt.second, expected );
+      rslt = bc_toolbox::pack(-128);
+      expected = {0x80, 0x80};
+      test_vector( rslt.second, expected );
+      rslt = bc_toolbox::pack(0);
+      BOOST_CHECK( rslt.second.empty() );
+   }
 }
 
 BOOST_AUTO_TEST_CASE( hash_test )
@@ -238,6 +262,104 @@ BOOST_AUTO_TEST_CASE( timelock_script )
    }
 }
 
+BOOST_AUTO_TEST_CASE( large_script )
+{
+   bc_toolbox::script s;
+   BOOST_CHECK_EQUAL( s.capacity(), bc_toolbox::script::inline_capacity );
+   // pushes that need OP_PUSHDATA1, 2 and 4
+   std::vector<uint8_t> data80(80, 0x11);
+   std::vector<uint8_t> data300(300, 0x22);
+   std::vector<uint8_t> data70000(70000, 0x33);
+   s.add_opcode(bc_toolbox::OP_DUP);
+   s.add_bytes_with_size(data80);
+   const uint8_t* inline_pos = s.get_bytes();
+   s.add_bytes_with_size(data300);
+   BOOST_CHECK( s.get_bytes() != inline_pos ); // moved to the heap
+   s.add_bytes_with_size(data70000);
+   s.add_opcode(bc_toolbox::OP_DROP);
+   BOOST_REQUIRE_EQUAL( s.size(), 1 + 82 + 303 + 70005 + 1 );
+   bc_toolbox::byte_span bytes = s.bytes();
+   BOOST_CHECK_EQUAL( bytes[1], bc_toolbox::OP_PUSHDATA1 );
+   BOOST_CHECK_EQUAL( bytes[2], 80 );
+   BOOST_CHECK_EQUAL( bytes[83], bc_toolbox::OP_PUSHDATA2 );
+   BOOST_CHECK_EQUAL( bytes[84], 0x2c );
+   BOOST_CHECK_EQUAL( bytes[85], 0x01 );
+   BOOST_CHECK_EQUAL( bytes[386], bc_toolbox::OP_PUSHDATA4 );
+   BOOST_CHECK_EQUAL( bytes[387], 0x70 );
+   BOOST_CHECK_EQUAL( bytes[388], 0x11 );
+   BOOST_CHECK_EQUAL( bytes[389], 0x01 );
+   BOOST_CHECK_EQUAL( bytes[390], 0x00 );
+   BOOST_CHECK_EQUAL( bytes[s.size() - 1], bc_toolbox::OP_DROP );
+
+   // copies are independent, moves and release do not copy
+   bc_toolbox::script copy = s;
+   BOOST_CHECK( copy.get_bytes_as_vector() == s.get_bytes_as_vector() );
+   const uint8_t* heap_pos = s.get_bytes();
+   bc_toolbox::script moved = std::move(s);
+   BOOST_CHECK( moved.get_bytes() == heap_pos );
+   BOOST_CHECK_EQUAL( s.size(), 0 );
+   std::vector<uint8_t> released = moved.release();
+   BOOST_CHECK( released.data() == heap_pos );
+   BOOST_CHECK_EQUAL( moved.size(), 0 );
+   BOOST_CHECK( released == copy.get_bytes_as_vector() );
+
+   // small scripts stay inline, even when copied
+   bc_toolbox::script small;
+   small.reserve(10);
+   BOOST_CHECK_EQUAL( small.capacity(), bc_toolbox::script::inline_capacity );
+   small.add_opcode(bc_toolbox::OP_1);
+   bc_toolbox::script small_copy(small);
+   small_copy.add_opcode(bc_toolbox::OP_2);
+   BOOST_CHECK_EQUAL( small.size(), 1 );
+   BOOST_CHECK_EQUAL( small_copy.size(), 2 );
+   BOOST_CHECK_EQUAL( small_copy.bytes()[0], bc_toolbox::OP_1 );
+}
+
+BOOST_AUTO_TEST_CASE( htlc_template )
+{
+   bc_toolbox::htlc_params params;
+   for(int i = 0; i < 20; ++i)
+   {
+      params.hashlock[i] = i;
+      params.recipient_pubkey_hash[i] = 0x40 + i;
+      params.sender_pubkey_hash[i] = 0x80 + i;
+   }
+   // locktimes of every width, including ones that need a sign byte
+   std::vector<uint32_t> locktimes = { 100, 200, 800000, 1551447083, 0xfffffffe };
+   for(uint32_t locktime : locktimes)
+   {
+      params.locktime = locktime;
+      bc_toolbox::script s;
+      s.add_opcode(bc_toolbox::OP_IF);
+      s.add_opcode(bc_toolbox::OP_HASH160);
+      s.add_bytes_with_size(params.hashlock);
+      s.add_opcode(bc_toolbox::OP_EQUALVERIFY);
+      s.add_opcode(bc_toolbox::OP_DUP);
+      s.add_opcode(bc_toolbox::OP_HASH160);
+      s.add_bytes_with_size(params.recipient_pubkey_hash);
+      s.add_opcode(bc_toolbox::OP_ELSE);
+      uint8_t number[9];
+      s.add_bytes_with_size(bc_toolbox::byte_span(number, bc_toolbox::write_script_number(locktime, number)));
+      s.add_opcode(bc_toolbox::OP_CHECKLOCKTIMEVERIFY);
+      s.add_opcode(bc_toolbox::OP_DROP);
+      s.add_opcode(bc_toolbox::OP_DUP);
+      s.add_opcode(bc_toolbox::OP_HASH160);
+      s.add_bytes_with_size(params.sender_pubkey_hash);
+      s.add_opcode(bc_toolbox::OP_ENDIF);
+      s.add_opcode(bc_toolbox::OP_EQUALVERIFY);
+      s.add_opcode(bc_toolbox::OP_CHECKSIG);
+      BOOST_CHECK_EQUAL( bc_toolbox::htlc_script_size(locktime), s.size() );
+      BOOST_CHECK( bc_toolbox::htlc_script(params) == s.get_bytes_as_vector() );
+   }
+   BOOST_CHECK_EQUAL( bc_toolbox::htlc_template<4>::size, 81 );
+   BOOST_CHECK_EQUAL( bc_toolbox::htlc_template<4>::sender_offset, 58 );
+   uint8_t small[80];
+   BOOST_CHECK_THROW( bc_toolbox::write_htlc_script(params, bc_toolbox::mutable_byte_span(small, 80)),
+         std::invalid_argument );
+   params.locktime = 0;
+   BOOST_CHECK_THROW( bc_toolbox::htlc_script(params), std::invalid_argument );
+}
+
 /*****
  * Testing my interpretation of an HTLC script
  */
@@ -357,8 +479,8 @@ BOOST_AUTO_TEST_CASE( timelock_script_stackexchange )
 BOOST_AUTO_TEST_CASE( transaction_tests )
 {
    bc_toolbox::transaction trx;
-   trx.version = 2;
-   trx.flag = 1;
+   trx.set_version(2);
+   trx.set_flag(1);
    bc_toolbox::input in;
    in.hash = {
       0x11, 0xb6, 0xe0, 0x46, 0x0b, 0xb8, 0x10, 0xb0, 0x57, 0x44, 0xf8, 
@@ -369,24 +491,23 @@ BOOST_AUTO_TEST_CASE( transaction_tests )
       0x16, 0x00, 0x14, 0x27, 0xc1, 0x06, 0x01, 0x3c, 0x00, 0x42, 0xda, 
       0x16, 0x5c, 0x08, 0x2b, 0x38, 0x70, 0xc3, 0x1f, 0xb3, 0xab, 0x46, 0x83
    };
-   in.sequence = 0xfeffffff;
-   trx.inputs.push_back(in);
+   in.sequence = 0xfffffffe;
+   trx.edit_inputs().push_back(in);
    bc_toolbox::output out1;
    out1.value = 1000000000;
    out1.script = {
       0xa9, 0x14, 0xd8, 0xb6, 0xfc, 0xc8, 0x5a, 0x38, 0x32, 0x61, 0xdf, 
       0x05, 0x42, 0x3d, 0xdf, 0x06, 0x8a, 0x89, 0x87, 0xbf, 0x02, 0x87, 0x87
    };
-   trx.outputs.push_back(out1);
+   trx.edit_outputs().push_back(out1);
    bc_toolbox::output out2;
    out2.value = 8499980080;
    out2.script = {
       0xa9, 0x14, 0xd5, 0xdf, 0x0b, 0x9c, 0xa6, 0xc0, 0xe1, 0xba, 0x60, 
       0xa9, 0xff, 0x29, 0x35, 0x9d, 0x26, 0x00, 0xd9, 0xc6, 0x65, 0x9d, 0x87
    };
-   trx.outputs.push_back(out2);
-   bc_toolbox::witness wit1;
-   wit1.data = {
+   trx.edit_outputs().push_back(out2);
+   std::vector<uint8_t> signature = {
       0x30, 0x44, 0x02, 0x20, 0x3b, 0x85, 0xcb, 0x05, 0xb4, 0x3c, 0xc6, 
       0x8d, 0xf7, 0x2e, 0x2e, 0x54, 0xc6, 0xcb, 0x50, 0x8a, 0xa3, 0x24, 
       0xa5, 0xde, 0x0c, 0x53, 0xf1, 0xbb, 0xfe, 0x99, 0x7c, 0xbd, 0x75, 
@@ -395,15 +516,15 @@ BOOST_AUTO_TEST_CASE( transaction_tests )
       0xef, 0x48, 0x3e, 0x42, 0xe5, 0x9e, 0x04, 0xdb, 0xac, 0xba, 0xf5, 
       0x37, 0xc3, 0xe3, 0xe8, 0x01
    };
-   trx.witnesses.push_back(wit1);
-   bc_toolbox::witness wit2;
-   wit2.data = {
+   std::vector<uint8_t> pubkey = {
       0x03, 0xfb, 0xbd, 0xb3, 0xb3, 0xfc, 0x3a, 0xbb, 0xbd, 0x98, 0x3b, 
       0x20, 0xa5, 0x57, 0x44, 0x5f, 0xb0, 0x41, 0xd6, 0xf2, 0x1c, 0xc5, 
       0x97, 0x7d, 0x21, 0x21, 0x97, 0x1c, 0xb1, 0xce, 0x52, 0x98, 0x97
    };
-   trx.witnesses.push_back(wit2);
-   trx.locktime = 140; // block 140 (8c000000)
+   trx.edit_witnesses().add_stack();
+   trx.edit_witnesses().add_item(signature);
+   trx.edit_witnesses().add_item(pubkey);
+   trx.set_locktime(140); // block 140 (8c000000)
    std::vector<uint8_t> expected = {
       0x02, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01, 0x11, 0xb6, 0xe0, 0x46, 
       0x0b, 0xb8, 0x10, 0xb0, 0x57, 0x44, 0xf8, 0xd3, 0x82, 0x62, 0xf9, 
@@ -430,6 +551,14 @@ BOOST_AUTO_TEST_CASE( transaction_tests )
       0x97, 0x8c, 0x00, 0x00, 0x00 
    };
    test_vector(trx.to_bytes(), expected );
+   // ids and sizes come from the serialization
+   BOOST_CHECK_EQUAL( display_hash(trx.txid()),
+         "375e1622b2690e395df21b33192bad06d2706c139692d43ea84d38df3d183313" );
+   BOOST_CHECK_EQUAL( display_hash(trx.wtxid()),
+         "dbbbd5b42b61698ebd0e6e2b253960948c9b3102f1c04c82013f142d3b5f1773" );
+   BOOST_CHECK_EQUAL( trx.base_size(), 138 );
+   BOOST_CHECK_EQUAL( trx.total_size(), 247 );
+   BOOST_CHECK_EQUAL( trx.weight(), 661 );
 }
 
 BOOST_AUTO_TEST_CASE( varint_test )
@@ -481,4 +610,115 @@ BOOST_AUTO_TEST_CASE( raw_transaction_parse )
    test_vector(result_bytes, bytes);
 }
 
+BOOST_AUTO_TEST_CASE( segwit_transaction_parse )
+{
+   std::string raw_tx_string = "0200000000010111b6e0460bb810b05744f8d38262f95fbab02b168b070598a6f31fad438fced4000000001716001427c106013c0042da165c082b3870c31fb3ab4683feffffff0200ca9a3b0000000017a914d8b6fcc85a383261df05423ddf068a8987bf0287873067a3fa0100000017a914d5df0b9ca6c0e1ba60a9ff29359d2600d9c6659d870247304402203b85cb05b43cc68df72e2e54c6cb508aa324a5de0c53f1bbfe997cbd7509774d022041e1b1823bdaddcd6581d7cde6e6a4c4dbef483e42e59e04dbacbaf537c3e3e8012103fbbdb3b3fc3abbbd983b20a557445fb041d6f21cc5977d2121971cb1ce5298978c000000";
+   std::vector<uint8_t> bytes = bc_toolbox::hex_string_to_vector(raw_tx_string);
+   bc_toolbox::transaction tx(bytes);
+   BOOST_CHECK_EQUAL( tx.get_flag(), 1 );
+   BOOST_CHECK_EQUAL( tx.get_inputs().size(), 1 );
+   BOOST_CHECK_EQUAL( tx.get_outputs().size(), 2 );
+   BOOST_CHECK_EQUAL( tx.get_outputs()[1].value, 8499980080 );
+   // the locktime follows the witnesses
+   BOOST_CHECK_EQUAL( tx.get_locktime(), 140 );
+   const bc_toolbox::witness_stacks& witnesses = tx.get_witnesses();
+   BOOST_CHECK_EQUAL( witnesses.size(), 1 );
+   BOOST_CHECK_EQUAL( witnesses.item_count(0), 2 );
+   BOOST_CHECK_EQUAL( witnesses.item(0, 0).size(), 71 );
+   BOOST_CHECK_EQUAL( witnesses.item(0, 0)[70], 0x01 );
+   BOOST_CHECK_EQUAL( witnesses.item(0, 1).size(), 33 );
+   BOOST_CHECK_EQUAL( witnesses.item(0, 1)[0], 0x03 );
+   BOOST_CHECK_THROW( witnesses.item(0, 2), std::out_of_range );
+   BOOST_CHECK_EQUAL( witnesses.item_count(1), 0 );
+   // sizes and offsets are recorded while parsing
+   BOOST_CHECK_EQUAL( tx.total_size(), 247 );
+   BOOST_CHECK_EQUAL( tx.base_size(), 138 );
+   BOOST_CHECK_EQUAL( tx.witness_size(), 109 );
+   BOOST_CHECK_EQUAL( tx.weight(), 661 );
+   BOOST_CHECK_EQUAL( tx.vsize(), 166 );
+   BOOST_CHECK_EQUAL( tx.input_offset(0), 7 );
+   BOOST_CHECK_EQUAL( tx.output_offset(0), 72 );
+   BOOST_CHECK_EQUAL( tx.output_offset(1), 104 );
+   BOOST_CHECK_THROW( tx.output_offset(2), std::out_of_range );
+   // and it serializes back to the same bytes, even after a change
+   test_vector(tx.to_bytes(), bytes);
+   tx.set_locktime(140);
+   test_vector(tx.to_bytes(), bytes);
+   // after which the sizes are worked out from the fields, to the same values
+   BOOST_CHECK_EQUAL( tx.total_size(), 247 );
+   BOOST_CHECK_EQUAL( tx.base_size(), 138 );
+   BOOST_CHECK_EQUAL( tx.vsize(), 166 );
+   BOOST_CHECK_EQUAL( tx.input_offset(0), 7 );
+   BOOST_CHECK_EQUAL( tx.output_offset(1), 104 );
+   BOOST_CHECK_EQUAL( display_hash(tx.wtxid()),
+         "dbbbd5b42b61698ebd0e6e2b253960948c9b3102f1c04c82013f142d3b5f1773" );
+}
+
+BOOST_AUTO_TEST_CASE( large_transaction_serialize )
+{
+   // more than 252 inputs, and scripts longer than 252 bytes, need multi-byte counts
+   bc_toolbox::transaction trx;
+   for(int i = 0; i < 300; ++i)
+   {
+      bc_toolbox::input in;
+      in.hash = std::vector<uint8_t>(32, (uint8_t)i);
+      in.index = i;
+      in.sig_script = std::vector<uint8_t>(i, 0x51);
+      in.sequence = 0xffffffff;
+      trx.edit_inputs().push_back(in);
+   }
+   bc_toolbox::output out;
+   out.value = 5000000000;
+   out.script = std::vector<uint8_t>(400, 0x6a);
+   trx.edit_outputs().push_back(out);
+   std::vector<uint8_t> bytes = trx.to_bytes();
+   BOOST_CHECK_EQUAL( bytes.size(), trx.serialized_size() );
+   BOOST_CHECK_EQUAL( bytes[4], 0xfd );
+   BOOST_CHECK_EQUAL( bytes[5], 0x2c );
+   BOOST_CHECK_EQUAL( bytes[6], 0x01 );
+   bc_toolbox::transaction parsed(bytes);
+   BOOST_REQUIRE_EQUAL( parsed.get_inputs().size(), 300 );
+   BOOST_CHECK( parsed.get_inputs()[299].sig_script == trx.get_inputs()[299].sig_script );
+   BOOST_CHECK( parsed.get_outputs()[0].script == out.script );
+   BOOST_CHECK_EQUAL( parsed.get_outputs()[0].value, 5000000000 );
+
+   // several transactions written into one buffer
+   std::vector<uint8_t> segwit = bc_toolbox::hex_string_to_vector("0200000000010111b6e0460bb810b05744f8d38262f95fbab02b168b070598a6f31fad438fced4000000001716001427c106013c0042da165c082b3870c31fb3ab4683feffffff0200ca9a3b0000000017a914d8b6fcc85a383261df05423ddf068a8987bf0287873067a3fa0100000017a914d5df0b9ca6c0e1ba60a9ff29359d2600d9c6659d870247304402203b85cb05b43cc68df72e2e54c6cb508aa324a5de0c53f1bbfe997cbd7509774d022041e1b1823bdaddcd6581d7cde6e6a4c4dbef483e42e59e04dbacbaf537c3e3e8012103fbbdb3b3fc3abbbd983b20a557445fb041d6f21cc5977d2121971cb1ce5298978c000000");
+   bc_toolbox::transaction segwit_trx(segwit);
+   std::vector<uint8_t> buffer(trx.serialized_size() + segwit_trx.serialized_size() + segwit_trx.serialized_size(false));
+   uint8_t* pos = trx.write_to(buffer.data());
+   pos = segwit_trx.write_to(pos);
+   pos = segwit_trx.write_to(pos, false);
+   BOOST_CHECK( pos == buffer.data() + buffer.size() );
+   BOOST_CHECK( std::equal(bytes.begin(), bytes.end(), buffer.begin()) );
+   BOOST_CHECK( std::equal(segwit.begin(), segwit.end(), buffer.begin() + bytes.size()) );
+   // without witness data, the bytes hash to the txid
+   bc_toolbox::digest256 txid;
+   bc_toolbox::sha256d(bc_toolbox::byte_span(buffer.data() + bytes.size() + segwit.size(), segwit_trx.serialized_size(false)),
+         txid.data());
+   BOOST_CHECK( txid == segwit_trx.txid() );
+   std::vector<uint8_t> small(10);
+   BOOST_CHECK_THROW( segwit_trx.write_to(bc_toolbox::mutable_byte_span(small.data(), small.size())), std::out_of_range );
+}
+
+BOOST_AUTO_TEST_CASE( transaction_ids )
+{
+   // the coinbase of the genesis block
+   std::string raw_tx_string = "01000000010000000000000000000000000000000000000000000000000000000000000000ffffffff4d04ffff001d0104455468652054696d65732030332f4a616e2f32303039204368616e63656c6c6f72206f6e206272696e6b206f66207365636f6e64206261696c6f757420666f722062616e6b73ffffffff0100f2052a01000000434104678afdb0fe5548271967f1a67130b7105cd6a828e03909a67962e0ea1f61deb649f6bc3f4cef38c4f35504e51ec112de5c384df7ba0b8d578a4c702b6bf11d5fac00000000";
+   bc_toolbox::transaction tx(bc_toolbox::hex_string_to_vector(raw_tx_string));
+   std::string expected_txid = "4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b";
+   BOOST_CHECK_EQUAL( display_hash(tx.txid()), expected_txid );
+   BOOST_CHECK( tx.wtxid() == tx.txid() );
+   BOOST_CHECK_EQUAL( tx.base_size(), 204 );
+   BOOST_CHECK_EQUAL( tx.total_size(), 204 );
+   BOOST_CHECK_EQUAL( tx.weight(), 816 );
+   // a change invalidates the cache
+   tx.set_locktime(1);
+   BOOST_CHECK( display_hash(tx.txid()) != expected_txid );
+   BOOST_CHECK_EQUAL( tx.total_size(), 204 );
+   // and the reserialized transaction hashes the same as the original bytes
+   tx.set_locktime(0);
+   BOOST_CHECK_EQUAL( display_hash(tx.txid()), expected_txid );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
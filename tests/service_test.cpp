@@ -0,0 +1,69 @@
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <ctime>
+#include <cstdlib>
+
+#include <service.hpp>
+
+BOOST_AUTO_TEST_SUITE( service_test )
+
+const std::string receiver = "02a1633cafcc01ebfb6d78e39f687a1f0995c62fc95f51ead10a02ee0be551b5dc";
+const std::string sender = "03ddfba2a6f8c06d7fb5b1d3d0b2e3a3b0c1d2e3f40516273849506172839405ab";
+const std::string hashlock = "b6a9c8c230722b7c748331a8b450f05566dc7d0f";
+
+BOOST_AUTO_TEST_CASE( operations )
+{
+   bc_toolbox::service svc;
+   BOOST_CHECK_EQUAL( svc.execute("1 hash160 text hello"), "1 ok " + hashlock );
+   BOOST_CHECK_EQUAL( svc.execute("2 hash256 text abc"),
+         "2 ok ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" );
+   BOOST_CHECK_EQUAL( svc.execute("3 hash256 hex 616263"), svc.execute("3 hash256 text abc") );
+   // text runs to the end of the line, spaces and all
+   BOOST_CHECK_EQUAL( svc.execute("3 hash256 text  a b "), svc.execute("3 hash256 hex 2061206220") );
+   BOOST_CHECK_EQUAL( svc.execute("3 hash160 text "), "3 ok b472a266d0bd89c13706a4132ccfb16f7c3b9fcb" );
+   std::string htlc_args = " " + hashlock + " " + receiver + " 600000 " + sender;
+   BOOST_CHECK_EQUAL( svc.execute("4 redeem_script mainnet" + htlc_args), "4 ok "
+         "63a914b6a9c8c230722b7c748331a8b450f05566dc7d0f8876a9144524153c9d4d5fe56aac1c41f6459d363df3777567"
+         "03c02709b17576a914ea9ae2553e8f35ed0c819931318fccf693b92be96888ac" );
+   BOOST_CHECK_EQUAL( svc.execute("5 script_address mainnet" + htlc_args), "5 ok 3DWbjbiYShML4kZoucG25F9W5tCPnBm9rg" );
+
+   std::string timeout = svc.execute("6 timeout 2 hours");
+   BOOST_REQUIRE_EQUAL( timeout.substr(0, 5), "6 ok " );
+   long long expected = (long long)std::time(nullptr) + 2 * 60 * 60;
+   long long actual = std::atoll(timeout.c_str() + 5);
+   BOOST_CHECK( actual <= expected && actual >= expected - 5 );
+}
+
+BOOST_AUTO_TEST_CASE( errors )
+{
+   bc_toolbox::service svc;
+   BOOST_CHECK_EQUAL( svc.execute("7 frobnicate"), "7 error unknown operation frobnicate" );
+   BOOST_CHECK_EQUAL( svc.execute("8 hash160 text"), "8 error expected 2 arguments" );
+   BOOST_CHECK_EQUAL( svc.execute("9 timeout 2 weeks"), "9 error expected minutes, hours or days" );
+   BOOST_CHECK_EQUAL( svc.execute("10 redeem_script mainnet 00 " + receiver + " 10 " + sender),
+         "10 error hashlock must be 20 bytes" );
+}
+
+BOOST_AUTO_TEST_CASE( latencies )
+{
+   bc_toolbox::latency_histogram h;
+   BOOST_CHECK_EQUAL( h.percentile(0.5), 0 );
+   for(int i = 0; i < 90; ++i)
+      h.record(3); // below 4us
+   for(int i = 0; i < 10; ++i)
+      h.record(1000); // below 1024us
+   BOOST_CHECK_EQUAL( h.count(), 100 );
+   BOOST_CHECK_EQUAL( h.percentile(0.5), 4 );
+   BOOST_CHECK_EQUAL( h.percentile(0.9), 4 );
+   BOOST_CHECK_EQUAL( h.percentile(0.99), 1024 );
+
+   bc_toolbox::service svc;
+   svc.execute("1 hash160 text a");
+   svc.execute("2 hash160 text b");
+   BOOST_CHECK_EQUAL( svc.latencies(bc_toolbox::service::op_hash160).count(), 2 );
+   std::string stats = svc.execute("3 stats");
+   BOOST_CHECK_EQUAL( stats.substr(0, 17), "3 ok hash160:n=2," );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
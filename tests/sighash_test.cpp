@@ -0,0 +1,174 @@
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <string>
+
+#include <sighash.hpp>
+#include <hex_conversion.hpp>
+#include <hex.hpp>
+#include <hash.hpp>
+
+using namespace bc_toolbox;
+
+BOOST_AUTO_TEST_SUITE( sighash_test )
+
+namespace {
+
+void append_le(std::vector<uint8_t>& out, uint64_t value, size_t bytes)
+{
+   for(size_t i = 0; i < bytes; ++i)
+      out.push_back((uint8_t)(value >> (8 * i)));
+}
+
+/***
+ * @brief the legacy signature hash, serialized the slow, obvious way
+ * (script_code must not contain OP_CODESEPARATOR)
+ */
+digest256 reference_legacy_hash(const transaction& tx, size_t input_index, const std::vector<uint8_t>& script_code,
+      uint32_t hash_type)
+{
+   const uint32_t base_type = hash_type & 0x1f;
+   const bool anyone_can_pay = (hash_type & SIGHASH_ANYONECANPAY) != 0;
+   std::vector<uint8_t> out;
+   append_le(out, tx.get_version(), 4);
+   out.push_back(anyone_can_pay ? 1 : tx.get_inputs().size());
+   for(size_t i = 0; i < tx.get_inputs().size(); ++i)
+   {
+      if (anyone_can_pay && i != input_index)
+         continue;
+      const input& in = tx.get_inputs()[i];
+      out.insert(out.end(), in.hash.begin(), in.hash.end());
+      append_le(out, in.index, 4);
+      if (i == input_index)
+      {
+         out.push_back(script_code.size());
+         out.insert(out.end(), script_code.begin(), script_code.end());
+      }
+      else
+         out.push_back(0);
+      bool keep = i == input_index || (base_type != SIGHASH_NONE && base_type != SIGHASH_SINGLE);
+      append_le(out, keep ? in.sequence : 0, 4);
+   }
+   size_t count = base_type == SIGHASH_NONE ? 0
+         : base_type == SIGHASH_SINGLE ? input_index + 1 : tx.get_outputs().size();
+   out.push_back(count);
+   for(size_t i = 0; i < count; ++i)
+   {
+      if (base_type == SIGHASH_SINGLE && i != input_index)
+      {
+         append_le(out, 0xffffffffffffffffULL, 8);
+         out.push_back(0);
+         continue;
+      }
+      const output& o = tx.get_outputs()[i];
+      append_le(out, o.value, 8);
+      out.push_back(o.script.size());
+      out.insert(out.end(), o.script.begin(), o.script.end());
+   }
+   append_le(out, tx.get_locktime(), 4);
+   append_le(out, hash_type, 4);
+   digest256 ret_val;
+   sha256d(out, ret_val.data());
+   return ret_val;
+}
+
+transaction test_tx(size_t input_count, size_t output_count)
+{
+   transaction tx;
+   tx.set_version(2);
+   tx.set_locktime(600000);
+   for(size_t i = 0; i < input_count; ++i)
+   {
+      input in;
+      in.hash = std::vector<uint8_t>(32, (uint8_t)(i * 7));
+      in.index = i;
+      in.sequence = 0xfffffff0 - i;
+      tx.edit_inputs().push_back(in);
+   }
+   for(size_t i = 0; i < output_count; ++i)
+   {
+      output out;
+      out.value = 10000 * (i + 1);
+      out.script = std::vector<uint8_t>(i + 1, OP_1);
+      tx.edit_outputs().push_back(out);
+   }
+   return tx;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE( legacy_matches_reference )
+{
+   transaction tx = test_tx(5, 3);
+   sighash_cache cache(tx);
+   std::vector<uint8_t> script_code = from_hex(std::string("76a9141d0f172a0ecb48aee1be1f2687d2963ae33f71a188ac"));
+   const uint32_t types[] = { SIGHASH_ALL, SIGHASH_NONE, SIGHASH_SINGLE,
+         SIGHASH_ALL | SIGHASH_ANYONECANPAY, SIGHASH_NONE | SIGHASH_ANYONECANPAY,
+         SIGHASH_SINGLE | SIGHASH_ANYONECANPAY };
+   for(size_t i = 0; i < 3; ++i)
+      for(uint32_t type : types)
+         BOOST_CHECK( cache.legacy(i, script_code, type) == reference_legacy_hash(tx, i, script_code, type) );
+   // the free function agrees with the cache
+   BOOST_CHECK( legacy_signature_hash(tx, 4, script_code, SIGHASH_ALL)
+         == reference_legacy_hash(tx, 4, script_code, SIGHASH_ALL) );
+   BOOST_CHECK_THROW( cache.legacy(5, script_code, SIGHASH_ALL), std::out_of_range );
+}
+
+BOOST_AUTO_TEST_CASE( legacy_code_separator )
+{
+   transaction tx = test_tx(2, 2);
+   sighash_cache cache(tx);
+   // OP_CODESEPARATORs are left out, but a 0xab byte inside a push is kept
+   std::vector<uint8_t> with = { OP_1, OP_CODESEPARATOR, 0x02, OP_CODESEPARATOR, 0x01, OP_CODESEPARATOR, OP_CHECKSIG };
+   std::vector<uint8_t> without = { OP_1, 0x02, OP_CODESEPARATOR, 0x01, OP_CHECKSIG };
+   BOOST_CHECK( cache.legacy(1, with, SIGHASH_ALL) == reference_legacy_hash(tx, 1, without, SIGHASH_ALL) );
+}
+
+BOOST_AUTO_TEST_CASE( bip143_native_p2wpkh )
+{
+   // the native P2WPKH example from BIP143
+   transaction tx(from_hex(std::string("0100000002fff7f7881a8099afa6940d42d1e7f6362bec38171ea3edf433541db4e4ad969f"
+         "0000000000eeffffffef51e1b804cc89d182d279655c3aa89e815b1b309fe287d9b2b55d57b90ec68a0100000000ffffffff"
+         "02202cb206000000001976a9148280b37df378db99f66f85c95a783a76ac7a6d5988ac9093510d000000001976a9143bde42"
+         "dbee7e4dbe6a21b2d50ce2f0167faa815988ac11000000")));
+   sighash_cache cache(tx);
+   BOOST_CHECK_EQUAL( to_hex(cache.hash_prevouts()), "96b827c8483d4e9b96712b6713a7b68d6e8003a781feba36c31143470b4efd37" );
+   BOOST_CHECK_EQUAL( to_hex(cache.hash_sequence()), "52b0a642eea2fb7ae638c36f6252b6750293dbe574a806984b8e4d8548339a3b" );
+   BOOST_CHECK_EQUAL( to_hex(cache.hash_outputs()), "863ef3e1a92afbfdb97f31ad0fc7683ee943e9abcf2501590ff8f6551f47e5e5" );
+   std::vector<uint8_t> script_code = from_hex(std::string("76a9141d0f172a0ecb48aee1be1f2687d2963ae33f71a188ac"));
+   digest256 hash = cache.segwit_v0(1, script_code, 600000000, SIGHASH_ALL);
+   BOOST_CHECK_EQUAL( to_hex(hash), "c37af31116d1b27caf68aae9e3ac82f1477929014d5b917657d0eb49478cb670" );
+   BOOST_CHECK( segwit_signature_hash(tx, 1, script_code, 600000000, SIGHASH_ALL) == hash );
+}
+
+BOOST_AUTO_TEST_CASE( bip143_hash_types )
+{
+   transaction tx = test_tx(3, 2);
+   sighash_cache cache(tx);
+   std::vector<uint8_t> script_code = { OP_1 };
+   digest256 all = cache.segwit_v0(0, script_code, 1000, SIGHASH_ALL);
+   // ANYONECANPAY does not cover the other inputs
+   digest256 acp = cache.segwit_v0(0, script_code, 1000, SIGHASH_ALL | SIGHASH_ANYONECANPAY);
+   transaction tx2 = tx;
+   tx2.edit_inputs()[2].sequence = 0;
+   sighash_cache changed_input(tx2);
+   BOOST_CHECK( changed_input.segwit_v0(0, script_code, 1000, SIGHASH_ALL) != all );
+   BOOST_CHECK( changed_input.segwit_v0(0, script_code, 1000, SIGHASH_ALL | SIGHASH_ANYONECANPAY) == acp );
+   // SINGLE covers only its own output, and NONE none of them
+   digest256 single = changed_input.segwit_v0(0, script_code, 1000, SIGHASH_SINGLE);
+   digest256 none = changed_input.segwit_v0(0, script_code, 1000, SIGHASH_NONE);
+   transaction tx3 = tx2;
+   tx3.edit_outputs()[1].value += 1;
+   sighash_cache changed_output(tx3);
+   BOOST_CHECK( changed_output.segwit_v0(0, script_code, 1000, SIGHASH_SINGLE) == single );
+   BOOST_CHECK( changed_output.segwit_v0(0, script_code, 1000, SIGHASH_NONE) == none );
+   BOOST_CHECK( changed_output.segwit_v0(1, script_code, 1000, SIGHASH_SINGLE)
+         != changed_input.segwit_v0(1, script_code, 1000, SIGHASH_SINGLE) );
+   // the amount is signed
+   BOOST_CHECK( changed_output.segwit_v0(0, script_code, 1001, SIGHASH_NONE) != none );
+   // SINGLE without a matching output signs a zero hashOutputs, not the legacy "1"
+   BOOST_CHECK( changed_output.segwit_v0(2, script_code, 1000, SIGHASH_SINGLE)
+         != changed_output.legacy(2, script_code, SIGHASH_SINGLE) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,253 @@
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <memory>
+
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+#include <openssl/obj_mac.h>
+
+#include <signature.hpp>
+#include <sighash.hpp>
+#include <hex_conversion.hpp>
+#include <hex.hpp>
+#include <script.hpp>
+#include <hash.hpp>
+
+using namespace bc_toolbox;
+
+BOOST_AUTO_TEST_SUITE( signature_test )
+
+namespace {
+
+/*****
+ * A throwaway secp256k1 key
+ */
+class test_key
+{
+   public:
+      test_key() : key(EC_KEY_new_by_curve_name(NID_secp256k1), EC_KEY_free)
+      {
+         EC_KEY_generate_key(key.get());
+         EC_KEY_set_conv_form(key.get(), POINT_CONVERSION_COMPRESSED);
+         pubkey.resize(33);
+         EC_POINT_point2oct(EC_KEY_get0_group(key.get()), EC_KEY_get0_public_key(key.get()),
+               POINT_CONVERSION_COMPRESSED, pubkey.data(), pubkey.size(), nullptr);
+      }
+      /***
+       * @returns a DER signature of hash, followed by the hash type
+       */
+      std::vector<uint8_t> sign(const digest256& hash, uint8_t hash_type) const
+      {
+         ECDSA_SIG* sig = ECDSA_do_sign(hash.data(), hash.size(), key.get());
+         std::vector<uint8_t> ret_val(i2d_ECDSA_SIG(sig, nullptr));
+         uint8_t* pos = ret_val.data();
+         i2d_ECDSA_SIG(sig, &pos);
+         ECDSA_SIG_free(sig);
+         ret_val.push_back(hash_type);
+         return ret_val;
+      }
+      std::vector<uint8_t> pubkey;
+   private:
+      std::unique_ptr<EC_KEY, void(*)(EC_KEY*)> key;
+};
+
+std::vector<uint8_t> p2pkh_script(const std::vector<uint8_t>& pubkey)
+{
+   digest160 pubkey_hash = hash160(pubkey);
+   script s;
+   s.add_opcode(OP_DUP);
+   s.add_opcode(OP_HASH160);
+   s.add_bytes_with_size(std::vector<uint8_t>(pubkey_hash.begin(), pubkey_hash.end()));
+   s.add_opcode(OP_EQUALVERIFY);
+   s.add_opcode(OP_CHECKSIG);
+   return s.bytes().to_vector();
+}
+
+transaction spending_tx(size_t input_count, size_t output_count)
+{
+   transaction tx;
+   for(size_t i = 0; i < input_count; ++i)
+   {
+      input in;
+      in.hash = std::vector<uint8_t>(32, (uint8_t)i);
+      in.index = i;
+      in.sequence = 0xffffffff;
+      tx.edit_inputs().push_back(in);
+   }
+   for(size_t i = 0; i < output_count; ++i)
+   {
+      output out;
+      out.value = 1000 * (i + 1);
+      out.script = { OP_1 };
+      tx.edit_outputs().push_back(out);
+   }
+   return tx;
+}
+
+/***
+ * @brief sign input i of tx as a P2PKH spend of key
+ */
+void sign_p2pkh(transaction& tx, size_t i, const test_key& key, const std::vector<uint8_t>& script_pubkey,
+      uint8_t hash_type = SIGHASH_ALL)
+{
+   std::vector<uint8_t> sig = key.sign(legacy_signature_hash(tx, i, script_pubkey, hash_type), hash_type);
+   script script_sig;
+   script_sig.add_bytes_with_size(sig);
+   script_sig.add_bytes_with_size(key.pubkey);
+   tx.edit_inputs()[i].sig_script = script_sig.bytes().to_vector();
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE( der_parsing )
+{
+   ecdsa_signature sig;
+   // minimal: r = 1, s = 1
+   BOOST_CHECK( sig.parse_der(from_hex(std::string("3006020101020101"))) );
+   BOOST_CHECK( sig.r[31] == 1 && sig.s[31] == 1 && sig.r[0] == 0 );
+   // a leading zero is needed when the high bit is set
+   BOOST_CHECK( sig.parse_der(from_hex(std::string("300702020080020101"))) );
+   BOOST_CHECK( sig.r[31] == 0x80 );
+   // negative r
+   BOOST_CHECK( !sig.parse_der(from_hex(std::string("3006020180020101"))) );
+   // unneeded leading zero
+   BOOST_CHECK( !sig.parse_der(from_hex(std::string("300702020001020101"))) );
+   // wrong total length
+   BOOST_CHECK( !sig.parse_der(from_hex(std::string("3007020101020101"))) );
+   // not a sequence
+   BOOST_CHECK( !sig.parse_der(from_hex(std::string("3106020101020101"))) );
+   // trailing byte
+   BOOST_CHECK( !sig.parse_der(from_hex(std::string("300602010102010100"))) );
+}
+
+BOOST_AUTO_TEST_CASE( p2pkh_inputs )
+{
+   test_key key;
+   std::vector<uint8_t> script_pubkey = p2pkh_script(key.pubkey);
+   const size_t count = 10;
+   transaction tx = spending_tx(count, 2);
+   for(size_t i = 0; i < count; ++i)
+      sign_p2pkh(tx, i, key, script_pubkey);
+   std::vector<spent_output> spent(count, spent_output{ 5000, script_pubkey });
+
+   thread_pool pool(2);
+   std::vector<script_error> results = verify_inputs(tx, spent, pool);
+   BOOST_REQUIRE_EQUAL( results.size(), count );
+   for(auto result : results)
+      BOOST_CHECK( result == script_error::ok );
+
+   // break one signature: the others are still good
+   std::vector<uint8_t>& sig_script = tx.edit_inputs()[3].sig_script;
+   sig_script[10] ^= 1;
+   results = verify_inputs(tx, spent, pool);
+   for(size_t i = 0; i < count; ++i)
+      BOOST_CHECK( results[i] == (i == 3 ? script_error::eval_false : script_error::ok) );
+
+   // signing one input does not sign another
+   tx.edit_inputs()[3].sig_script = tx.get_inputs()[4].sig_script;
+   BOOST_CHECK( verify_input(tx, 3, spent[3]) == script_error::eval_false );
+
+   // changing an output invalidates SIGHASH_ALL signatures
+   tx.edit_outputs()[1].value += 1;
+   BOOST_CHECK( verify_input(tx, 0, spent[0]) == script_error::eval_false );
+
+   BOOST_CHECK_THROW( verify_inputs(tx, span<const spent_output>(spent.data(), 2), pool), std::invalid_argument );
+}
+
+BOOST_AUTO_TEST_CASE( hash_types )
+{
+   test_key key;
+   std::vector<uint8_t> script_pubkey = p2pkh_script(key.pubkey);
+   spent_output spent{ 5000, script_pubkey };
+   transaction tx = spending_tx(3, 2);
+   sign_p2pkh(tx, 0, key, script_pubkey, SIGHASH_NONE);
+   sign_p2pkh(tx, 1, key, script_pubkey, SIGHASH_SINGLE | SIGHASH_ANYONECANPAY);
+   // no output 2, so this signs the hash 1
+   sign_p2pkh(tx, 2, key, script_pubkey, SIGHASH_SINGLE);
+   digest256 one = legacy_signature_hash(tx, 2, script_pubkey, SIGHASH_SINGLE);
+   BOOST_CHECK_EQUAL( to_hex(one), "0100000000000000000000000000000000000000000000000000000000000000" );
+   for(size_t i = 0; i < 3; ++i)
+      BOOST_CHECK( verify_input(tx, i, spent) == script_error::ok );
+
+   // SIGHASH_NONE does not cover outputs, SIGHASH_SINGLE only its own
+   tx.edit_outputs()[0].value += 1;
+   BOOST_CHECK( verify_input(tx, 0, spent) == script_error::ok );
+   BOOST_CHECK( verify_input(tx, 1, spent) == script_error::ok );
+   tx.edit_outputs()[1].value += 1;
+   BOOST_CHECK( verify_input(tx, 1, spent) == script_error::eval_false );
+
+   BOOST_CHECK_THROW( legacy_signature_hash(tx, 3, script_pubkey, SIGHASH_ALL), std::out_of_range );
+}
+
+BOOST_AUTO_TEST_CASE( witness_outputs )
+{
+   test_key key;
+   digest160 pubkey_hash = hash160(key.pubkey);
+   std::vector<uint8_t> p2wpkh = { OP_0, 20 };
+   p2wpkh.insert(p2wpkh.end(), pubkey_hash.begin(), pubkey_hash.end());
+   // P2WSH of <pubkey> OP_CHECKSIG
+   std::vector<uint8_t> witness_script = { 33 };
+   witness_script.insert(witness_script.end(), key.pubkey.begin(), key.pubkey.end());
+   witness_script.push_back(OP_CHECKSIG);
+   digest256 script_hash;
+   sha256(witness_script, script_hash.data());
+   std::vector<uint8_t> p2wsh = { OP_0, 32 };
+   p2wsh.insert(p2wsh.end(), script_hash.begin(), script_hash.end());
+   // P2SH-P2WPKH
+   script redeem;
+   redeem.add_bytes(p2wpkh);
+   std::vector<uint8_t> p2sh = redeem.p2sh_script();
+   std::vector<uint8_t> p2sh_script_sig = { 22 };
+   p2sh_script_sig.insert(p2sh_script_sig.end(), p2wpkh.begin(), p2wpkh.end());
+
+   std::vector<spent_output> spent = { { 5000, p2wpkh }, { 6000, p2wsh }, { 7000, p2sh } };
+   transaction tx = spending_tx(3, 1);
+   tx.set_flag(1);
+   tx.edit_inputs()[2].sig_script = p2sh_script_sig;
+   std::vector<uint8_t> p2pkh_code = p2pkh_script(key.pubkey);
+   std::vector<std::vector<uint8_t> > signatures;
+   {
+      sighash_cache hashes(tx);
+      signatures.push_back(key.sign(hashes.segwit_v0(0, p2pkh_code, 5000, SIGHASH_ALL), SIGHASH_ALL));
+      signatures.push_back(key.sign(hashes.segwit_v0(1, witness_script, 6000, SIGHASH_ALL), SIGHASH_ALL));
+      signatures.push_back(key.sign(hashes.segwit_v0(2, p2pkh_code, 7000, SIGHASH_ALL), SIGHASH_ALL));
+   }
+   witness_stacks& witnesses = tx.edit_witnesses();
+   witnesses.add_stack();
+   witnesses.add_item(signatures[0]);
+   witnesses.add_item(key.pubkey);
+   witnesses.add_stack();
+   witnesses.add_item(signatures[1]);
+   witnesses.add_item(witness_script);
+   witnesses.add_stack();
+   witnesses.add_item(signatures[2]);
+   witnesses.add_item(key.pubkey);
+
+   thread_pool pool(2);
+   std::vector<script_error> results = verify_inputs(tx, spent, pool);
+   for(auto result : results)
+      BOOST_CHECK( result == script_error::ok );
+   // the amount is signed
+   spent[0].amount += 1;
+   BOOST_CHECK( verify_input(tx, 0, spent[0]) == script_error::eval_false );
+   spent[0].amount -= 1;
+   // a witness script that does not match the program
+   spent[1].script_pubkey[5] ^= 1;
+   BOOST_CHECK( verify_input(tx, 1, spent[1]) == script_error::witness_program_mismatch );
+   // native witness spends must have an empty scriptSig
+   tx.edit_inputs()[0].sig_script = { OP_1 };
+   BOOST_CHECK( verify_input(tx, 0, spent[0]) == script_error::witness_malleated );
+   // later witness versions cannot be checked
+   std::vector<uint8_t> taproot(34, 0);
+   taproot[0] = OP_1;
+   taproot[1] = 32;
+   BOOST_CHECK( verify_input(tx, 2, spent_output{ 7000, taproot }) == script_error::witness_malleated );
+   tx.edit_inputs()[0].sig_script.clear();
+   BOOST_CHECK( verify_input(tx, 0, spent_output{ 5000, taproot }) == script_error::unsupported_witness );
+   // witness data where none is expected
+   BOOST_CHECK( verify_input(tx, 0, spent_output{ 5000, { OP_1 } }) == script_error::witness_unexpected );
+   BOOST_CHECK( verify_input(tx, 0, spent_output{ 5000, { OP_1 } }, verify_p2sh) == script_error::ok );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
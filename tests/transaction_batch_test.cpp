@@ -0,0 +1,95 @@
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+
+#include <hex_conversion.hpp>
+#include <transaction.hpp>
+#include <transaction_batch.hpp>
+
+BOOST_AUTO_TEST_SUITE( transaction_batch_test )
+
+namespace {
+
+const std::string legacy_tx = "0200000001284f2c75c4ff937f83f48b16f56b2f9049fe101a2341e219e7996cd1f28eb54d01000000af4cad63a914d31466ed1232e9e156c859e74911489cc7d430df8876a9423032613637623661306262336532373234353832633333313666313337393832623066643163643766613737386334396431343238646134626234376438333935376704bc7aa55cb17576a9423032613637623661306262336532373234353832633333313666313337393832623066643163643766613737386334396431343238646134626234376438333935376888acffffffff01a0bb0d000000000017a9141911177214bca4efb78eaf27f3cbc5d3ded12a5a8700000000";
+const std::string segwit_tx = "0200000000010111b6e0460bb810b05744f8d38262f95fbab02b168b070598a6f31fad438fced4000000001716001427c106013c0042da165c082b3870c31fb3ab4683feffffff0200ca9a3b0000000017a914d8b6fcc85a383261df05423ddf068a8987bf0287873067a3fa0100000017a914d5df0b9ca6c0e1ba60a9ff29359d2600d9c6659d870247304402203b85cb05b43cc68df72e2e54c6cb508aa324a5de0c53f1bbfe997cbd7509774d022041e1b1823bdaddcd6581d7cde6e6a4c4dbef483e42e59e04dbacbaf537c3e3e8012103fbbdb3b3fc3abbbd983b20a557445fb041d6f21cc5977d2121971cb1ce5298978c000000";
+
+bool same(bc_toolbox::byte_span a, const std::vector<uint8_t>& b)
+{
+   return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE( columns_match_transactions )
+{
+   std::vector<uint8_t> legacy = bc_toolbox::hex_string_to_vector(legacy_tx);
+   std::vector<uint8_t> segwit = bc_toolbox::hex_string_to_vector(segwit_tx);
+   // laid end to end, as in a block
+   std::vector<uint8_t> both(legacy);
+   both.insert(both.end(), segwit.begin(), segwit.end());
+   bc_toolbox::transaction_batch batch;
+   batch.reserve(2, 2, 3, 2, both.size());
+   BOOST_CHECK_EQUAL( batch.add_all(both), 2 );
+   BOOST_CHECK_EQUAL( batch.size(), 2 );
+   BOOST_CHECK_EQUAL( batch.input_count(), 2 );
+   BOOST_CHECK_EQUAL( batch.output_count(), 3 );
+   BOOST_CHECK( !batch.has_witness(0) );
+   BOOST_CHECK( batch.has_witness(1) );
+
+   bc_toolbox::transaction txs[] = { bc_toolbox::transaction(legacy), bc_toolbox::transaction(segwit) };
+   for(size_t t = 0; t < 2; ++t)
+   {
+      const bc_toolbox::transaction& tx = txs[t];
+      BOOST_CHECK_EQUAL( batch.get_versions()[t], tx.get_version() );
+      BOOST_CHECK_EQUAL( batch.get_locktimes()[t], tx.get_locktime() );
+      BOOST_REQUIRE_EQUAL( batch.input_end(t) - batch.input_begin(t), tx.get_inputs().size() );
+      BOOST_REQUIRE_EQUAL( batch.output_end(t) - batch.output_begin(t), tx.get_outputs().size() );
+      for(size_t i = 0; i < tx.get_inputs().size(); ++i)
+      {
+         const bc_toolbox::input& in = tx.get_inputs()[i];
+         size_t pos = batch.input_begin(t) + i;
+         BOOST_CHECK( same(batch.prev_hash(pos), in.hash) );
+         BOOST_CHECK_EQUAL( batch.get_prev_indexes()[pos], in.index );
+         BOOST_CHECK_EQUAL( batch.get_sequences()[pos], in.sequence );
+         BOOST_CHECK( same(batch.input_script(pos), in.sig_script) );
+         BOOST_REQUIRE_EQUAL( batch.witness_item_count(pos), tx.get_witnesses().item_count(i) );
+         for(size_t j = 0; j < batch.witness_item_count(pos); ++j)
+            BOOST_CHECK( same(batch.witness_item(pos, j), tx.get_witnesses().item(i, j).to_vector()) );
+      }
+      uint64_t value = 0;
+      for(size_t i = 0; i < tx.get_outputs().size(); ++i)
+      {
+         const bc_toolbox::output& out = tx.get_outputs()[i];
+         size_t pos = batch.output_begin(t) + i;
+         BOOST_CHECK_EQUAL( batch.get_values()[pos], out.value );
+         BOOST_CHECK( same(batch.output_script(pos), out.script) );
+         value += out.value;
+      }
+      BOOST_CHECK_EQUAL( batch.output_value(t), value );
+   }
+   BOOST_CHECK_EQUAL( batch.total_value(), 900000ULL + 1000000000ULL + 8499980080ULL );
+   BOOST_CHECK_THROW( batch.witness_item(1, 2), std::out_of_range );
+   BOOST_CHECK_THROW( batch.witness_item(0, 0), std::out_of_range );
+
+   batch.clear();
+   BOOST_CHECK( batch.empty() );
+   BOOST_CHECK_EQUAL( batch.total_value(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( bad_transactions )
+{
+   std::vector<uint8_t> segwit = bc_toolbox::hex_string_to_vector(segwit_tx);
+   bc_toolbox::transaction_batch batch;
+   BOOST_CHECK_EQUAL( batch.add(segwit), segwit.size() );
+   // a truncated transaction leaves the batch as it was
+   std::vector<uint8_t> truncated(segwit.begin(), segwit.end() - 10);
+   BOOST_CHECK_THROW( batch.add(truncated), std::out_of_range );
+   BOOST_CHECK_EQUAL( batch.size(), 1 );
+   BOOST_CHECK_EQUAL( batch.input_count(), 1 );
+   BOOST_CHECK_EQUAL( batch.output_count(), 2 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
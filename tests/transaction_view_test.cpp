@@ -0,0 +1,132 @@
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <stdexcept>
+
+#include <hex_conversion.hpp>
+#include <transaction_view.hpp>
+#include <transaction.hpp>
+
+BOOST_AUTO_TEST_SUITE( transaction_view_test )
+
+BOOST_AUTO_TEST_CASE( legacy_view )
+{
+   std::string raw_tx_string = "0200000001284f2c75c4ff937f83f48b16f56b2f9049fe101a2341e219e7996cd1f28eb54d01000000af4cad63a914d31466ed1232e9e156c859e74911489cc7d430df8876a9423032613637623661306262336532373234353832633333313666313337393832623066643163643766613737386334396431343238646134626234376438333935376704bc7aa55cb17576a9423032613637623661306262336532373234353832633333313666313337393832623066643163643766613737386334396431343238646134626234376438333935376888acffffffff01a0bb0d000000000017a9141911177214bca4efb78eaf27f3cbc5d3ded12a5a8700000000";
+   std::vector<uint8_t> bytes = bc_toolbox::hex_string_to_vector(raw_tx_string);
+   bc_toolbox::transaction_view tx(bytes);
+   BOOST_CHECK_EQUAL( tx.version(), 2 );
+   BOOST_CHECK( !tx.has_witness() );
+   BOOST_CHECK_EQUAL( tx.size(), bytes.size() );
+   BOOST_CHECK_EQUAL( tx.locktime(), 0 );
+   BOOST_CHECK_EQUAL( tx.input_count(), 1 );
+   BOOST_CHECK_EQUAL( tx.output_count(), 1 );
+
+   bc_toolbox::input_view in = tx.input(0);
+   BOOST_CHECK_EQUAL( in.prev_hash()[0], 0x28 );
+   BOOST_CHECK_EQUAL( in.prev_hash()[31], 0x4d );
+   BOOST_CHECK_EQUAL( in.index(), 1 );
+   BOOST_CHECK_EQUAL( in.script().size(), 0xaf );
+   BOOST_CHECK_EQUAL( in.script()[0], 0x4c );
+   BOOST_CHECK_EQUAL( in.sequence(), 0xffffffff );
+
+   size_t count = 0;
+   for(auto out : tx.outputs())
+   {
+      BOOST_CHECK_EQUAL( out.value(), 900000 );
+      BOOST_CHECK_EQUAL( out.script().size(), 23 );
+      BOOST_CHECK_EQUAL( out.script()[0], 0xa9 );
+      ++count;
+   }
+   BOOST_CHECK_EQUAL( count, 1 );
+   BOOST_CHECK( tx.witness(0).empty() );
+   // past the end of a range
+   BOOST_CHECK_THROW( tx.input(1), std::out_of_range );
+   BOOST_CHECK_THROW( tx.output(1), std::out_of_range );
+   BOOST_CHECK_THROW( tx.outputs()[1], std::out_of_range );
+}
+
+BOOST_AUTO_TEST_CASE( segwit_view )
+{
+   std::string raw_tx_string = "0200000000010111b6e0460bb810b05744f8d38262f95fbab02b168b070598a6f31fad438fced4000000001716001427c106013c0042da165c082b3870c31fb3ab4683feffffff0200ca9a3b0000000017a914d8b6fcc85a383261df05423ddf068a8987bf0287873067a3fa0100000017a914d5df0b9ca6c0e1ba60a9ff29359d2600d9c6659d870247304402203b85cb05b43cc68df72e2e54c6cb508aa324a5de0c53f1bbfe997cbd7509774d022041e1b1823bdaddcd6581d7cde6e6a4c4dbef483e42e59e04dbacbaf537c3e3e8012103fbbdb3b3fc3abbbd983b20a557445fb041d6f21cc5977d2121971cb1ce5298978c000000";
+   std::vector<uint8_t> bytes = bc_toolbox::hex_string_to_vector(raw_tx_string);
+   // trailing bytes belong to whatever follows the transaction
+   std::vector<uint8_t> padded(bytes);
+   padded.push_back(0xde);
+   padded.push_back(0xad);
+   bc_toolbox::transaction_view tx(padded);
+   BOOST_CHECK( tx.has_witness() );
+   BOOST_CHECK_EQUAL( tx.size(), bytes.size() );
+   BOOST_CHECK_EQUAL( tx.locktime(), 140 );
+   BOOST_CHECK_EQUAL( tx.input(0).sequence(), 0xfffffffe );
+   BOOST_CHECK_EQUAL( tx.input(0).script().size(), 23 );
+
+   std::vector<uint64_t> values;
+   for(auto out : tx.outputs())
+      values.push_back(out.value());
+   BOOST_CHECK_EQUAL( values.size(), 2 );
+   BOOST_CHECK_EQUAL( values[0], 1000000000 );
+   BOOST_CHECK_EQUAL( values[1], 8499980080 );
+
+   bc_toolbox::witness_view wit = tx.witness(0);
+   BOOST_CHECK_EQUAL( wit.size(), 2 );
+   BOOST_CHECK_EQUAL( wit[0].data().size(), 71 );
+   BOOST_CHECK_EQUAL( wit[0].data()[70], 0x01 );
+   BOOST_CHECK_EQUAL( wit[1].data().size(), 33 );
+   BOOST_CHECK_EQUAL( wit[1].data()[0], 0x03 );
+   BOOST_CHECK_THROW( wit[2], std::out_of_range );
+   BOOST_CHECK_THROW( tx.witness(1), std::out_of_range );
+}
+
+BOOST_AUTO_TEST_CASE( truncated_view )
+{
+   std::vector<uint8_t> bytes = bc_toolbox::hex_string_to_vector("0200000001284f2c75c4ff937f");
+   BOOST_CHECK_THROW( bc_toolbox::transaction_view tx(bytes), std::out_of_range );
+   // a script length that runs past the end of the buffer
+   bytes = bc_toolbox::hex_string_to_vector(
+         "0100000001000000000000000000000000000000000000000000000000000000000000000000000000fdffff");
+   BOOST_CHECK_THROW( bc_toolbox::transaction_view tx(bytes), std::out_of_range );
+}
+
+BOOST_AUTO_TEST_CASE( scan )
+{
+   std::vector<uint8_t> legacy = bc_toolbox::hex_string_to_vector("0100000001000000000000000000000000000000000000000000000000000000000000000000000000016affffffff0100e1f50500000000015100000000");
+   std::vector<uint8_t> segwit = bc_toolbox::hex_string_to_vector("0200000000010111b6e0460bb810b05744f8d38262f95fbab02b168b070598a6f31fad438fced4000000001716001427c106013c0042da165c082b3870c31fb3ab4683feffffff0200ca9a3b0000000017a914d8b6fcc85a383261df05423ddf068a8987bf0287873067a3fa0100000017a914d5df0b9ca6c0e1ba60a9ff29359d2600d9c6659d870247304402203b85cb05b43cc68df72e2e54c6cb508aa324a5de0c53f1bbfe997cbd7509774d022041e1b1823bdaddcd6581d7cde6e6a4c4dbef483e42e59e04dbacbaf537c3e3e8012103fbbdb3b3fc3abbbd983b20a557445fb041d6f21cc5977d2121971cb1ce5298978c000000");
+   std::vector<uint8_t> both(legacy);
+   both.insert(both.end(), segwit.begin(), segwit.end());
+   std::vector<bc_toolbox::transaction_bounds> found;
+   size_t consumed = 0;
+   BOOST_CHECK( bc_toolbox::scan_transactions(both, found, consumed) == bc_toolbox::scan_error::ok );
+   BOOST_CHECK_EQUAL( consumed, both.size() );
+   BOOST_REQUIRE_EQUAL( found.size(), 2 );
+   BOOST_CHECK_EQUAL( found[0].offset, 0 );
+   BOOST_CHECK_EQUAL( found[0].length, legacy.size() );
+   BOOST_CHECK( !found[0].segwit );
+   BOOST_CHECK_EQUAL( found[1].offset, legacy.size() );
+   BOOST_CHECK_EQUAL( found[1].length, segwit.size() );
+   BOOST_CHECK( found[1].segwit );
+
+   // a truncated last transaction: the first is still found
+   both.pop_back();
+   found.clear();
+   BOOST_CHECK( bc_toolbox::scan_transactions(both, found, consumed) == bc_toolbox::scan_error::truncated );
+   BOOST_CHECK_EQUAL( found.size(), 1 );
+   BOOST_CHECK_EQUAL( consumed, legacy.size() );
+   // and the full parser refuses it, rather than reading past the end
+   BOOST_CHECK_THROW( bc_toolbox::transaction(bc_toolbox::byte_span(both).subspan(consumed)), std::out_of_range );
+
+   // a hostile input count is rejected without walking it
+   std::vector<uint8_t> bytes = bc_toolbox::hex_string_to_vector("01000000ffffffffffffffff7f0000");
+   bc_toolbox::transaction_bounds bounds;
+   BOOST_CHECK( bc_toolbox::scan_transaction(bytes, bounds) == bc_toolbox::scan_error::truncated );
+   // an unknown flag, and a length that is not minimally encoded
+   bytes = bc_toolbox::hex_string_to_vector("010000000002");
+   BOOST_CHECK( bc_toolbox::scan_transaction(bytes, bounds) == bc_toolbox::scan_error::unknown_flag );
+   BOOST_CHECK_THROW( bc_toolbox::transaction_view tx(bytes), std::invalid_argument );
+   bytes = legacy;
+   bytes[41] = 0xfd;
+   bytes.insert(bytes.begin() + 42, { 0x01, 0x00 });
+   BOOST_CHECK( bc_toolbox::scan_transaction(bytes, bounds) == bc_toolbox::scan_error::non_canonical );
+   BOOST_CHECK_EQUAL( bc_toolbox::scan_error_string(bc_toolbox::scan_error::non_canonical), "non-canonical varint" );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,222 @@
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <string>
+#include <map>
+#include <fstream>
+#include <cstdio>
+#include <stdexcept>
+
+#include <utxo_set.hpp>
+#include <hex_conversion.hpp>
+#include <hex.hpp>
+
+using namespace bc_toolbox;
+
+BOOST_AUTO_TEST_SUITE( utxo_set_test )
+
+namespace {
+
+transaction coinbase(uint32_t height, const std::vector<std::vector<uint8_t> >& scripts)
+{
+   transaction tx;
+   input in;
+   in.hash = std::vector<uint8_t>(32, 0);
+   in.index = 0xffffffff;
+   in.sig_script = little_endian(height, 4);
+   in.sequence = 0xffffffff;
+   tx.edit_inputs().push_back(in);
+   for(size_t i = 0; i < scripts.size(); ++i)
+   {
+      output out;
+      out.value = 5000000000ULL + i;
+      out.script = scripts[i];
+      tx.edit_outputs().push_back(out);
+   }
+   return tx;
+}
+
+transaction spend(const transaction& prev, std::vector<uint32_t> indexes, uint64_t value, const std::vector<uint8_t>& script)
+{
+   transaction tx;
+   for(uint32_t index : indexes)
+   {
+      input in;
+      in.hash.assign(prev.txid().begin(), prev.txid().end());
+      in.index = index;
+      in.sequence = 0xffffffff;
+      tx.edit_inputs().push_back(in);
+   }
+   output out;
+   out.value = value;
+   out.script = script;
+   tx.edit_outputs().push_back(out);
+   return tx;
+}
+
+std::vector<std::vector<uint8_t> > test_scripts()
+{
+   std::vector<std::vector<uint8_t> > ret_val;
+   ret_val.push_back(from_hex(std::string("76a9141d0f172a0ecb48aee1be1f2687d2963ae33f71a188ac"))); // P2PKH
+   ret_val.push_back(from_hex(std::string("a914d8b6fcc85a383261df05423ddf068a8987bf028787"))); // P2SH
+   ret_val.push_back(from_hex(std::string("2103fbbdb3b3fc3abbbd983b20a557445fb041d6f21cc5977d2121971cb1ce529897ac"))); // P2PK
+   ret_val.push_back(from_hex(std::string("00141d0f172a0ecb48aee1be1f2687d2963ae33f71a1"))); // P2WPKH
+   ret_val.push_back(from_hex(std::string("0020701a8d401c84fb13e6baf169d59684e17abd9fa216c8cc5b9fc63d622ff8c58d"))); // P2WSH
+   ret_val.push_back(from_hex(std::string("5120a60869f0dbcf1dc659c9cecbaf8050135ea9e8cdc487053f1dc6880949dc684c"))); // P2TR
+   ret_val.push_back(from_hex(std::string("5121030000000000000000000000000000000000000000000000000000000000000001"
+         "2103fbbdb3b3fc3abbbd983b20a557445fb041d6f21cc5977d2121971cb1ce52989752ae"))); // bare multisig
+   ret_val.push_back(std::vector<uint8_t>()); // empty
+   ret_val.push_back({ OP_RETURN, 0x01, 0x02 }); // unspendable
+   return ret_val;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE( amounts )
+{
+   BOOST_CHECK_EQUAL( compress_amount(0), 0U );
+   BOOST_CHECK_EQUAL( compress_amount(1), 1U );
+   BOOST_CHECK_EQUAL( compress_amount(100000000), 9U );
+   BOOST_CHECK_EQUAL( compress_amount(5000000000ULL), 50U );
+   BOOST_CHECK_EQUAL( compress_amount(2100000000000000ULL), 0x1406f40U );
+   const uint64_t amounts[] = { 0, 1, 9, 10, 99, 546, 1000, 123456789, 100000000, 2100000000000000ULL,
+         2099999997690000ULL, 0xffffffffffffffffULL / 100 };
+   for(uint64_t amount : amounts)
+      BOOST_CHECK_EQUAL( decompress_amount(compress_amount(amount)), amount );
+}
+
+BOOST_AUTO_TEST_CASE( apply_and_find )
+{
+   std::vector<std::vector<uint8_t> > scripts = test_scripts();
+   transaction cb = coinbase(100, scripts);
+   utxo_set set;
+   BOOST_CHECK_EQUAL( set.apply(cb, 100), 0U );
+   // the OP_RETURN output is left out
+   BOOST_CHECK_EQUAL( set.size(), scripts.size() - 1 );
+   for(size_t i = 0; i < scripts.size(); ++i)
+   {
+      prevout p;
+      bool found = set.find(outpoint(cb.txid(), i), p);
+      BOOST_CHECK_EQUAL( found, i != scripts.size() - 1 );
+      BOOST_CHECK_EQUAL( p.found, found );
+      if (!found)
+         continue;
+      BOOST_CHECK_EQUAL( p.amount, 5000000000ULL + i );
+      BOOST_CHECK_EQUAL( to_hex(p.script), to_hex(scripts[i]) );
+      BOOST_CHECK_EQUAL( p.height, 100U );
+      BOOST_CHECK( p.coinbase );
+   }
+
+   // spend two outputs, and one that does not exist
+   transaction tx = spend(cb, { 0, 3, 50 }, 1000, scripts[4]);
+   std::vector<prevout> prev = set.prevouts(tx);
+   BOOST_REQUIRE_EQUAL( prev.size(), 3U );
+   BOOST_CHECK( prev[0].found && prev[1].found && !prev[2].found );
+   BOOST_CHECK_EQUAL( prev[0].amount + prev[1].amount - 1000, 10000000003ULL - 1000 );
+   BOOST_CHECK_EQUAL( set.apply(tx, 101), 1U );
+   BOOST_CHECK_EQUAL( set.size(), scripts.size() - 1 - 2 + 1 );
+   prevout p;
+   BOOST_CHECK( !set.find(outpoint(cb.txid(), 0), p) );
+   BOOST_CHECK( set.find(outpoint(tx.txid(), 0), p) );
+   BOOST_CHECK_EQUAL( p.height, 101U );
+   BOOST_CHECK( !p.coinbase );
+   // spending returns what was spent
+   BOOST_CHECK( set.spend(outpoint(cb.txid(), 1), &p) );
+   BOOST_CHECK_EQUAL( to_hex(p.script), to_hex(scripts[1]) );
+   BOOST_CHECK( !set.spend(outpoint(cb.txid(), 1)) );
+   BOOST_CHECK_THROW( outpoint(std::vector<uint8_t>(31, 0), 0), std::invalid_argument );
+}
+
+BOOST_AUTO_TEST_CASE( many_entries )
+{
+   // enough to grow the table several times, and to compact the arena
+   utxo_set set;
+   std::map<std::vector<uint8_t>, uint64_t> reference;
+   std::vector<outpoint> points;
+   std::vector<uint8_t> script = from_hex(std::string("00141d0f172a0ecb48aee1be1f2687d2963ae33f71a1"));
+   for(uint32_t i = 0; i < 20000; ++i)
+   {
+      std::vector<uint8_t> txid(32, 0);
+      txid[i % 32] = i;
+      txid[(i / 32) % 32] ^= i >> 8;
+      outpoint point(txid, i % 7);
+      script[2 + i % 20] = i;
+      set.add(point, i * 1000, script, i, false);
+      reference[std::vector<uint8_t>(point.bytes.begin(), point.bytes.end())] = i * 1000;
+      points.push_back(point);
+   }
+   BOOST_CHECK_EQUAL( set.size(), reference.size() );
+   // spend three in four
+   for(size_t i = 0; i < points.size(); ++i)
+   {
+      if (i % 4 == 0)
+         continue;
+      auto itr = reference.find(std::vector<uint8_t>(points[i].bytes.begin(), points[i].bytes.end()));
+      BOOST_CHECK_EQUAL( set.spend(points[i]), itr != reference.end() );
+      if (itr != reference.end())
+         reference.erase(itr);
+   }
+   BOOST_CHECK_EQUAL( set.size(), reference.size() );
+
+   std::vector<prevout> results;
+   size_t found = set.find(span<const outpoint>(points.data(), points.size()), results);
+   thread_pool pool(4);
+   std::vector<prevout> threaded;
+   BOOST_CHECK_EQUAL( set.find(span<const outpoint>(points.data(), points.size()), threaded, pool), found );
+   size_t mismatches = 0;
+   size_t expected_found = 0;
+   for(size_t i = 0; i < points.size(); ++i)
+   {
+      auto itr = reference.find(std::vector<uint8_t>(points[i].bytes.begin(), points[i].bytes.end()));
+      bool expected = itr != reference.end();
+      if (expected)
+         ++expected_found;
+      if (results[i].found != expected || threaded[i].found != expected
+            || (expected && (results[i].amount != itr->second || threaded[i].amount != itr->second)))
+         ++mismatches;
+   }
+   BOOST_CHECK_EQUAL( mismatches, 0U );
+   BOOST_CHECK_EQUAL( found, expected_found );
+}
+
+BOOST_AUTO_TEST_CASE( snapshot )
+{
+   std::vector<std::vector<uint8_t> > scripts = test_scripts();
+   transaction cb = coinbase(7, scripts);
+   utxo_set set;
+   set.apply(cb, 7);
+   set.apply(spend(cb, { 2 }, 12345, scripts[6]), 8);
+   std::string filename = "utxo_set_test.dat";
+   set.save(filename);
+
+   utxo_set loaded;
+   loaded.load(filename);
+   BOOST_CHECK_EQUAL( loaded.size(), set.size() );
+   for(size_t i = 0; i < scripts.size(); ++i)
+   {
+      prevout expected;
+      prevout actual;
+      BOOST_CHECK_EQUAL( set.find(outpoint(cb.txid(), i), expected), loaded.find(outpoint(cb.txid(), i), actual) );
+      BOOST_CHECK_EQUAL( expected.amount, actual.amount );
+      BOOST_CHECK( expected.script == actual.script );
+      BOOST_CHECK_EQUAL( expected.height, actual.height );
+   }
+
+   // a damaged file is refused, and the set is left as it was
+   std::vector<char> contents;
+   {
+      std::ifstream in(filename, std::ios::binary);
+      contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+   }
+   contents[40] ^= 1;
+   {
+      std::ofstream out(filename, std::ios::binary);
+      out.write(contents.data(), contents.size());
+   }
+   BOOST_CHECK_THROW( loaded.load(filename), std::runtime_error );
+   BOOST_CHECK_EQUAL( loaded.size(), set.size() );
+   std::remove(filename.c_str());
+   BOOST_CHECK_THROW( loaded.load(filename), std::runtime_error );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,184 @@
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+
+#include <watch_list.hpp>
+#include <hex_conversion.hpp>
+#include <hex.hpp>
+#include <htlc.hpp>
+#include <base58.hpp>
+#include <bech32.hpp>
+
+using namespace bc_toolbox;
+
+BOOST_AUTO_TEST_SUITE( watch_list_test )
+
+namespace {
+
+std::vector<uint8_t> p2pkh(const std::vector<uint8_t>& hash)
+{
+   std::vector<uint8_t> ret_val = { OP_DUP, OP_HASH160, 20 };
+   ret_val.insert(ret_val.end(), hash.begin(), hash.end());
+   ret_val.push_back(OP_EQUALVERIFY);
+   ret_val.push_back(OP_CHECKSIG);
+   return ret_val;
+}
+
+std::vector<uint8_t> p2sh(const std::vector<uint8_t>& hash)
+{
+   std::vector<uint8_t> ret_val = { OP_HASH160, 20 };
+   ret_val.insert(ret_val.end(), hash.begin(), hash.end());
+   ret_val.push_back(OP_EQUAL);
+   return ret_val;
+}
+
+std::vector<uint8_t> witness(uint8_t version_op, const std::vector<uint8_t>& program)
+{
+   std::vector<uint8_t> ret_val = { version_op, (uint8_t)program.size() };
+   ret_val.insert(ret_val.end(), program.begin(), program.end());
+   return ret_val;
+}
+
+std::vector<uint8_t> test_hash(uint32_t i, size_t size = 20)
+{
+   std::vector<uint8_t> ret_val(size);
+   for(size_t j = 0; j < size; ++j)
+      ret_val[j] = (uint8_t)((i >> (8 * (j % 4))) + j * 31);
+   return ret_val;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE( script_kinds )
+{
+   watch_list list;
+   std::vector<uint8_t> pubkey_hash = test_hash(1);
+   std::vector<uint8_t> script_hash = test_hash(2);
+   std::vector<uint8_t> taproot = test_hash(3, 32);
+   BOOST_CHECK( list.add_pubkey_hash(pubkey_hash) );
+   BOOST_CHECK( !list.add_pubkey_hash(pubkey_hash) );
+   BOOST_CHECK( list.add_script_hash(script_hash) );
+   BOOST_CHECK( list.add_witness_program(1, taproot) );
+   BOOST_CHECK_EQUAL( list.size(), 3U );
+
+   // a pubkey hash matches both P2PKH and P2WPKH
+   BOOST_CHECK( list.contains(p2pkh(pubkey_hash)) );
+   BOOST_CHECK( list.contains(witness(OP_0, pubkey_hash)) );
+   BOOST_CHECK( !list.contains(p2sh(pubkey_hash)) );
+   // a script hash only matches P2SH
+   BOOST_CHECK( list.contains(p2sh(script_hash)) );
+   BOOST_CHECK( !list.contains(p2pkh(script_hash)) );
+   // witness programs match on version and program
+   BOOST_CHECK( list.contains(witness(OP_1, taproot)) );
+   BOOST_CHECK( !list.contains(witness(OP_0, taproot)) );
+   BOOST_CHECK( !list.contains(std::vector<uint8_t>({ OP_RETURN, 0x01, 0x02 })) );
+
+   // added by output script, as for an HTLC's P2SH address
+   std::vector<uint8_t> htlc = p2sh(test_hash(4));
+   BOOST_CHECK( !list.contains(htlc) );
+   BOOST_CHECK( list.add_script(htlc) );
+   BOOST_CHECK( list.contains(htlc) );
+   BOOST_CHECK( list.remove_script(htlc) );
+   BOOST_CHECK( !list.contains(htlc) );
+   BOOST_CHECK( !list.remove_script(htlc) );
+
+   BOOST_CHECK_THROW( list.add_pubkey_hash(test_hash(5, 19)), std::invalid_argument );
+   BOOST_CHECK_THROW( list.add_witness_program(17, taproot), std::invalid_argument );
+   BOOST_CHECK_THROW( list.add_script(std::vector<uint8_t>({ OP_1 })), std::invalid_argument );
+}
+
+BOOST_AUTO_TEST_CASE( addresses )
+{
+   // the HTLC of: calc_script_address [ testnet | mainnet ] 000102030405060708090a0b0c0d0e0f10111213
+   //    03fbbdb3b3fc3abbbd983b20a557445fb041d6f21cc5977d2121971cb1ce529897 800000
+   //    0367c4f666f18279009c941e57fab3e42653c6553e5ca092c104d1db279e328a28
+   htlc_params params;
+   std::vector<uint8_t> hashlock = from_hex(std::string("000102030405060708090a0b0c0d0e0f10111213"));
+   std::copy(hashlock.begin(), hashlock.end(), params.hashlock.begin());
+   params.recipient_pubkey_hash = hash160(from_hex(
+         std::string("03fbbdb3b3fc3abbbd983b20a557445fb041d6f21cc5977d2121971cb1ce529897")));
+   params.locktime = 800000;
+   params.sender_pubkey_hash = hash160(from_hex(
+         std::string("0367c4f666f18279009c941e57fab3e42653c6553e5ca092c104d1db279e328a28")));
+   std::vector<uint8_t> script = htlc_script(params);
+   digest160 script_hash = hash160(script);
+   std::vector<uint8_t> htlc(p2sh(std::vector<uint8_t>(script_hash.begin(), script_hash.end())));
+
+   watch_list list;
+   BOOST_CHECK( list.add_address("2N5ogjTG96gF38heZzgHW8ZPHCnP12HVx7w") );
+   BOOST_CHECK( list.contains(htlc) );
+   // the mainnet address has the same script hash
+   BOOST_CHECK( !list.add_address("3EFUfiL7VDjgvv22KYfdWcQ1zSAqDtpwar") );
+   BOOST_CHECK_EQUAL( list.size(), 1U );
+
+   // P2PKH, P2WPKH and P2WSH
+   std::vector<uint8_t> pubkey_hash(params.sender_pubkey_hash.begin(), params.sender_pubkey_hash.end());
+   std::vector<uint8_t> payload(pubkey_hash);
+   payload.insert(payload.begin(), 0x6f);
+   BOOST_CHECK( list.add_address(base58check_encode(payload)) );
+   BOOST_CHECK( list.contains(p2pkh(pubkey_hash)) );
+   BOOST_CHECK( !list.add_address(encode_segwit_address("tb", 0, pubkey_hash)) );
+   digest256 witness_script_hash;
+   sha256(script, witness_script_hash.data());
+   std::vector<uint8_t> program(witness_script_hash.begin(), witness_script_hash.end());
+   BOOST_CHECK( list.add_address(encode_segwit_address("bc", 0, program)) );
+   BOOST_CHECK( list.contains(witness(OP_0, program)) );
+   BOOST_CHECK_EQUAL( list.size(), 3U );
+
+   BOOST_CHECK_THROW( list.add_address("2N5ogjTG96gF38heZzgHW8ZPHCnP12HVx7x"), std::invalid_argument );
+   BOOST_CHECK_THROW( list.add_address(""), std::invalid_argument );
+}
+
+BOOST_AUTO_TEST_CASE( batch_match )
+{
+   // enough entries to rebuild the filter several times
+   watch_list list;
+   const uint32_t watched = 5000;
+   for(uint32_t i = 0; i < watched; ++i)
+      list.add_script_hash(test_hash(i * 2));
+   BOOST_CHECK_EQUAL( list.size(), watched );
+
+   // watched (even) and unwatched (odd) hashes, in several script forms
+   std::vector<std::vector<uint8_t> > scripts;
+   for(uint32_t i = 0; i < watched * 2; ++i)
+   {
+      scripts.push_back(p2sh(test_hash(i)));
+      scripts.push_back(p2pkh(test_hash(i)));
+   }
+   std::vector<byte_span> spans(scripts.begin(), scripts.end());
+   std::vector<size_t> matches;
+   BOOST_CHECK_EQUAL( list.match(span<const byte_span>(spans.data(), spans.size()), matches), watched );
+   size_t wrong = 0;
+   for(size_t m : matches)
+      if (m % 4 != 0)
+         ++wrong;
+   BOOST_CHECK_EQUAL( wrong, 0U );
+   for(uint32_t i = 0; i < watched; i += 97)
+      BOOST_CHECK( list.remove_script(p2sh(test_hash(i * 2))) );
+   matches.clear();
+   BOOST_CHECK_EQUAL( list.match(span<const byte_span>(spans.data(), spans.size()), matches), list.size() );
+
+   // the outputs of a block's transactions
+   std::vector<transaction> txs(3);
+   for(size_t t = 0; t < txs.size(); ++t)
+   {
+      for(uint32_t o = 0; o < 4; ++o)
+      {
+         output out;
+         out.value = 1000;
+         out.script = p2sh(test_hash(t * 4 + o + 1));
+         txs[t].edit_outputs().push_back(out);
+      }
+   }
+   std::vector<watch_match> found;
+   BOOST_CHECK_EQUAL( list.match(span<const transaction>(txs.data(), txs.size()), found), 6U );
+   BOOST_REQUIRE_EQUAL( found.size(), 6U );
+   BOOST_CHECK_EQUAL( found[0].tx, 0U );
+   BOOST_CHECK_EQUAL( found[0].output, 1U );
+   BOOST_CHECK_EQUAL( found[5].tx, 2U );
+   BOOST_CHECK_EQUAL( found[5].output, 3U );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -47,10 +47,10 @@ int main(int argc, char** argv)
 
    // convert tx_as_string back to a transaction
    bc_toolbox::transaction tx( bc_toolbox::hex_string_to_vector(tx_as_string) );
-   bc_toolbox::input& in = tx.inputs.at(0);
+   bc_toolbox::input& in = tx.edit_inputs().at(0);
 
    // merge the two scripts
-   std::vector<uint8_t> merged_script = new_script.get_bytes_as_vector();
+   std::vector<uint8_t> merged_script = new_script.release();
    merged_script.insert(merged_script.end(), in.sig_script.begin(), in.sig_script.end() );
 
    in.sig_script = merged_script;
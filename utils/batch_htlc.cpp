@@ -0,0 +1,417 @@
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdlib>
+
+#include <thread_pool.hpp>
+#include <htlc.hpp>
+#include <hash.hpp>
+#include <hex.hpp>
+#include <base58.hpp>
+
+/***
+ * Generate many BIP199 HTLC contracts at once
+ *
+ * Each input row has a preimage (text) or a hashlock (hex HASH160 of the preimage),
+ * the receiver's and sender's public keys (hex), a timelock and a network
+ * (mainnet or testnet). CSV input starts with a header naming the columns
+ * (preimage or hashlock, receiver_pubkey, sender_pubkey, timelock, network).
+ * NDJSON input has one flat object per line with the same keys.
+ *
+ * Output is in the same format and order as the input, one row per contract,
+ * with the hashlock, redeem script and P2SH address (or an error).
+ */
+
+void print_syntax_and_exit(int argc, char** argv)
+{
+   std::cerr << "Syntax: " << argv[0] << " [ csv | ndjson ] input_file_or_- [ threads ]\n";
+   exit(1);
+}
+
+enum class row_format
+{
+   csv,
+   ndjson
+};
+
+class contract_row
+{
+   public:
+      std::map<std::string, std::string> fields;
+      std::string get(const std::string& name) const
+      {
+         auto itr = fields.find(name);
+         return itr == fields.end() ? std::string() : itr->second;
+      }
+};
+
+class contract_result
+{
+   public:
+      std::string hashlock;
+      std::string redeem_script;
+      std::string address;
+      std::string error;
+};
+
+/***
+ * Split a CSV line. Fields may be double quoted (with "" for a quote).
+ */
+std::vector<std::string> split_csv(const std::string& line)
+{
+   std::vector<std::string> ret_val(1);
+   bool quoted = false;
+   for(size_t i = 0; i < line.size(); ++i)
+   {
+      char c = line[i];
+      if (quoted)
+      {
+         if (c == '"' && i + 1 < line.size() && line[i + 1] == '"')
+         {
+            ret_val.back() += '"';
+            ++i;
+         }
+         else if (c == '"')
+            quoted = false;
+         else
+            ret_val.back() += c;
+      }
+      else if (c == '"')
+         quoted = true;
+      else if (c == ',')
+         ret_val.emplace_back();
+      else if (c != '\r')
+         ret_val.back() += c;
+   }
+   if (quoted)
+      throw std::invalid_argument("unterminated quote");
+   return ret_val;
+}
+
+/***
+ * Parse a flat JSON object of strings and numbers
+ */
+class flat_json_parser
+{
+   public:
+      flat_json_parser(const std::string& line) : line(line), pos(0) {}
+      void parse(contract_row& row)
+      {
+         expect('{');
+         if (peek() == '}')
+            return;
+         for(;;)
+         {
+            std::string key = parse_string();
+            expect(':');
+            std::string value;
+            if (peek() == '"')
+               value = parse_string();
+            else
+               value = parse_token();
+            row.fields[key] = value;
+            if (peek() == ',')
+            {
+               ++pos;
+               continue;
+            }
+            expect('}');
+            return;
+         }
+      }
+   private:
+      char peek()
+      {
+         while (pos < line.size() && isspace((unsigned char)line[pos]))
+            ++pos;
+         if (pos == line.size())
+            throw std::invalid_argument("unexpected end of JSON");
+         return line[pos];
+      }
+      void expect(char c)
+      {
+         if (peek() != c)
+            throw std::invalid_argument(std::string("expected '") + c + "' in JSON");
+         ++pos;
+      }
+      std::string parse_string()
+      {
+         expect('"');
+         std::string ret_val;
+         while (pos < line.size() && line[pos] != '"')
+         {
+            char c = line[pos++];
+            if (c == '\\')
+            {
+               if (pos == line.size())
+                  break;
+               char escaped = line[pos++];
+               switch(escaped)
+               {
+                  case 'n': ret_val += '\n'; break;
+                  case 't': ret_val += '\t'; break;
+                  case 'r': ret_val += '\r'; break;
+                  case 'u':
+                     if (pos + 4 > line.size())
+                        throw std::invalid_argument("bad JSON escape");
+                     ret_val += (char)std::strtol(line.substr(pos, 4).c_str(), nullptr, 16);
+                     pos += 4;
+                     break;
+                  default: ret_val += escaped; break;
+               }
+            }
+            else
+               ret_val += c;
+         }
+         if (pos == line.size())
+            throw std::invalid_argument("unterminated JSON string");
+         ++pos;
+         return ret_val;
+      }
+      std::string parse_token()
+      {
+         size_t start = pos;
+         while (pos < line.size() && line[pos] != ',' && line[pos] != '}' && !isspace((unsigned char)line[pos]))
+            ++pos;
+         return line.substr(start, pos - start);
+      }
+      const std::string& line;
+      size_t pos;
+};
+
+std::string json_escape(const std::string& in)
+{
+   std::string ret_val;
+   for(char c : in)
+   {
+      if (c == '"' || c == '\\')
+         ret_val += '\\';
+      ret_val += c;
+   }
+   return ret_val;
+}
+
+/***
+ * Quote a CSV field (with "" for a quote)
+ */
+std::string csv_quote(const std::string& in)
+{
+   std::string ret_val = "\"";
+   for(char c : in)
+   {
+      if (c == '"')
+         ret_val += '"';
+      ret_val += c;
+   }
+   return ret_val + "\"";
+}
+
+/***
+ * Turn a chunk of input lines into contracts. Public keys, preimages and
+ * scripts are hashed in batches.
+ * @param line_numbers where each line is in the input file (counting blank lines and the header)
+ */
+std::vector<contract_result> process_chunk(const std::vector<std::string>& lines,
+      const std::vector<size_t>& line_numbers, row_format format, const std::vector<std::string>& columns)
+{
+   size_t count = lines.size();
+   std::vector<contract_result> results(count);
+   std::vector<bc_toolbox::htlc_params> params(count);
+   std::vector<bool> testnet(count);
+   // for each row: preimage (or nothing), receiver pubkey, sender pubkey
+   std::vector<std::vector<uint8_t> > to_hash(count * 3);
+   std::vector<bool> has_preimage(count);
+   for(size_t i = 0; i < count; ++i)
+   {
+      try
+      {
+         contract_row row;
+         if (format == row_format::csv)
+         {
+            std::vector<std::string> values = split_csv(lines[i]);
+            if (values.size() != columns.size())
+               throw std::invalid_argument("wrong number of columns");
+            for(size_t c = 0; c < columns.size(); ++c)
+               row.fields[columns[c]] = values[c];
+         }
+         else
+            flat_json_parser(lines[i]).parse(row);
+         std::string network = row.get("network");
+         if (network != "mainnet" && network != "testnet")
+            throw std::invalid_argument("network must be mainnet or testnet");
+         testnet[i] = network == "testnet";
+         if (row.fields.count("hashlock") != 0 && !row.get("hashlock").empty())
+         {
+            std::vector<uint8_t> hashlock = bc_toolbox::from_hex(row.get("hashlock"));
+            if (hashlock.size() != 20)
+               throw std::invalid_argument("hashlock must be 20 bytes");
+            std::copy(hashlock.begin(), hashlock.end(), params[i].hashlock.begin());
+         }
+         else if (row.fields.count("preimage") != 0)
+         {
+            std::string preimage = row.get("preimage");
+            to_hash[i * 3].assign(preimage.begin(), preimage.end());
+            has_preimage[i] = true;
+         }
+         else
+            throw std::invalid_argument("missing preimage or hashlock");
+         to_hash[i * 3 + 1] = bc_toolbox::from_hex(row.get("receiver_pubkey"));
+         to_hash[i * 3 + 2] = bc_toolbox::from_hex(row.get("sender_pubkey"));
+         if (to_hash[i * 3 + 1].empty() || to_hash[i * 3 + 2].empty())
+            throw std::invalid_argument("missing public key");
+         std::string timelock = row.get("timelock");
+         char* end = nullptr;
+         unsigned long value = std::strtoul(timelock.c_str(), &end, 10);
+         if (timelock.empty() || *end != 0 || value == 0 || value > 0xffffffffUL)
+            throw std::invalid_argument("invalid timelock");
+         params[i].locktime = value;
+      }
+      catch (const std::exception& e)
+      {
+         results[i].error = "line " + std::to_string(line_numbers[i]) + ": " + e.what();
+      }
+   }
+
+   // HASH160 of the preimages and public keys
+   std::vector<bc_toolbox::byte_span> messages(to_hash.begin(), to_hash.end());
+   std::vector<bc_toolbox::digest160> digests(messages.size());
+   bc_toolbox::hash160_batch(messages, digests);
+
+   std::vector<std::vector<uint8_t> > scripts(count);
+   for(size_t i = 0; i < count; ++i)
+   {
+      if (!results[i].error.empty())
+         continue;
+      if (has_preimage[i])
+         params[i].hashlock = digests[i * 3];
+      params[i].recipient_pubkey_hash = digests[i * 3 + 1];
+      params[i].sender_pubkey_hash = digests[i * 3 + 2];
+      scripts[i] = bc_toolbox::htlc_script(params[i]);
+   }
+
+   // HASH160 of the redeem scripts
+   std::vector<bc_toolbox::byte_span> script_spans(scripts.begin(), scripts.end());
+   std::vector<bc_toolbox::digest160> script_hashes(count);
+   bc_toolbox::hash160_batch(script_spans, script_hashes);
+
+   for(size_t i = 0; i < count; ++i)
+   {
+      if (!results[i].error.empty())
+         continue;
+      // 0x05 for mainnet, or 0xc4 for testnet
+      uint8_t payload[21];
+      payload[0] = testnet[i] ? 0xc4 : 0x05;
+      std::copy(script_hashes[i].begin(), script_hashes[i].end(), payload + 1);
+      results[i].hashlock = bc_toolbox::to_hex(params[i].hashlock);
+      results[i].redeem_script = bc_toolbox::to_hex(scripts[i]);
+      results[i].address = bc_toolbox::base58check_encode(bc_toolbox::byte_span(payload, 21));
+   }
+   return results;
+}
+
+void write_results(std::ostream& out, row_format format, const std::vector<contract_result>& results)
+{
+   for(const contract_result& r : results)
+   {
+      if (format == row_format::csv)
+         out << r.hashlock << "," << r.redeem_script << "," << r.address << ","
+               << (r.error.empty() ? "" : csv_quote(r.error)) << "\n";
+      else if (r.error.empty())
+         out << "{\"hashlock\":\"" << r.hashlock << "\",\"redeem_script\":\"" << r.redeem_script
+               << "\",\"p2sh_address\":\"" << r.address << "\"}\n";
+      else
+         out << "{\"error\":\"" << json_escape(r.error) << "\"}\n";
+   }
+}
+
+int main(int argc, char** argv)
+{
+   if (argc < 3)
+      print_syntax_and_exit(argc, argv);
+   row_format format;
+   if (std::string(argv[1]) == "csv")
+      format = row_format::csv;
+   else if (std::string(argv[1]) == "ndjson")
+      format = row_format::ndjson;
+   else
+      print_syntax_and_exit(argc, argv);
+   std::ifstream file;
+   std::string filename(argv[2]);
+   if (filename != "-")
+   {
+      file.open(filename);
+      if (!file)
+      {
+         std::cerr << "Unable to open " << filename << "\n";
+         return 1;
+      }
+   }
+   std::istream& in = filename == "-" ? std::cin : file;
+   size_t threads = argc > 3 ? std::atoi(argv[3]) : 0;
+
+   std::string line;
+   std::vector<std::string> columns;
+   size_t line_number = 1;
+   if (format == row_format::csv)
+   {
+      if (!std::getline(in, line))
+         return 0;
+      columns = split_csv(line);
+      for(std::string& c : columns)
+         c.erase(std::remove(c.begin(), c.end(), ' '), c.end());
+      ++line_number;
+      std::cout << "hashlock,redeem_script,p2sh_address,error\n";
+   }
+
+   // read in chunks, keeping a few chunks per thread in flight, and write
+   // the results in order as they finish
+   const size_t chunk_size = 1024;
+   bc_toolbox::thread_pool pool(threads);
+   std::deque<std::future<std::vector<contract_result> > > pending;
+   const size_t window = pool.size() * 2;
+   bool more = true;
+   try
+   {
+      while (more || !pending.empty())
+      {
+         while (more && pending.size() < window)
+         {
+            std::vector<std::string> lines;
+            std::vector<size_t> line_numbers;
+            lines.reserve(chunk_size);
+            line_numbers.reserve(chunk_size);
+            // blank lines are skipped, but still counted
+            for(; lines.size() < chunk_size && std::getline(in, line); ++line_number)
+            {
+               if (!line.empty() && line != "\r")
+               {
+                  lines.push_back(line);
+                  line_numbers.push_back(line_number);
+               }
+            }
+            more = lines.size() == chunk_size;
+            if (lines.empty())
+               break;
+            pending.push_back(pool.submit( [lines, line_numbers, format, columns]()
+                  { return process_chunk(lines, line_numbers, format, columns); } ));
+         }
+         if (pending.empty())
+            break;
+         write_results(std::cout, format, pending.front().get());
+         pending.pop_front();
+      }
+   }
+   catch (const std::exception& e)
+   {
+      for(auto& f : pending)
+         f.wait();
+      std::cerr << "Error: " << e.what() << "\n";
+      return 1;
+   }
+   return 0;
+}
@@ -1,9 +1,10 @@
 #include <string>
 #include <iostream>
 #include <vector>
-#include <script.hpp>
-#include <iomanip>
-#include <sstream>
+#include <algorithm>
+#include <htlc.hpp>
+#include <hash.hpp>
+#include <hex.hpp>
 
 void print_help_and_exit(int argc, char** argv)
 {
@@ -26,20 +27,10 @@ std::vector<uint8_t> string_to_vector(std::string input)
    return v;
 }
 
-std::string vector_to_hex_string(std::vector<uint8_t> incoming)
-{
-   std::stringstream ss;
-   for(auto i : incoming)
-   {
-      ss << std::hex << std::setw(2) << std::setfill('0') << (int)i;
-   }
-   return ss.str();
-}
-
 int main(int argc, char**argv)
 {
    // parse the command line
-   if(argc < 5)
+   if(argc < 6)
       print_help_and_exit(argc, argv);
 
    bool testnet = false;
@@ -48,34 +39,19 @@ int main(int argc, char**argv)
    if (!testnet && std::string(argv[1]) != "mainnet")
       print_help_and_exit(argc, argv);
    std::vector<uint8_t> hash160_hash_lock = bc_toolbox::hex_string_to_vector(argv[2]);
+   if (hash160_hash_lock.size() != 20)
+      print_help_and_exit(argc, argv);
+   bc_toolbox::htlc_params params;
+   std::copy(hash160_hash_lock.begin(), hash160_hash_lock.end(), params.hashlock.begin());
    std::vector<uint8_t> recipient_pubkey = bc_toolbox::hex_string_to_vector(argv[3]);
-   std::vector<uint8_t> recipient_pubkey_hash = bc_toolbox::ripemd160(bc_toolbox::sha256(recipient_pubkey));
-   uint32_t timeout = std::atoi(argv[4]);
+   params.recipient_pubkey_hash = bc_toolbox::hash160(recipient_pubkey);
+   params.locktime = std::atoi(argv[4]);
    std::vector<uint8_t> sender_pubkey = bc_toolbox::hex_string_to_vector(argv[5]);
-   std::vector<uint8_t> sender_pubkey_hash = bc_toolbox::ripemd160(bc_toolbox::sha256(sender_pubkey));
+   params.sender_pubkey_hash = bc_toolbox::hash160(sender_pubkey);
 
    // following bip199
-   bc_toolbox::script s;
-   s.add_opcode(bc_toolbox::OP_IF);
-   s.add_opcode(bc_toolbox::OP_HASH160);
-   s.add_bytes_with_size(hash160_hash_lock);
-   s.add_opcode(bc_toolbox::OP_EQUALVERIFY);
-   s.add_opcode(bc_toolbox::OP_DUP);
-   s.add_opcode(bc_toolbox::OP_HASH160);
-   s.add_bytes_with_size(recipient_pubkey_hash);
-   s.add_opcode(bc_toolbox::OP_ELSE);
-   s.add_int(timeout);
-   s.add_opcode(bc_toolbox::OP_CHECKLOCKTIMEVERIFY);
-   s.add_opcode(bc_toolbox::OP_DROP);
-   s.add_opcode(bc_toolbox::OP_DUP);
-   s.add_opcode(bc_toolbox::OP_HASH160);
-   s.add_bytes_with_size(sender_pubkey_hash);
-   s.add_opcode(bc_toolbox::OP_ENDIF);
-   s.add_opcode(bc_toolbox::OP_EQUALVERIFY);
-   s.add_opcode(bc_toolbox::OP_CHECKSIG);
-
-   std::vector<uint8_t> redeem_script = s.get_bytes_as_vector();
-   std::cout << vector_to_hex_string(redeem_script) << "\n";
+   std::vector<uint8_t> redeem_script = bc_toolbox::htlc_script(params);
+   std::cout << bc_toolbox::to_hex(redeem_script) << "\n";
 
    return 0;
 }
@@ -1,18 +1,8 @@
 #include <vector>
 #include <iostream>
 #include <hex_conversion.hpp>
-#include <sstream>
-#include <iomanip>
-
-std::string vector_to_hex_string(std::vector<uint8_t> incoming)
-{
-   std::stringstream ss;
-   for(auto i : incoming)
-   {
-      ss << std::hex << std::setw(2) << std::setfill('0') << (int)i;
-   }
-   return ss.str();
-}
+#include <hash.hpp>
+#include <hex.hpp>
 
 void print_error_message(int argc, char** argv)
 {
@@ -37,7 +27,7 @@ int main(int argc, char**argv)
    if (is_hex)
       incoming = bc_toolbox::hex_string_to_vector(text_to_be_hashed);
    
-   std::vector<uint8_t> results = bc_toolbox::ripemd160(bc_toolbox::sha256(incoming));
-   std::cout << vector_to_hex_string(results) << "\n";
+   bc_toolbox::digest160 results = bc_toolbox::hash160(incoming);
+   std::cout << bc_toolbox::to_hex(results) << "\n";
    return 0;
 }
\ No newline at end of file
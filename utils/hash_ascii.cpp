@@ -1,18 +1,7 @@
 #include <vector>
 #include <iostream>
 #include <hex_conversion.hpp>
-#include <sstream>
-#include <iomanip>
-
-std::string vector_to_hex_string(std::vector<uint8_t> incoming)
-{
-   std::stringstream ss;
-   for(auto i : incoming)
-   {
-      ss << std::hex << std::setw(2) << std::setfill('0') << (int)i;
-   }
-   return ss.str();
-}
+#include <hex.hpp>
 
 int main(int argc, char**argv)
 {
@@ -21,6 +10,6 @@ int main(int argc, char**argv)
 
    std::string text_to_be_hashed(argv[1]);
    std::vector<uint8_t> incoming(text_to_be_hashed.begin(), text_to_be_hashed.end());
-   std::cout << vector_to_hex_string(incoming) << "\n";
+   std::cout << bc_toolbox::to_hex(incoming) << "\n";
    return 0;
 }
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include <string>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <cstring>
+#include <cstdlib>
+#include <csignal>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <service.hpp>
+#include <thread_pool.hpp>
+
+/***
+ * Serve the toolbox operations over a Unix domain socket, so callers do not
+ * pay for starting a process per operation.
+ *
+ * Each connection sends request lines (see service.hpp) and may send many
+ * before reading any responses. Requests run on a worker pool, so responses
+ * can come back in a different order; match them up by id. A connection
+ * stops being read while it has max_in_flight requests unanswered, and a
+ * request longer than max_request_size gets an error and the connection
+ * is dropped.
+ */
+
+const size_t max_in_flight = 256;
+const size_t max_request_size = 1 << 22; // room for the hex of a 2MB transaction
+
+void print_syntax_and_exit(int argc, char** argv)
+{
+   std::cerr << "Syntax: " << argv[0] << " socket_path [ threads ]\n";
+   exit(1);
+}
+
+/***
+ * One client connection. Shared by the reader and the jobs it queued, and
+ * closed when the last of them is done.
+ */
+class connection
+{
+   public:
+      connection(int fd) : fd(fd) {}
+      ~connection() { close(fd); }
+      void write_line(const std::string& line)
+      {
+         std::string out = line + "\n";
+         std::lock_guard<std::mutex> lock(write_mutex);
+         const char* pos = out.data();
+         size_t remaining = out.size();
+         while (remaining > 0)
+         {
+            ssize_t written = send(fd, pos, remaining, MSG_NOSIGNAL);
+            if (written < 0 && errno == EINTR)
+               continue;
+            if (written <= 0)
+               return; // the client went away
+            pos += written;
+            remaining -= written;
+         }
+      }
+      /***
+       * @brief wait until fewer than max_in_flight requests are unanswered, then count one more
+       */
+      void start_request()
+      {
+         std::unique_lock<std::mutex> lock(in_flight_mutex);
+         drained.wait(lock, [this]() { return in_flight < max_in_flight; });
+         ++in_flight;
+      }
+      void finish_request()
+      {
+         std::lock_guard<std::mutex> lock(in_flight_mutex);
+         --in_flight;
+         drained.notify_one();
+      }
+      const int fd;
+   private:
+      std::mutex write_mutex;
+      std::mutex in_flight_mutex;
+      std::condition_variable drained;
+      size_t in_flight = 0;
+};
+
+void serve(std::shared_ptr<connection> conn, bc_toolbox::service& svc, bc_toolbox::thread_pool& pool)
+{
+   std::string pending;
+   char buffer[65536];
+   for(;;)
+   {
+      ssize_t received = recv(conn->fd, buffer, sizeof(buffer), 0);
+      if (received < 0 && errno == EINTR)
+         continue;
+      if (received <= 0)
+         return;
+      pending.append(buffer, received);
+      size_t start = 0;
+      size_t end;
+      while ((end = pending.find('\n', start)) != std::string::npos)
+      {
+         if (end - start > max_request_size)
+            break;
+         std::string request = pending.substr(start, end - start);
+         start = end + 1;
+         if (!request.empty() && request.back() == '\r')
+            request.pop_back();
+         if (request.empty())
+            continue;
+         // stop reading until the client has taken some responses
+         conn->start_request();
+         pool.submit( [conn, &svc, request]()
+               {
+                  conn->write_line(svc.execute(request));
+                  conn->finish_request();
+               } );
+      }
+      pending.erase(0, start);
+      if (pending.size() > max_request_size)
+      {
+         conn->write_line("- error request too long");
+         return;
+      }
+   }
+}
+
+int main(int argc, char** argv)
+{
+   if (argc < 2)
+      print_syntax_and_exit(argc, argv);
+   std::string path(argv[1]);
+   size_t threads = argc > 2 ? std::atoi(argv[2]) : 0;
+
+   sockaddr_un address;
+   memset(&address, 0, sizeof(address));
+   address.sun_family = AF_UNIX;
+   if (path.size() >= sizeof(address.sun_path))
+   {
+      std::cerr << "Socket path is too long\n";
+      return 1;
+   }
+   strcpy(address.sun_path, path.c_str());
+
+   int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+   if (listener < 0)
+   {
+      std::cerr << "Unable to create socket: " << strerror(errno) << "\n";
+      return 1;
+   }
+   unlink(path.c_str());
+   if (bind(listener, (sockaddr*)&address, sizeof(address)) < 0 || listen(listener, 64) < 0)
+   {
+      std::cerr << "Unable to listen on " << path << ": " << strerror(errno) << "\n";
+      return 1;
+   }
+   signal(SIGPIPE, SIG_IGN);
+
+   bc_toolbox::service svc;
+   bc_toolbox::thread_pool pool(threads);
+   for(;;)
+   {
+      int fd = accept(listener, nullptr, nullptr);
+      if (fd < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         std::cerr << "accept failed: " << strerror(errno) << "\n";
+         break;
+      }
+      std::shared_ptr<connection> conn = std::make_shared<connection>(fd);
+      std::thread( [conn, &svc, &pool]() { serve(conn, svc, pool); } ).detach();
+   }
+   close(listener);
+   unlink(path.c_str());
+   return 1;
+}